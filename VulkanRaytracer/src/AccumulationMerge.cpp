@@ -0,0 +1,52 @@
+#include "AccumulationMerge.h"
+
+AccumulationMerge::AccumulationMerge(Image* accumulationImage, VkPipelineShaderStageCreateInfo mergeShaderStage)
+{
+    _extent = { accumulationImage->Width(), accumulationImage->Height() };
+
+    _layout = std::make_unique<DescriptorSetLayout>(std::vector<DescriptorSetLayout::DescriptorSetInfo>{
+        { 1, DescriptorType::StorageImage, ShaderStage::Compute },
+        { 1, DescriptorType::StorageImage, ShaderStage::Compute },
+        });
+
+    _descriptor = Renderer::Get()->AllocateDescriptorSet(_layout->GetHandle());
+    _pipeline = std::make_unique<ComputePipeline>(ComputePipeline::PipelineInfo{
+        mergeShaderStage,
+        _layout->GetHandle(),
+        VK_NULL_HANDLE
+        });
+
+    _peerImage = std::make_unique<Image>(_extent, Format::R32G32B32A32_Sfloat, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+    std::vector<float> zero(static_cast<size_t>(_extent.width) * _extent.height * 4, 0.0f);
+    Upload(zero.data());
+
+    Renderer::Get()->UpdateDescriptorSet(_descriptor, {
+        { 0, DescriptorType::StorageImage, {}, {VK_NULL_HANDLE, accumulationImage->GetImageView(), VK_IMAGE_LAYOUT_GENERAL}},
+        { 1, DescriptorType::StorageImage, {}, {VK_NULL_HANDLE, _peerImage->GetImageView(), VK_IMAGE_LAYOUT_GENERAL}},
+        });
+}
+
+AccumulationMerge::~AccumulationMerge()
+{
+
+}
+
+void AccumulationMerge::Upload(const float* sums)
+{
+    _peerImage->SetData(sums, _extent.width * _extent.height * 4 * sizeof(float), ImageLayout::General);
+}
+
+void AccumulationMerge::CmdMerge(VkCommandBuffer cmd)
+{
+    // Wait for the accumulation dispatches of this device
+    VkMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline->GetHandle());
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline->GetLayout(), 0, 1, &_descriptor, 0, nullptr);
+    vkCmdDispatch(cmd, (_extent.width + 15) / 16, (_extent.height + 15) / 16, 1);
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "Vulkan/VKHeaders.h"
+
+/* Adds the accumulation of another device onto an			*/
+/* accumulation image, the sums are uploaded from the host	*/
+class AccumulationMerge
+{
+public:
+	AccumulationMerge(Image* accumulationImage, VkPipelineShaderStageCreateInfo mergeShaderStage);
+	~AccumulationMerge();
+
+	/* Blocking upload of width * height float rgba sums, no	*/
+	/* submitted merge may still read the previous upload		*/
+	void Upload(const float* sums);
+	void CmdMerge(VkCommandBuffer cmd);
+
+private:
+
+	VkExtent2D _extent;
+
+	std::unique_ptr<DescriptorSetLayout> _layout;
+	std::unique_ptr<ComputePipeline> _pipeline;
+	VkDescriptorSet _descriptor;
+	std::unique_ptr<Image> _peerImage;
+};
@@ -0,0 +1,92 @@
+#include "AdaptiveSampler.h"
+
+// Matches AdaptiveData in Adaptive.comp
+struct AdaptiveData
+{
+    float threshold;
+    uint32_t minSamples;
+    uint32_t width;
+    uint32_t height;
+    uint32_t pass;
+};
+
+AdaptiveSampler::AdaptiveSampler(Image* accumulationImage, Image* outputImage)
+{
+    SpirvHelper::Init();
+    _shader = std::make_unique<Shader>("res/Shaders/Adaptive.comp");
+    SpirvHelper::Finalize();
+
+    _layout = std::make_unique<DescriptorSetLayout>(std::vector<DescriptorSetLayout::DescriptorSetInfo>{
+        { 1, DescriptorType::StorageImage, ShaderStage::Compute },
+        { 1, DescriptorType::StorageImage, ShaderStage::Compute },
+        { 1, DescriptorType::StorageImage, ShaderStage::Compute },
+        { 1, DescriptorType::StorageBuffer, ShaderStage::Compute },
+        });
+
+    _descriptor = Renderer::Get()->AllocateDescriptorSet(_layout->GetHandle());
+    _pipeline = std::make_unique<ComputePipeline>(ComputePipeline::PipelineInfo{
+        _shader->GetShaderStage(),
+        _layout->GetHandle(),
+        VK_NULL_HANDLE
+        });
+
+    VkExtent2D extent = { accumulationImage->Width(), accumulationImage->Height() };
+    _statisticsImage = std::make_unique<Image>(extent, Format::R32G32B32A32_Sfloat, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+    std::vector<uint8_t> zero(4 * 4 * extent.width * extent.height, 0);
+    _statisticsImage->SetData(zero.data(), static_cast<uint32_t>(zero.size()), ImageLayout::General);
+
+    // Eight words of header and one packed pixel per pixel of the image
+    _pixelBuffer = std::make_unique<Buffer>((8 + extent.width * extent.height) * sizeof(uint32_t),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    Renderer::Get()->UpdateDescriptorSet(_descriptor, {
+        { 0, DescriptorType::StorageImage, {}, {VK_NULL_HANDLE, accumulationImage->GetImageView(), VK_IMAGE_LAYOUT_GENERAL}},
+        { 1, DescriptorType::StorageImage, {}, {VK_NULL_HANDLE, outputImage->GetImageView(), VK_IMAGE_LAYOUT_GENERAL}},
+        { 2, DescriptorType::StorageImage, {}, {VK_NULL_HANDLE, _statisticsImage->GetImageView(), VK_IMAGE_LAYOUT_GENERAL}},
+        { 3, DescriptorType::StorageBuffer, {_pixelBuffer->GetHandle(), 0, VK_WHOLE_SIZE}, {}},
+        });
+}
+
+AdaptiveSampler::~AdaptiveSampler()
+{
+
+}
+
+void AdaptiveSampler::CmdBuildPixelList(VkCommandBuffer cmd, const FrameData& frameData, VkExtent2D region)
+{
+    // The previous dispatch wrote the statistics and the accumulation and read the list
+    VkMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    // An empty list still dispatches zero workgroups
+    uint32_t header[8] = { 0, 1, 1, 0, 0, 0, 0, 0 };
+    vkCmdUpdateBuffer(cmd, _pixelBuffer->GetHandle(), 0, sizeof(header), header);
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    AdaptiveData data = { frameData.adaptiveThreshold, frameData.adaptiveMinSamples, region.width, region.height, 0 };
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline->GetHandle());
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline->GetLayout(), 0, 1, &_descriptor, 0, nullptr);
+    // Pass 0 sums the deviations the budgets of pass 1 are scaled by
+    for (data.pass = 0; data.pass < 2; data.pass++)
+    {
+        if (data.pass > 0)
+        {
+            barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+            vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+        }
+        vkCmdPushConstants(cmd, _pipeline->GetLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(data), &data);
+        vkCmdDispatch(cmd, (region.width + 15) / 16, (region.height + 15) / 16, 1);
+    }
+
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+        0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
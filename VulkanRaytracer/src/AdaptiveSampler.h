@@ -0,0 +1,36 @@
+#pragma once
+#include "Vulkan/VKHeaders.h"
+#include "RayTracingStructs.h"
+
+/* Per pixel sample statistics and the list of pixels that are	*/
+/* below their sample budget. Budgets follow the luminance		*/
+/* deviation so the image reaches frameData.adaptiveThreshold	*/
+/* as its RMSE with the fewest samples. Pixels left out of the	*/
+/* list repeat their mean in the accumulation, which keeps		*/
+/* dividing by the dispatch count correct						*/
+class AdaptiveSampler
+{
+public:
+	/* Compiles Adaptive.comp like EnvironmentMap does, the		*/
+	/* images are the ones of the owning PathTracer				*/
+	AdaptiveSampler(Image* accumulationImage, Image* outputImage);
+	~AdaptiveSampler();
+
+	/* Records the passes that list the pixels the next		*/
+	/* dispatch traces and fill the indirect dispatch size		*/
+	void CmdBuildPixelList(VkCommandBuffer cmd, const FrameData& frameData, VkExtent2D region);
+
+	Image* GetStatisticsImage() { return _statisticsImage.get(); }
+	/* Indirect dispatch size, pixel count and the packed pixels	*/
+	Buffer* GetPixelBuffer() { return _pixelBuffer.get(); }
+
+private:
+
+	std::unique_ptr<Shader> _shader;
+	std::unique_ptr<DescriptorSetLayout> _layout;
+	std::unique_ptr<ComputePipeline> _pipeline;
+	VkDescriptorSet _descriptor;
+
+	std::unique_ptr<Image> _statisticsImage;
+	std::unique_ptr<Buffer> _pixelBuffer;
+};
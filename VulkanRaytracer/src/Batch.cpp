@@ -0,0 +1,490 @@
+#include "Batch.h"
+#include "PathTracer.h"
+#include "Scene.h"
+#include "HdrResolve.h"
+#include "Timeline.h"
+#include "RayCounters.h"
+#include "Helper.h"
+#include "Cpu/CpuPathTracer.h"
+#include <iostream>
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <cassert>
+#include <algorithm>
+
+bool ParseBatchSettings(int argc, char** argv, BatchSettings& settings)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--render")
+            continue;
+        if (arg == "--half")
+        {
+            settings.halfFloat = true;
+            continue;
+        }
+        if (arg == "--cpu")
+        {
+            settings.cpu = true;
+            continue;
+        }
+
+        if (i + 1 >= argc)
+        {
+            std::cout << "Missing value for " << arg << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+
+        try
+        {
+            if (arg == "--scene")
+                settings.scenePath = value;
+            else if (arg == "--timeline")
+                settings.timelinePath = value;
+            else if (arg == "--output")
+                settings.outputPath = value;
+            else if (arg == "--width")
+                settings.extent.width = static_cast<uint32_t>(std::stoul(value));
+            else if (arg == "--height")
+                settings.extent.height = static_cast<uint32_t>(std::stoul(value));
+            else if (arg == "--spp")
+                settings.samplesPerPixel = static_cast<uint32_t>(std::stoul(value));
+            else if (arg == "--time")
+                settings.timeBudget = std::stod(value);
+            else if (arg == "--coordinator")
+                settings.coordinatorPort = static_cast<uint16_t>(std::stoul(value));
+            else if (arg == "--farm-local")
+                settings.localWorkers = static_cast<uint32_t>(std::stoul(value));
+            else if (arg == "--tile")
+                settings.tileSize = static_cast<uint32_t>(std::stoul(value));
+            else if (arg == "--job-spp")
+                settings.jobSamples = static_cast<uint32_t>(std::stoul(value));
+            else if (arg == "--devices")
+            {
+                if (value == "all")
+                {
+                    for (size_t device = 0; device < Core::EnumeratePhysicalDevices().size(); device++)
+                        settings.devices.push_back(static_cast<int32_t>(device));
+                }
+                else
+                {
+                    std::stringstream list(value);
+                    std::string device;
+                    while (std::getline(list, device, ','))
+                        settings.devices.push_back(std::stoi(device));
+                }
+            }
+            else if (arg == "--threads")
+                settings.threadCount = static_cast<uint32_t>(std::stoul(value));
+            else if (arg == "--profile")
+                settings.profilePath = value;
+            else if (arg == "--ray-stats")
+                settings.rayStatisticsPath = value;
+            else if (arg == "--merge-device")
+                settings.mergeDevice = static_cast<uint32_t>(std::stoul(value));
+            else
+            {
+                std::cout << "Unknown option " << arg << std::endl;
+                return false;
+            }
+        }
+        catch (const std::exception&)
+        {
+            std::cout << "Invalid value " << value << " for " << arg << std::endl;
+            return false;
+        }
+    }
+
+    if (settings.extent.width == 0 || settings.extent.height == 0)
+    {
+        std::cout << "Resolution must not be zero" << std::endl;
+        return false;
+    }
+    if (!settings.timelinePath.empty() && settings.timeBudget > 0.0)
+    {
+        std::cout << "Animations render a fixed sample count, use --spp instead of --time" << std::endl;
+        return false;
+    }
+    if (settings.localWorkers > 0 && settings.coordinatorPort == 0)
+        settings.coordinatorPort = 47000;
+    bool distributed = settings.coordinatorPort != 0 || !settings.devices.empty();
+    if (distributed && (!settings.timelinePath.empty() || settings.timeBudget > 0.0))
+    {
+        std::cout << "Distributed renders take a single image with --spp" << std::endl;
+        return false;
+    }
+    if (settings.cpu && (distributed || !settings.timelinePath.empty()))
+    {
+        std::cout << "--cpu renders single images in this process only" << std::endl;
+        return false;
+    }
+    if ((!settings.profilePath.empty() || !settings.rayStatisticsPath.empty()) && (settings.cpu || distributed || !settings.timelinePath.empty()))
+    {
+        std::cout << "--profile and --ray-stats measure single image GPU renders in this process only" << std::endl;
+        return false;
+    }
+    if (settings.coordinatorPort != 0 && settings.tileSize == 0)
+    {
+        std::cout << "Tile size must not be zero" << std::endl;
+        return false;
+    }
+    if (settings.samplesPerPixel == 0 && settings.timeBudget <= 0.0)
+        settings.samplesPerPixel = 256;
+
+    return true;
+}
+
+static int RunCpuBatch(const BatchSettings& settings, const Scene& scene)
+{
+    CpuPathTracer pathTracer(settings.extent.width, settings.extent.height, settings.threadCount);
+    SetSceneFrameData(scene, settings.extent, pathTracer.frameData);
+    pathTracer.SetScene(scene.spheres, scene.triangles, scene.meshes);
+
+    uint32_t targetDispatches = UINT32_MAX;
+    if (settings.samplesPerPixel > 0)
+        targetDispatches = (settings.samplesPerPixel + scene.raysPerPixel - 1) / scene.raysPerPixel;
+
+    // Single dispatches keep the time budget accurate, a dispatch is slow on the CPU
+    uint32_t renderedDispatches = 0;
+    auto startTime = std::chrono::high_resolution_clock::now();
+    while (renderedDispatches < targetDispatches)
+    {
+        if (settings.timeBudget > 0.0)
+        {
+            double elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+            if (elapsed >= settings.timeBudget)
+                break;
+        }
+
+        pathTracer.frameData.frameIndex = renderedDispatches + 1;
+        pathTracer.Dispatch();
+        renderedDispatches++;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+    std::vector<glm::vec4> pixels = pathTracer.GetAccumulation();
+    for (glm::vec4& pixel : pixels)
+        pixel = glm::vec4(glm::vec3(pixel) / static_cast<float>(std::max(renderedDispatches, 1u)), 1.0f);
+    if (!WriteImageLinear(settings.outputPath, settings.extent.width, settings.extent.height, &pixels[0].x, settings.halfFloat))
+    {
+        std::cout << "Failed to write " << settings.outputPath << std::endl;
+        return 1;
+    }
+
+    uint64_t samplesPerPixel = static_cast<uint64_t>(renderedDispatches) * scene.raysPerPixel;
+    uint64_t samples = samplesPerPixel * settings.extent.width * settings.extent.height;
+    std::cout << std::fixed << std::setprecision(2)
+        << "Rendered " << settings.extent.width << "x" << settings.extent.height << " at "
+        << samplesPerPixel << " spp to " << settings.outputPath << " in " << seconds << " s on "
+        << pathTracer.GetThreadCount() << " CPU threads" << std::endl
+        << "  samples:     " << samples << " (" << samples / seconds / 1e6 << " M samples/s)" << std::endl;
+    return 0;
+}
+
+int RunBatch(const BatchSettings& settings)
+{
+    Scene scene;
+    if (settings.scenePath.empty())
+        scene = CreateDefaultScene();
+    else if (!LoadScene(settings.scenePath, scene))
+        return 1;
+
+    if (settings.cpu)
+        return RunCpuBatch(settings, scene);
+
+    // No window and no swapchain, runs on render nodes and software devices like lavapipe
+    std::unique_ptr<Renderer> renderer = std::make_unique<Renderer>(nullptr, 2, VK_PRESENT_MODE_FIFO_KHR);
+
+    {
+        bool instrument = !settings.rayStatisticsPath.empty();
+        SpirvHelper::Init();
+        Shader computeShader("res/Shaders/Raytracing.comp", instrument ? RayCounters::GetShaderDefines() : std::vector<std::string>());
+        SpirvHelper::Finalize();
+
+        PathTracer pathTracer(settings.extent, computeShader.GetShaderStage());
+        SetSceneFrameData(scene, settings.extent, pathTracer.frameData);
+        pathTracer.SetScene(scene.spheres, scene.triangles, scene.meshes);
+
+        std::unique_ptr<RayCounters> rayCounters;
+        if (instrument)
+        {
+            rayCounters = std::make_unique<RayCounters>(renderer->GetInFlightImageCount());
+            pathTracer.SetCounterBuffer(rayCounters->GetBuffer());
+        }
+        uint32_t snapshotFrame = 0;
+
+        // Every dispatch adds raysPerPixel samples to each pixel
+        uint32_t targetDispatches = UINT32_MAX;
+        if (settings.samplesPerPixel > 0)
+            targetDispatches = (settings.samplesPerPixel + scene.raysPerPixel - 1) / scene.raysPerPixel;
+
+        GpuProfiler profiler(renderer->GetInFlightImageCount());
+        if (!settings.profilePath.empty() && !profiler.StartCapture(settings.profilePath))
+        {
+            std::cout << "Failed to open " << settings.profilePath << std::endl;
+            return 1;
+        }
+
+        // Several dispatches per submit keep the submission overhead low
+        const uint32_t dispatchesPerSubmit = 16;
+        uint32_t renderedDispatches = 0;
+        auto startTime = std::chrono::high_resolution_clock::now();
+        while (renderedDispatches < targetDispatches)
+        {
+            if (settings.timeBudget > 0.0)
+            {
+                double elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+                if (elapsed >= settings.timeBudget)
+                    break;
+            }
+
+            uint32_t dispatches = std::min(dispatchesPerSubmit, targetDispatches - renderedDispatches);
+            VkCommandBuffer cmd = renderer->BeginFrame();
+            profiler.BeginFrame(renderer->GetFrameIndex());
+            pathTracer.frameData.frameIndex = renderedDispatches + 1;
+            pathTracer.UpdateFrameData();
+            profiler.CmdBeginScope(cmd, "Accumulation");
+            pathTracer.CmdDispatch(cmd, dispatches);
+            profiler.CmdEndScope(cmd);
+            if (rayCounters)
+            {
+                snapshotFrame = renderer->GetFrameIndex();
+                rayCounters->CmdSnapshot(cmd, snapshotFrame);
+            }
+            renderer->EndFrame();
+            renderedDispatches += dispatches;
+        }
+        Core::Get()->WaitIdle();
+        double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+        // Hdr formats resolve the float accumulation image, png takes the 8 bit output image
+        std::string extension = std::filesystem::path(settings.outputPath).extension().string();
+        bool exr = extension == ".exr";
+        bool pfm = extension == ".pfm";
+        bool written = false;
+        if (exr || pfm)
+        {
+            SpirvHelper::Init();
+            Shader resolveShader("res/Shaders/Resolve.comp");
+            SpirvHelper::Finalize();
+            HdrResolve resolve(pathTracer.GetAccumulationImage(), resolveShader.GetShaderStage(), exr && settings.halfFloat);
+            ImageReadback readback(settings.extent, resolve.GetBytesPerPixel(), 1);
+
+            VkCommandBuffer cmd = renderer->BeginFrame();
+            profiler.BeginFrame(renderer->GetFrameIndex());
+            profiler.CmdBeginScope(cmd, "HDR resolve");
+            resolve.CmdResolve(cmd);
+            profiler.CmdEndScope(cmd);
+            profiler.CmdBeginScope(cmd, "Readback");
+            readback.CmdCaptureBuffer(cmd, resolve.GetBuffer()->GetHandle(), [&](const void* data, VkExtent2D extent) {
+                written = exr ? WriteImageEXR(settings.outputPath, extent.width, extent.height, data, resolve.IsHalfFloat())
+                    : WriteImagePFM(settings.outputPath, extent.width, extent.height, static_cast<const float*>(data));
+                });
+            profiler.CmdEndScope(cmd);
+            renderer->EndFrame();
+            readback.Flush();
+        }
+        else
+        {
+            ImageReadback readback(settings.extent, 4, 1);
+            VkCommandBuffer cmd = renderer->BeginFrame();
+            profiler.BeginFrame(renderer->GetFrameIndex());
+            profiler.CmdBeginScope(cmd, "Readback");
+            readback.CmdCapture(cmd, pathTracer.GetOutputImage()->GetHandle(), [&](const void* data, VkExtent2D extent) {
+                written = WriteImagePNG(settings.outputPath, extent.width, extent.height, static_cast<const uint8_t*>(data));
+                });
+            profiler.CmdEndScope(cmd);
+            renderer->EndFrame();
+            readback.Flush();
+        }
+        Core::Get()->WaitIdle();
+        profiler.Flush();
+        profiler.StopCapture();
+
+        if (!written)
+        {
+            std::cout << "Failed to write " << settings.outputPath << std::endl;
+            return 1;
+        }
+
+        uint64_t samplesPerPixel = static_cast<uint64_t>(renderedDispatches) * scene.raysPerPixel;
+        uint64_t samples = samplesPerPixel * settings.extent.width * settings.extent.height;
+        // A path stops at its first miss or when roulette ends it, so every sample traces between one and maxBounces rays
+        uint64_t maxRays = samples * std::max(scene.maxBounces, 1u);
+        std::cout << std::fixed << std::setprecision(2)
+            << "Rendered " << settings.extent.width << "x" << settings.extent.height << " at "
+            << samplesPerPixel << " spp to " << settings.outputPath << " in " << seconds << " s" << std::endl
+            << "  samples:     " << samples << " (" << samples / seconds / 1e6 << " M samples/s)" << std::endl
+            << "  rays traced: at most " << maxRays << " (" << maxRays / seconds / 1e6 << " M rays/s)" << std::endl;
+
+        if (!settings.profilePath.empty())
+        {
+            std::cout << "GPU time per scope, written to " << settings.profilePath << std::endl;
+            for (const GpuProfiler::ScopeStatistics& scope : profiler.GetStatistics())
+            {
+                std::cout << "  " << std::string(scope.depth * 2, ' ') << std::left << std::setw(14) << scope.name << std::right
+                    << scope.totalMs << " ms total, " << scope.totalMs / std::max<uint64_t>(scope.samples, 1) << " ms avg over "
+                    << scope.samples << " submits" << std::endl;
+            }
+        }
+
+        RayStatistics rayStatistics;
+        if (rayCounters && rayCounters->GetSnapshot(snapshotFrame, rayStatistics))
+        {
+            uint64_t rays = rayStatistics.GetRays();
+            uint64_t paths = std::max<uint64_t>(rayStatistics.primaryRays, 1);
+            std::cout << "Instrumented counters, written to " << settings.rayStatisticsPath << std::endl
+                << "  rays:        " << rays << " (" << rays / seconds / 1e6 << " M rays/s, "
+                << static_cast<double>(rays) / paths << " per path)" << std::endl
+                << "  per ray:     " << static_cast<double>(rayStatistics.triangleTests) / std::max<uint64_t>(rays, 1) << " triangle, "
+                << static_cast<double>(rayStatistics.boxTests) / std::max<uint64_t>(rays, 1) << " box, "
+                << static_cast<double>(rayStatistics.sphereTests) / std::max<uint64_t>(rays, 1) << " sphere tests" << std::endl
+                << "  escaped:     " << 100.0 * rayStatistics.escapedPaths / paths << " % of paths" << std::endl
+                << "  roulette:    " << 100.0 * rayStatistics.roulettePaths / paths << " % of paths ended, at most "
+                << static_cast<double>(rayStatistics.rouletteSkippedBounces) / paths << " rays saved per sample" << std::endl
+                << "  shadow rays: " << static_cast<double>(rayStatistics.shadowRays) / paths << " per sample" << std::endl
+                << "  path length:";
+            for (uint32_t i = 0; i < RayStatistics::PathLengthBins; i++)
+            {
+                if (rayStatistics.pathLengths[i] > 0)
+                    std::cout << " " << i + 1 << (i + 1 == RayStatistics::PathLengthBins ? "+: " : ": ") << 100.0 * rayStatistics.pathLengths[i] / paths << "%";
+            }
+            std::cout << std::endl;
+
+            if (!WriteRayStatistics(settings.rayStatisticsPath, rayStatistics, seconds))
+            {
+                std::cout << "Failed to write " << settings.rayStatisticsPath << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+int RunAnimation(const BatchSettings& settings)
+{
+    Timeline timeline;
+    if (!timeline.Load(settings.timelinePath))
+        return 1;
+
+    Scene scene;
+    if (settings.scenePath.empty())
+        scene = CreateDefaultScene();
+    else if (!LoadScene(settings.scenePath, scene))
+        return 1;
+
+    std::filesystem::path outputPath = settings.outputPath;
+    bool y4m = outputPath.extension() == ".y4m";
+    if (!y4m && outputPath.extension() != ".png")
+    {
+        std::cout << "Animations are written as .y4m or numbered .png" << std::endl;
+        return 1;
+    }
+    if (outputPath.has_parent_path())
+        std::filesystem::create_directories(outputPath.parent_path());
+
+    Y4MWriter video;
+    if (y4m && !video.Open(settings.outputPath, settings.extent.width, settings.extent.height, timeline.framesPerSecond))
+    {
+        std::cout << "Failed to open " << settings.outputPath << std::endl;
+        return 1;
+    }
+
+    std::unique_ptr<Renderer> renderer = std::make_unique<Renderer>(nullptr, 2, VK_PRESENT_MODE_FIFO_KHR);
+    // Scene buffers are rewritten after BeginFrame, that is only safe with a single frame in flight
+    assert(renderer->GetInFlightImageCount() == 1);
+
+    uint32_t frameCount = timeline.GetFrameCount();
+    uint32_t dispatchesPerFrame = (settings.samplesPerPixel + scene.raysPerPixel - 1) / scene.raysPerPixel;
+    std::atomic<uint32_t> failedFrames = 0;
+    auto startTime = std::chrono::high_resolution_clock::now();
+    {
+        SpirvHelper::Init();
+        Shader computeShader("res/Shaders/Raytracing.comp");
+        SpirvHelper::Finalize();
+
+        PathTracer pathTracer(settings.extent, computeShader.GetShaderStage());
+        pathTracer.SetScene(scene.spheres, scene.triangles, scene.meshes);
+        bool animatesSpheres = timeline.AnimatesSpheres();
+
+        // The video needs frames in order, so it gets a single encoder thread
+        uint32_t encoderThreads = y4m ? 1 : std::max(std::thread::hardware_concurrency() / 2, 1u);
+        ImageReadback readback(settings.extent, 4, 4, encoderThreads);
+
+        const uint32_t dispatchesPerSubmit = 16;
+        for (uint32_t frame = 0; frame < frameCount; frame++)
+        {
+            uint32_t renderedDispatches = 0;
+            while (renderedDispatches < dispatchesPerFrame)
+            {
+                uint32_t dispatches = std::min(dispatchesPerSubmit, dispatchesPerFrame - renderedDispatches);
+                VkCommandBuffer cmd = renderer->BeginFrame();
+                readback.Update();
+
+                if (renderedDispatches == 0)
+                {
+                    timeline.Apply(timeline.GetFrameTime(frame), scene);
+                    SetSceneFrameData(scene, settings.extent, pathTracer.frameData);
+                    if (animatesSpheres)
+                        pathTracer.UpdateSpheres(scene.spheres);
+                }
+                pathTracer.frameData.frameIndex = renderedDispatches + 1;
+                pathTracer.UpdateFrameData();
+                pathTracer.CmdDispatch(cmd, dispatches);
+                renderedDispatches += dispatches;
+
+                if (renderedDispatches == dispatchesPerFrame)
+                {
+                    ImageReadback::Callback callback;
+                    if (y4m)
+                    {
+                        callback = [&video, &failedFrames](const void* data, VkExtent2D extent) {
+                            if (!video.WriteFrame(static_cast<const uint8_t*>(data)))
+                                failedFrames++;
+                            };
+                    }
+                    else
+                    {
+                        char number[16];
+                        snprintf(number, sizeof(number), "_%05u", frame);
+                        std::filesystem::path path = outputPath;
+                        path.replace_filename(outputPath.stem().string() + number + outputPath.extension().string());
+                        callback = [path = path.string(), &failedFrames](const void* data, VkExtent2D extent) {
+                            if (!WriteImagePNG(path, extent.width, extent.height, static_cast<const uint8_t*>(data)))
+                                failedFrames++;
+                            };
+                    }
+
+                    // The encoders fell behind, wait for them instead of dropping a frame
+                    if (!readback.CmdCapture(cmd, pathTracer.GetOutputImage()->GetHandle(), callback))
+                    {
+                        readback.Flush();
+                        readback.CmdCapture(cmd, pathTracer.GetOutputImage()->GetHandle(), callback);
+                    }
+                }
+                renderer->EndFrame();
+            }
+        }
+
+        readback.Flush();
+        Core::Get()->WaitIdle();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+    if (failedFrames > 0)
+    {
+        std::cout << "Failed to write " << failedFrames.load() << " frames to " << settings.outputPath << std::endl;
+        return 1;
+    }
+    std::cout << std::fixed << std::setprecision(2)
+        << "Rendered " << frameCount << " frames at " << dispatchesPerFrame * scene.raysPerPixel << " spp to "
+        << settings.outputPath << " in " << seconds << " s (" << frameCount / seconds << " frames/s)" << std::endl;
+    return 0;
+}
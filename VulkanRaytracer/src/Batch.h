@@ -0,0 +1,47 @@
+#pragma once
+#include "Vulkan/VKHeaders.h"
+#include <string>
+#include <vector>
+
+/* Headless renders of a scene file, a single image or the	*/
+/* frames of a timeline, on Vulkan or on CpuPathTracer		*/
+struct BatchSettings
+{
+	std::string scenePath;
+	/* Renders an animation instead of a single image			*/
+	std::string timelinePath;
+	std::string outputPath = "output.png";
+	VkExtent2D extent = { 1280, 720 };
+	/* 0 renders until the time budget runs out					*/
+	uint32_t samplesPerPixel = 0;
+	/* Seconds, 0 means no limit								*/
+	double timeBudget = 0.0;
+	/* Half instead of float channels for .exr output			*/
+	bool halfFloat = false;
+	/* Distributes the render to worker processes when either	*/
+	/* is set													*/
+	uint16_t coordinatorPort = 0;
+	uint32_t localWorkers = 0;
+	uint32_t tileSize = 256;
+	uint32_t jobSamples = 0;
+	/* Renders on these devices in parallel when not empty		*/
+	std::vector<int32_t> devices;
+	uint32_t mergeDevice = 0;
+	/* Renders with CpuPathTracer instead of Vulkan				*/
+	bool cpu = false;
+	/* CPU threads, 0 uses every hardware thread				*/
+	uint32_t threadCount = 0;
+	/* GPU timings of every submit, .csv or Chrome trace .json	*/
+	std::string profilePath;
+	/* Renders with the instrumented shader and writes its		*/
+	/* counters as csv											*/
+	std::string rayStatisticsPath;
+};
+
+/* Reads the --render options, prints what is wrong with	*/
+/* them and returns false									*/
+bool ParseBatchSettings(int argc, char** argv, BatchSettings& settings);
+/* Renders one image to outputPath							*/
+int RunBatch(const BatchSettings& settings);
+/* Renders the frames of timelinePath to outputPath			*/
+int RunAnimation(const BatchSettings& settings);
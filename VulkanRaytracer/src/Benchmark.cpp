@@ -0,0 +1,158 @@
+#include "Benchmark.h"
+#include "PathTracer.h"
+#include "Scene.h"
+#include "LightTable.h"
+#include "Camera/CameraPath.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+static std::string JsonString(const std::string& text)
+{
+    std::string escaped = "\"";
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+            escaped += '\\';
+        escaped += c;
+    }
+    return escaped + "\"";
+}
+
+// Nearest rank of the sorted values
+static double Percentile(const std::vector<double>& sorted, double percentile)
+{
+    size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0 * sorted.size()));
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+static bool SameCamera(const CameraPathFrame& a, const CameraPathFrame& b)
+{
+    return a.position == b.position && a.yaw == b.yaw && a.pitch == b.pitch && a.fov == b.fov;
+}
+
+int RunBenchmark(const BenchmarkSettings& settings)
+{
+    CameraPath cameraPath;
+    if (!cameraPath.Load(settings.cameraPath))
+        return 1;
+
+    Scene scene;
+    if (settings.scenePath.empty())
+        scene = CreateDefaultScene();
+    else if (!LoadScene(settings.scenePath, scene))
+        return 1;
+
+    std::unique_ptr<Renderer> renderer = std::make_unique<Renderer>(nullptr, 2, VK_PRESENT_MODE_FIFO_KHR);
+    VkPhysicalDeviceProperties& properties = Core::Get()->GetPhysicalDeviceProperties();
+
+    std::vector<double> frameTimes;
+    std::vector<GpuProfiler::ScopeStatistics> passes;
+    {
+        SpirvHelper::Init();
+        Shader computeShader("res/Shaders/Raytracing.comp");
+        SpirvHelper::Finalize();
+
+        PathTracer pathTracer(settings.extent, computeShader.GetShaderStage());
+        FrameData& frameData = pathTracer.frameData;
+        SetSceneFrameData(scene, settings.extent, frameData);
+        pathTracer.SetScene(scene.spheres, scene.triangles, scene.meshes);
+        GpuProfiler profiler(renderer->GetInFlightImageCount());
+
+        // Every frame waits for the GPU so frame times do not depend on how far the CPU runs ahead
+        uint32_t frameCount = settings.warmupFrames + static_cast<uint32_t>(cameraPath.frames.size());
+        const CameraPathFrame* previousFrame = nullptr;
+        for (uint32_t frame = 0; frame < frameCount; frame++)
+        {
+            bool measured = frame >= settings.warmupFrames;
+            const CameraPathFrame& cameraFrame = cameraPath.frames[measured ? frame - settings.warmupFrames : 0];
+
+            // Accumulation restarts when the camera moves like in the window, and once more when
+            // the measurement starts so the seeds do not depend on the warmup frame count
+            bool restart = frame == settings.warmupFrames || !previousFrame || !SameCamera(cameraFrame, *previousFrame);
+            previousFrame = &cameraFrame;
+            frameData.frameIndex = restart ? 1 : frameData.frameIndex + settings.dispatchesPerFrame;
+            CameraPath::ApplyFrame(cameraFrame, settings.extent, frameData);
+
+            auto startTime = std::chrono::high_resolution_clock::now();
+            VkCommandBuffer cmd = renderer->BeginFrame();
+            profiler.BeginFrame(renderer->GetFrameIndex());
+            uint64_t frameNumber = renderer->GetFrameNumber();
+            pathTracer.UpdateFrameData();
+            if (measured)
+                profiler.CmdBeginScope(cmd, "Accumulation");
+            pathTracer.CmdDispatch(cmd, settings.dispatchesPerFrame);
+            if (measured)
+                profiler.CmdEndScope(cmd);
+            renderer->EndFrame();
+            renderer->WaitForFrame(frameNumber);
+
+            if (measured)
+                frameTimes.push_back(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count());
+        }
+        Core::Get()->WaitIdle();
+        profiler.Flush();
+        passes = profiler.GetStatistics();
+    }
+
+    std::vector<double> sorted = frameTimes;
+    std::sort(sorted.begin(), sorted.end());
+    double totalMs = 0.0;
+    for (double ms : frameTimes)
+        totalMs += ms;
+    double meanMs = totalMs / frameTimes.size();
+    double samples = static_cast<double>(frameTimes.size()) * settings.dispatchesPerFrame * scene.raysPerPixel
+        * settings.extent.width * settings.extent.height;
+    double samplesPerSecond = samples / (totalMs / 1000.0);
+
+    std::ofstream file(settings.outputPath);
+    if (!file.is_open())
+    {
+        std::cout << "Failed to write " << settings.outputPath << std::endl;
+        return 1;
+    }
+
+    // Everything that changes the workload is part of the report, runs compare when these match
+    file << std::fixed << std::setprecision(4) << "{\n"
+        << "  \"device\": " << JsonString(properties.deviceName) << ",\n"
+        << "  \"driver_version\": " << properties.driverVersion << ",\n"
+        << "  \"scene\": " << JsonString(settings.scenePath.empty() ? "default" : settings.scenePath) << ",\n"
+        << "  \"camera_path\": " << JsonString(settings.cameraPath) << ",\n"
+        << "  \"width\": " << settings.extent.width << ",\n"
+        << "  \"height\": " << settings.extent.height << ",\n"
+        << "  \"rays_per_pixel\": " << scene.raysPerPixel << ",\n"
+        << "  \"max_bounces\": " << scene.maxBounces << ",\n"
+        << "  \"roulette_depth\": " << scene.rouletteDepth << ",\n"
+        << "  \"light_sampling\": " << (scene.lightSampling ? "true" : "false") << ",\n"
+        << "  \"sampler\": " << (scene.sampler == SamplerType::Sobol ? "\"sobol\"" : "\"pcg\"") << ",\n"
+        << "  \"adaptive_threshold\": " << scene.adaptiveThreshold << ",\n"
+        << "  \"lights\": " << CollectLights(scene.spheres, scene.triangles, scene.meshes).size() << ",\n"
+        << "  \"dispatches_per_frame\": " << settings.dispatchesPerFrame << ",\n"
+        << "  \"warmup_frames\": " << settings.warmupFrames << ",\n"
+        << "  \"frames\": " << frameTimes.size() << ",\n"
+        << "  \"frame_time_ms\": { \"mean\": " << meanMs << ", \"p50\": " << Percentile(sorted, 50.0)
+        << ", \"p95\": " << Percentile(sorted, 95.0) << ", \"p99\": " << Percentile(sorted, 99.0)
+        << ", \"min\": " << sorted.front() << ", \"max\": " << sorted.back() << " },\n"
+        << "  \"samples_per_second\": " << samplesPerSecond << ",\n"
+        << "  \"gpu_ms_per_pass\": {";
+    for (size_t i = 0; i < passes.size(); i++)
+    {
+        file << (i == 0 ? " " : ", ") << JsonString(passes[i].name) << ": "
+            << passes[i].totalMs / std::max<uint64_t>(passes[i].samples, 1);
+    }
+    file << " }\n}\n";
+    file.close();
+
+    std::cout << std::fixed << std::setprecision(2)
+        << "Benchmarked " << frameTimes.size() << " frames of " << settings.cameraPath << " on " << properties.deviceName << std::endl
+        << "  frame time:  mean " << meanMs << " ms, p50 " << Percentile(sorted, 50.0) << " ms, p95 " << Percentile(sorted, 95.0)
+        << " ms, p99 " << Percentile(sorted, 99.0) << " ms" << std::endl
+        << "  samples:     " << samplesPerSecond / 1e6 << " M samples/s" << std::endl;
+    for (const GpuProfiler::ScopeStatistics& pass : passes)
+        std::cout << "  " << std::left << std::setw(13) << pass.name + ":" << std::right << pass.totalMs / std::max<uint64_t>(pass.samples, 1) << " ms GPU" << std::endl;
+    std::cout << "Wrote " << settings.outputPath << std::endl;
+    return 0;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include "Vulkan/VKHeaders.h"
+#include <string>
+
+/* Replays a recorded camera path headless with fixed seeds	*/
+/* and reports frame time percentiles, samples per second	*/
+/* and GPU time per pass as JSON							*/
+struct BenchmarkSettings
+{
+	std::string cameraPath;
+	/* The default scene if empty								*/
+	std::string scenePath;
+	std::string outputPath = "benchmark.json";
+	VkExtent2D extent = { 1280, 720 };
+	uint32_t dispatchesPerFrame = 1;
+	/* Frames of the first camera frame rendered before the		*/
+	/* measured ones, they warm up clocks and caches			*/
+	uint32_t warmupFrames = 10;
+};
+
+int RunBenchmark(const BenchmarkSettings& settings);
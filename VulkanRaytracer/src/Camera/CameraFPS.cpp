@@ -85,4 +85,28 @@ void CameraFPS::Update(double deltaTime)
         view = glm::lookAtLH(position, position + forward, up);
         inverseView = glm::inverse(view);
     }
+}
+
+void CameraFPS::SetState(const glm::vec3& position, float yaw, float pitch, float fov)
+{
+    moved = position != this->position || yaw != this->yaw || pitch != this->pitch || fov != this->fov;
+    this->position = position;
+    this->yaw = yaw;
+    this->pitch = pitch;
+    this->fov = fov;
+
+    forward = glm::normalize(glm::vec3{
+        cos(glm::radians(yaw)) * cos(glm::radians(pitch)),
+        sin(glm::radians(pitch)),
+        sin(glm::radians(yaw)) * cos(glm::radians(pitch))
+        });
+    right = glm::cross(forward, up);
+
+    int windowWidth;
+    int windowHeight;
+    glfwGetWindowSize(window, &windowWidth, &windowHeight);
+    view = glm::lookAtLH(position, position + forward, up);
+    projection = glm::perspectiveFov(fov, (float)windowWidth, (float)windowHeight, nearPlane, farPlane);
+    inverseProjection = glm::inverse(projection);
+    inverseView = glm::inverse(view);
 }
\ No newline at end of file
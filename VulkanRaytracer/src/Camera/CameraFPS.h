@@ -9,6 +9,9 @@ public:
 	~CameraFPS();
 
 	void Update(double deltaTime);
+	/* Replaces input for a frame, used to play a CameraPath	*/
+	/* moved is only set when the state changed				*/
+	void SetState(const glm::vec3& position, float yaw, float pitch, float fov);
 
 	float theta = 0.0f;
 	float phi = 0.0f;
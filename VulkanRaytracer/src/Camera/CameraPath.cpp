@@ -0,0 +1,81 @@
+#include "CameraPath.h"
+#include "CameraFPS.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+void CameraPath::Record(const CameraFPS& camera, float time)
+{
+    frames.push_back({ time, camera.position, camera.yaw, camera.pitch, camera.fov });
+}
+
+bool CameraPath::Save(const std::string& filePath) const
+{
+    std::ofstream file(filePath);
+    if (!file.is_open())
+        return false;
+
+    // Enough digits that a loaded path replays the exact same rays
+    file << "# time x y z yaw pitch fov\n" << std::setprecision(9);
+    for (const CameraPathFrame& frame : frames)
+    {
+        file << frame.time << " " << frame.position.x << " " << frame.position.y << " " << frame.position.z << " "
+            << frame.yaw << " " << frame.pitch << " " << frame.fov << "\n";
+    }
+    return static_cast<bool>(file);
+}
+
+bool CameraPath::Load(const std::string& filePath)
+{
+    std::ifstream file(filePath);
+    if (!file.is_open())
+    {
+        std::cout << "Failed to open camera path " << filePath << std::endl;
+        return false;
+    }
+
+    frames.clear();
+    std::string line;
+    uint32_t lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+            continue;
+
+        std::istringstream stream(line);
+        CameraPathFrame frame;
+        if (!(stream >> frame.time >> frame.position.x >> frame.position.y >> frame.position.z >> frame.yaw >> frame.pitch >> frame.fov))
+        {
+            std::cout << filePath << ":" << lineNumber << ": invalid camera frame" << std::endl;
+            return false;
+        }
+        frames.push_back(frame);
+    }
+
+    if (frames.empty())
+    {
+        std::cout << filePath << ": no camera frames" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void CameraPath::ApplyFrame(const CameraPathFrame& frame, VkExtent2D extent, FrameData& frameData)
+{
+    glm::vec3 up = { 0.0f, 1.0f, 0.0f };
+    glm::vec3 forward = glm::normalize(glm::vec3{
+        cos(glm::radians(frame.yaw)) * cos(glm::radians(frame.pitch)),
+        sin(glm::radians(frame.pitch)),
+        sin(glm::radians(frame.yaw)) * cos(glm::radians(frame.pitch))
+        });
+
+    frameData.cameraInverseProjection = glm::inverse(glm::perspectiveFov(frame.fov, (float)extent.width, (float)extent.height, 0.1f, 1000.0f));
+    frameData.cameraInverseView = glm::inverse(glm::lookAtLH(frame.position, frame.position + forward, up));
+    frameData.cameraPos = glm::vec4(frame.position, 0);
+    frameData.cameraDirection = glm::vec4(forward, 0);
+}
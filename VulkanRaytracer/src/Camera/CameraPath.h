@@ -0,0 +1,33 @@
+#pragma once
+#include "../Vulkan/VKHeaders.h"
+#include "../RayTracingStructs.h"
+
+class CameraFPS;
+
+/* CameraFPS state of one presented frame					*/
+struct CameraPathFrame
+{
+	/* Seconds since the recording started					*/
+	float time;
+	glm::vec3 position;
+	float yaw;
+	float pitch;
+	float fov;
+};
+
+/* Recorded camera movement, replayed frame by frame so a	*/
+/* playback does not depend on the frame rate				*/
+/* Text format, one frame per line, # starts a comment		*/
+/*   time x y z yaw pitch fov									*/
+class CameraPath
+{
+public:
+	void Record(const CameraFPS& camera, float time);
+	bool Save(const std::string& filePath) const;
+	bool Load(const std::string& filePath);
+
+	/* Same matrices as CameraFPS builds for the frame			*/
+	static void ApplyFrame(const CameraPathFrame& frame, VkExtent2D extent, FrameData& frameData);
+
+	std::vector<CameraPathFrame> frames;
+};
@@ -0,0 +1,966 @@
+#include "CpuPathTracer.h"
+#include "Simd.h"
+#include "../LightTable.h"
+#include <cmath>
+#include <algorithm>
+
+// Tiles are a multiple of the packet width wide
+static const uint32_t TileWidth = 16;
+static const uint32_t TileHeight = 8;
+static const uint32_t PacketWidth = 4;
+static const float FloatMax = 3.402823466e+38f;
+// Dimension layout of a bounce, see SAMPLER_ in the shader
+static const uint32_t SamplerBounceDimensions = 16;
+static const uint32_t SamplerDirection = 0;
+static const uint32_t SamplerEnvironment = 4;
+static const uint32_t SamplerEmitter = 8;
+static const uint32_t SamplerRoulette = 12;
+// Fixed point the deviation sum of Adaptive.comp is kept in
+static const float AdaptiveDeviationScale = 4096.0f;
+static const float AdaptiveMaxDeviation = 1024.0f;
+
+struct CpuPathTracer::HitInfo
+{
+    bool didHit;
+    glm::vec3 hitPos;
+    glm::vec3 hitNormal;
+    const Material* material;
+    // Index of the hit sphere or triangle, the other one is -1
+    int32_t sphereIndex;
+    int32_t triangleIndex;
+};
+
+// Random numbers of one sample, see Rng in the shader
+struct CpuPathTracer::Rng
+{
+    uint32_t state;
+    uint32_t seed;
+    uint32_t index;
+    uint32_t dimension;
+
+    void SetBounceDimension(uint32_t offset)
+    {
+        dimension = dimension / SamplerBounceDimensions * SamplerBounceDimensions + offset;
+    }
+};
+
+// Rays of four neighbouring pixels, traced together through one sample each
+struct CpuPathTracer::Packet
+{
+    glm::vec3 origin[PacketWidth];
+    glm::vec3 direction[PacketWidth];
+    glm::vec3 rayColor[PacketWidth];
+    glm::vec3 incomingLight[PacketWidth];
+    Rng rng[PacketWidth];
+    bool active[PacketWidth];
+};
+
+// One shadow ray per lane, light reaches the lane unless something lies closer than maxDistance
+struct CpuPathTracer::ShadowPacket
+{
+    glm::vec3 origin[PacketWidth];
+    glm::vec3 direction[PacketWidth];
+    float maxDistance[PacketWidth];
+    glm::vec3 light[PacketWidth];
+    bool active[PacketWidth];
+};
+
+// Direction numbers of the first four Sobol dimensions, same as the shader
+static const uint32_t SobolDirections[128] = {
+    0x80000000u, 0x40000000u, 0x20000000u, 0x10000000u, 0x08000000u, 0x04000000u, 0x02000000u, 0x01000000u,
+    0x00800000u, 0x00400000u, 0x00200000u, 0x00100000u, 0x00080000u, 0x00040000u, 0x00020000u, 0x00010000u,
+    0x00008000u, 0x00004000u, 0x00002000u, 0x00001000u, 0x00000800u, 0x00000400u, 0x00000200u, 0x00000100u,
+    0x00000080u, 0x00000040u, 0x00000020u, 0x00000010u, 0x00000008u, 0x00000004u, 0x00000002u, 0x00000001u,
+    0x80000000u, 0xc0000000u, 0xa0000000u, 0xf0000000u, 0x88000000u, 0xcc000000u, 0xaa000000u, 0xff000000u,
+    0x80800000u, 0xc0c00000u, 0xa0a00000u, 0xf0f00000u, 0x88880000u, 0xcccc0000u, 0xaaaa0000u, 0xffff0000u,
+    0x80008000u, 0xc000c000u, 0xa000a000u, 0xf000f000u, 0x88008800u, 0xcc00cc00u, 0xaa00aa00u, 0xff00ff00u,
+    0x80808080u, 0xc0c0c0c0u, 0xa0a0a0a0u, 0xf0f0f0f0u, 0x88888888u, 0xccccccccu, 0xaaaaaaaau, 0xffffffffu,
+    0x80000000u, 0xc0000000u, 0x60000000u, 0x90000000u, 0xe8000000u, 0x5c000000u, 0x8e000000u, 0xc5000000u,
+    0x68800000u, 0x9cc00000u, 0xee600000u, 0x55900000u, 0x80680000u, 0xc09c0000u, 0x60ee0000u, 0x90550000u,
+    0xe8808000u, 0x5cc0c000u, 0x8e606000u, 0xc5909000u, 0x6868e800u, 0x9c9c5c00u, 0xeeee8e00u, 0x5555c500u,
+    0x8000e880u, 0xc0005cc0u, 0x60008e60u, 0x9000c590u, 0xe8006868u, 0x5c009c9cu, 0x8e00eeeeu, 0xc5005555u,
+    0x80000000u, 0xc0000000u, 0x20000000u, 0x50000000u, 0xf8000000u, 0x74000000u, 0xa2000000u, 0x93000000u,
+    0xd8800000u, 0x25400000u, 0x59e00000u, 0xe6d00000u, 0x78080000u, 0xb40c0000u, 0x82020000u, 0xc3050000u,
+    0x208f8000u, 0x51474000u, 0xfbea2000u, 0x75d93000u, 0xa0858800u, 0x914e5400u, 0xdbe79e00u, 0x25db6d00u,
+    0x58800080u, 0xe54000c0u, 0x79e00020u, 0xb6d00050u, 0x800800f8u, 0xc00c0074u, 0x200200a2u, 0x50050093u
+};
+
+static uint32_t Hash(uint32_t x)
+{
+    uint32_t state = x * 747796405u + 2891336453u;
+    uint32_t word = ((state >> ((state >> 28) + 4)) ^ state) * 277803737u;
+    return (word >> 22) ^ word;
+}
+
+static uint32_t ReverseBits(uint32_t x)
+{
+    x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+    x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+    x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+    x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+    return (x >> 16) | (x << 16);
+}
+
+static uint32_t NestedUniformScramble(uint32_t x, uint32_t seed)
+{
+    x = ReverseBits(x);
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return ReverseBits(x);
+}
+
+static uint32_t Sobol(uint32_t index, uint32_t dimension)
+{
+    uint32_t result = 0;
+    for (uint32_t bit = 0; index != 0; bit++, index >>= 1)
+    {
+        if (index & 1)
+            result ^= SobolDirections[dimension * 32 + bit];
+    }
+    return result;
+}
+
+float CpuPathTracer::RandomValue(Rng& rng)
+{
+    if (frameData.samplerType == static_cast<uint32_t>(SamplerType::Pcg))
+    {
+        rng.state = rng.state * 747796405u + 2891336453u;
+        uint32_t result = ((rng.state >> ((rng.state >> 28) + 4)) ^ rng.state) * 277803737u;
+        result = (result >> 22) ^ result;
+        return static_cast<float>(result) / 4294967295.0f;
+    }
+
+    uint32_t seed = Hash(rng.seed ^ Hash(rng.dimension / 4));
+    uint32_t index = NestedUniformScramble(rng.index, seed);
+    uint32_t dimension = rng.dimension % 4;
+    uint32_t value = NestedUniformScramble(Sobol(index, dimension), Hash(seed + dimension + 1));
+    rng.dimension++;
+    return static_cast<float>(value >> 8) / 16777216.0f;
+}
+
+static const float Pi = 3.14159265f;
+
+static float PowerHeuristic(float pdf, float otherPdf)
+{
+    float pdf2 = pdf * pdf;
+    float otherPdf2 = otherPdf * otherPdf;
+    return pdf2 + otherPdf2 > 0.0f ? pdf2 / (pdf2 + otherPdf2) : 0.0f;
+}
+
+static void Basis(const glm::vec3& axis, glm::vec3& tangent, glm::vec3& bitangent)
+{
+    tangent = glm::normalize(glm::cross(std::abs(axis.y) < 0.999f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f), axis));
+    bitangent = glm::cross(axis, tangent);
+}
+
+static glm::vec3 ConeDirection(const glm::vec3& axis, float cosTheta, float phi)
+{
+    glm::vec3 tangent, bitangent;
+    Basis(axis, tangent, bitangent);
+    float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+    return glm::normalize(axis * cosTheta + (tangent * std::cos(phi) + bitangent * std::sin(phi)) * sinTheta);
+}
+
+// Lambertian and GGX lobes picked by smoothness, see the BSDF functions in the shader
+static float GgxAlpha(float smoothness)
+{
+    float roughness = 1.0f - smoothness;
+    return std::max(roughness * roughness, 1e-3f);
+}
+
+static float GgxD(float cosHalf, float alpha)
+{
+    float alpha2 = alpha * alpha;
+    float d = cosHalf * cosHalf * (alpha2 - 1.0f) + 1.0f;
+    return alpha2 / (Pi * d * d);
+}
+
+static float GgxLambda(float cosTheta, float alpha)
+{
+    float cos2 = cosTheta * cosTheta;
+    float tan2 = std::max(1.0f - cos2, 0.0f) / cos2;
+    return (std::sqrt(1.0f + alpha * alpha * tan2) - 1.0f) * 0.5f;
+}
+
+static float EvaluateBsdf(const glm::vec3& normal, const glm::vec3& outgoing, float smoothness, const glm::vec3& direction)
+{
+    float cosIn = glm::dot(normal, direction);
+    if (cosIn <= 0.0f || smoothness >= 1.0f)
+        return 0.0f;
+    float cosOut = std::max(glm::dot(normal, outgoing), 1e-6f);
+    float alpha = GgxAlpha(smoothness);
+    float cosHalf = glm::dot(normal, glm::normalize(outgoing + direction));
+    float specular = GgxD(cosHalf, alpha) / (4.0f * cosOut * (1.0f + GgxLambda(cosOut, alpha) + GgxLambda(cosIn, alpha)));
+    return (1.0f - smoothness) * cosIn / Pi + smoothness * specular;
+}
+
+static float BsdfPdf(const glm::vec3& normal, const glm::vec3& outgoing, float smoothness, const glm::vec3& direction)
+{
+    float cosIn = glm::dot(normal, direction);
+    if (cosIn <= 0.0f || smoothness >= 1.0f)
+        return 0.0f;
+    float cosOut = std::max(glm::dot(normal, outgoing), 1e-6f);
+    float alpha = GgxAlpha(smoothness);
+    float cosHalf = glm::dot(normal, glm::normalize(outgoing + direction));
+    float specular = GgxD(cosHalf, alpha) / (4.0f * cosOut * (1.0f + GgxLambda(cosOut, alpha)));
+    return (1.0f - smoothness) * cosIn / Pi + smoothness * specular;
+}
+
+static glm::vec3 SampleBsdf(const glm::vec3& normal, const glm::vec3& outgoing, float smoothness, const glm::vec3& u, float& weight)
+{
+    if (smoothness >= 1.0f)
+    {
+        weight = 1.0f;
+        return glm::reflect(-outgoing, normal);
+    }
+
+    glm::vec3 tangent, bitangent;
+    Basis(normal, tangent, bitangent);
+    glm::vec3 direction;
+    if (u.x >= smoothness)
+    {
+        float radius = std::sqrt(u.y);
+        float phi = u.z * 2.0f * Pi;
+        direction = (tangent * std::cos(phi) + bitangent * std::sin(phi)) * radius + normal * std::sqrt(std::max(0.0f, 1.0f - u.y));
+    }
+    else
+    {
+        float alpha = GgxAlpha(smoothness);
+        glm::vec3 local = glm::vec3(glm::dot(outgoing, tangent), glm::dot(outgoing, bitangent), glm::dot(outgoing, normal));
+        glm::vec3 stretched = glm::normalize(glm::vec3(local.x * alpha, local.y * alpha, local.z));
+        float phi = u.y * 2.0f * Pi;
+        float z = (1.0f - u.z) * (1.0f + stretched.z) - stretched.z;
+        float sinTheta = std::sqrt(std::min(std::max(1.0f - z * z, 0.0f), 1.0f));
+        glm::vec3 halfVector = stretched + glm::vec3(sinTheta * std::cos(phi), sinTheta * std::sin(phi), z);
+        halfVector = glm::normalize(glm::vec3(halfVector.x * alpha, halfVector.y * alpha, halfVector.z));
+        direction = glm::reflect(-outgoing, tangent * halfVector.x + bitangent * halfVector.y + normal * halfVector.z);
+    }
+
+    float pdf = BsdfPdf(normal, outgoing, smoothness, direction);
+    weight = pdf > 0.0f ? EvaluateBsdf(normal, outgoing, smoothness, direction) / pdf : 0.0f;
+    return direction;
+}
+
+static float SphereConePdf(const glm::vec3& origin, const Sphere& sphere)
+{
+    glm::vec3 toCenter = sphere.center - origin;
+    float distanceSquared = glm::dot(toCenter, toCenter);
+    float radiusSquared = sphere.radius * sphere.radius;
+    if (distanceSquared <= radiusSquared)
+        return 0.0f;
+    float cosThetaMax = std::sqrt(1.0f - radiusSquared / distanceSquared);
+    return 1.0f / (2.0f * Pi * (1.0f - cosThetaMax));
+}
+
+// Distance to the front of the sphere like RaySphere, negative on a miss
+static float RaySphere(const glm::vec3& origin, const glm::vec3& direction, const Sphere& sphere)
+{
+    glm::vec3 offsetRayOrigin = origin - sphere.center;
+    float a = glm::dot(direction, direction);
+    float b = 2.0f * glm::dot(offsetRayOrigin, direction);
+    float c = glm::dot(offsetRayOrigin, offsetRayOrigin) - sphere.radius * sphere.radius;
+    float discriminant = b * b - 4.0f * a * c;
+    if (discriminant < 0.0f)
+        return -1.0f;
+    float dst = (-b - std::sqrt(discriminant)) / (2.0f * a);
+    return dst > 0.0001f ? dst : -1.0f;
+}
+
+static float Smoothstep(float edge0, float edge1, float x)
+{
+    float t = std::clamp((x - edge0) / (edge1 - edge0), 0.0f, 1.0f);
+    return t * t * (3.0f - 2.0f * t);
+}
+
+// Standard deviation of the sample luminance, clamped like in Adaptive.comp
+static float AdaptiveDeviation(const glm::vec4& statistics)
+{
+    float count = statistics.x;
+    float variance = count > 1.0f ? statistics.z / (count - 1.0f) : 0.0f;
+    return std::min(std::sqrt(std::max(variance, 0.0f)), AdaptiveMaxDeviation);
+}
+
+// True when adaptive sampling leaves the pixel out of the next dispatch, same budget as Adaptive.comp
+static bool AdaptiveConverged(const glm::vec4& statistics, float meanDeviation, const FrameData& frameData)
+{
+    float threshold = frameData.adaptiveThreshold;
+    float budget = AdaptiveDeviation(statistics) * meanDeviation / (threshold * threshold);
+    return statistics.x >= std::max(static_cast<float>(frameData.adaptiveMinSamples), budget);
+}
+
+static Vec3x4 Broadcast(const glm::vec3& v)
+{
+    return { Float4(v.x), Float4(v.y), Float4(v.z) };
+}
+
+CpuPathTracer::CpuPathTracer(uint32_t width, uint32_t height, uint32_t threadCount)
+    : _threadPool(threadCount)
+{
+    _width = width;
+    _height = height;
+    _tilesX = (width + TileWidth - 1) / TileWidth;
+    _tilesY = (height + TileHeight - 1) / TileHeight;
+    _accumulation.resize(static_cast<size_t>(width) * height, glm::vec4(0.0f));
+    _statistics.resize(static_cast<size_t>(width) * height, glm::vec4(0.0f));
+
+    frameData = {};
+    frameData.window.x = static_cast<float>(width);
+    frameData.window.y = static_cast<float>(height);
+}
+
+CpuPathTracer::~CpuPathTracer()
+{
+
+}
+
+void CpuPathTracer::SetScene(const std::vector<Sphere>& spheres, const std::vector<Triangle>& triangles, const std::vector<Mesh>& meshes)
+{
+    _spheres = spheres;
+    _triangles = triangles;
+    _meshes = meshes;
+    frameData.sphereNumber = static_cast<uint32_t>(spheres.size());
+    frameData.meshNumber = static_cast<uint32_t>(meshes.size());
+    _lights = CollectLights(spheres, triangles, meshes);
+    frameData.lightPower = BuildAliasTable(_lights);
+    frameData.lightNumber = static_cast<uint32_t>(_lights.size());
+}
+
+void CpuPathTracer::Dispatch(uint32_t dispatchCount)
+{
+    UpdateEnvironment();
+    if (frameData.adaptiveThreshold <= 0.0f)
+    {
+        _threadPool.ParallelFor(_tilesX * _tilesY, [&](uint32_t tileIndex) {
+            RenderTile(tileIndex, frameData.frameIndex, dispatchCount);
+            });
+        return;
+    }
+
+    // The sample budget depends on the whole image, it is updated between dispatches like on the GPU
+    for (uint32_t dispatch = 0; dispatch < dispatchCount; dispatch++)
+    {
+        _meanDeviation = MeanDeviation();
+        _threadPool.ParallelFor(_tilesX * _tilesY, [&](uint32_t tileIndex) {
+            RenderTile(tileIndex, frameData.frameIndex + dispatch, 1);
+            });
+    }
+}
+
+float CpuPathTracer::MeanDeviation()
+{
+    // Truncated to the same fixed point as the sum in Adaptive.comp
+    uint64_t sum = 0;
+    for (const glm::vec4& statistics : _statistics)
+        sum += static_cast<uint64_t>(AdaptiveDeviation(statistics) * AdaptiveDeviationScale);
+    return static_cast<float>(static_cast<double>(sum) / AdaptiveDeviationScale / _statistics.size());
+}
+
+void CpuPathTracer::RenderTile(uint32_t tileIndex, uint32_t firstFrameIndex, uint32_t dispatchCount)
+{
+    uint32_t tileX = (tileIndex % _tilesX) * TileWidth;
+    uint32_t tileY = (tileIndex / _tilesX) * TileHeight;
+    float width = frameData.window.x;
+    float height = frameData.window.y;
+
+    bool adaptive = frameData.adaptiveThreshold > 0.0f;
+    uint32_t uniformDispatches = (frameData.adaptiveMinSamples + frameData.raysPerPixel - 1) / std::max(frameData.raysPerPixel, 1u);
+
+    Packet packet;
+    glm::vec3 primaryDirection[PacketWidth];
+    for (uint32_t y = tileY; y < std::min(tileY + TileHeight, _height); y++)
+    {
+        for (uint32_t x0 = tileX; x0 < std::min(tileX + TileWidth, _width); x0 += PacketWidth)
+        {
+            for (uint32_t lane = 0; lane < PacketWidth; lane++)
+            {
+                uint32_t x = x0 + lane;
+                glm::vec2 coord = glm::vec2(x / width, y / height) * 2.0f - 1.0f;
+                glm::vec4 rayTarget = frameData.cameraInverseProjection * glm::vec4(coord, 1.0f, 1.0f);
+                primaryDirection[lane] = glm::vec3(frameData.cameraInverseView * glm::vec4(glm::normalize(glm::vec3(rayTarget) / rayTarget.w), 0.0f));
+            }
+
+            for (uint32_t dispatch = 0; dispatch < dispatchCount; dispatch++)
+            {
+                uint32_t frameIndex = firstFrameIndex + dispatch;
+                size_t first = static_cast<size_t>(y) * _width + x0;
+                glm::vec3 incomingLight[PacketWidth] = {};
+                // Lanes adaptive sampling leaves out repeat their mean like in Adaptive.comp
+                bool compacted = adaptive && frameIndex > std::max(uniformDispatches, 1u);
+                bool traced[PacketWidth];
+                bool anyTraced = false;
+                for (uint32_t lane = 0; lane < PacketWidth; lane++)
+                {
+                    uint32_t pixelIndex = static_cast<uint32_t>((x0 + lane) + width * y);
+                    packet.rng[lane].state = pixelIndex + (frameIndex + frameData.seedOffset) * 719393u;
+                    packet.rng[lane].seed = Hash(pixelIndex);
+                    traced[lane] = x0 + lane < _width && !(compacted && AdaptiveConverged(_statistics[first + lane], _meanDeviation, frameData));
+                    anyTraced |= traced[lane];
+                    if (adaptive && traced[lane] && frameIndex == 1)
+                        _statistics[first + lane] = glm::vec4(0.0f);
+                }
+
+                for (uint32_t k = 0; k < frameData.raysPerPixel && anyTraced; k++)
+                {
+                    for (uint32_t lane = 0; lane < PacketWidth; lane++)
+                    {
+                        packet.rng[lane].state += k;
+                        packet.rng[lane].index = (frameIndex - 1 + frameData.seedOffset) * frameData.raysPerPixel + k;
+                        packet.rng[lane].dimension = 0;
+                        packet.origin[lane] = glm::vec3(frameData.cameraPos);
+                        packet.direction[lane] = primaryDirection[lane];
+                        packet.active[lane] = traced[lane];
+                    }
+                    TracePacket(packet);
+                    for (uint32_t lane = 0; lane < PacketWidth; lane++)
+                    {
+                        incomingLight[lane] += packet.incomingLight[lane];
+                        if (adaptive && traced[lane])
+                        {
+                            // Welford update with the luminance of the sample
+                            glm::vec4& statistics = _statistics[first + lane];
+                            glm::vec3 light = packet.incomingLight[lane];
+                            float luminance = 0.2126f * light.x + 0.7152f * light.y + 0.0722f * light.z;
+                            statistics.x += 1.0f;
+                            float delta = luminance - statistics.y;
+                            statistics.y += delta / statistics.x;
+                            statistics.z += delta * (luminance - statistics.y);
+                        }
+                    }
+                }
+
+                for (uint32_t lane = 0; lane < PacketWidth && x0 + lane < _width; lane++)
+                {
+                    // Alpha counts the dispatches like in the shader
+                    glm::vec4& accumulated = _accumulation[first + lane];
+                    if (!traced[lane])
+                    {
+                        accumulated = glm::vec4(glm::vec3(accumulated) + glm::vec3(accumulated) / accumulated.w, accumulated.w + 1.0f);
+                        continue;
+                    }
+                    glm::vec3 sample = incomingLight[lane] / static_cast<float>(frameData.raysPerPixel);
+                    accumulated = frameIndex == 1 ? glm::vec4(sample, 1.0f) : glm::vec4(glm::vec3(accumulated) + sample, accumulated.w + 1.0f);
+                }
+            }
+        }
+    }
+}
+
+void CpuPathTracer::TracePacket(Packet& packet)
+{
+    float bsdfPdf[PacketWidth];
+    for (uint32_t lane = 0; lane < PacketWidth; lane++)
+    {
+        packet.rayColor[lane] = glm::vec3(1.0f);
+        packet.incomingLight[lane] = glm::vec3(0.0f);
+        bsdfPdf[lane] = 0.0f;
+    }
+
+    HitInfo hits[PacketWidth];
+    ShadowPacket environmentShadows = {}, emitterShadows = {};
+    for (uint32_t i = 0; i < frameData.maxBouceLimit; i++)
+    {
+        if (!packet.active[0] && !packet.active[1] && !packet.active[2] && !packet.active[3])
+            break;
+
+        ClosestHit(packet, hits);
+        for (uint32_t lane = 0; lane < PacketWidth; lane++)
+        {
+            environmentShadows.active[lane] = false;
+            emitterShadows.active[lane] = false;
+        }
+
+        for (uint32_t lane = 0; lane < PacketWidth; lane++)
+        {
+            if (!packet.active[lane])
+                continue;
+
+            HitInfo& info = hits[lane];
+            Rng& rng = packet.rng[lane];
+            rng.dimension = i * SamplerBounceDimensions + SamplerDirection;
+            if (info.didHit)
+            {
+                glm::vec3 u;
+                u.x = RandomValue(rng);
+                u.y = RandomValue(rng);
+                u.z = RandomValue(rng);
+                // Surfaces reflect on both sides like in the shader
+                glm::vec3 outgoing = -packet.direction[lane];
+                if (glm::dot(info.hitNormal, outgoing) < 0.0f)
+                    info.hitNormal = -info.hitNormal;
+                const Material& mat = *info.material;
+
+                glm::vec3 emittedLight = glm::vec3(1.0f) * mat.light;
+                float emissionWeight = bsdfPdf[lane] > 0.0f ? PowerHeuristic(bsdfPdf[lane], LightPdf(packet.origin[lane], info)) : 1.0f;
+                packet.incomingLight[lane] += emittedLight * packet.rayColor[lane] * emissionWeight;
+
+                bsdfPdf[lane] = 0.0f;
+                if (frameData.lightSampling != 0 && mat.smoothness < 1.0f)
+                    SampleLights(info, outgoing, mat.color * packet.rayColor[lane], rng, lane, environmentShadows, emitterShadows);
+
+                float weight;
+                packet.origin[lane] = info.hitPos;
+                packet.direction[lane] = SampleBsdf(info.hitNormal, outgoing, mat.smoothness, u, weight);
+                if (weight <= 0.0f)
+                {
+                    packet.active[lane] = false;
+                    continue;
+                }
+                if (frameData.lightSampling != 0)
+                    bsdfPdf[lane] = BsdfPdf(info.hitNormal, outgoing, mat.smoothness, packet.direction[lane]);
+
+                packet.rayColor[lane] *= mat.color * weight;
+
+                // Russian roulette, same test and random number order as the shader
+                if (i + 1 >= frameData.rouletteDepth && i + 1 < frameData.maxBouceLimit)
+                {
+                    glm::vec3 color = packet.rayColor[lane];
+                    float survival = std::min(std::max(color.x, std::max(color.y, color.z)), 1.0f);
+                    rng.SetBounceDimension(SamplerRoulette);
+                    if (RandomValue(rng) >= survival)
+                    {
+                        packet.active[lane] = false;
+                        continue;
+                    }
+                    packet.rayColor[lane] /= survival;
+                }
+            }
+            else
+            {
+                const glm::vec3& direction = packet.direction[lane];
+                float environmentWeight = bsdfPdf[lane] > 0.0f && EnvironmentSampling() ? PowerHeuristic(bsdfPdf[lane], EnvironmentPdf(direction)) : 1.0f;
+                packet.incomingLight[lane] += (GetSkyLight(direction) + SunLight(direction)) * environmentWeight * packet.rayColor[lane];
+                packet.active[lane] = false;
+            }
+        }
+
+        // Shadow rays of the whole packet at once, lanes ended by roulette above still get their light
+        for (ShadowPacket* shadows : { &environmentShadows, &emitterShadows })
+        {
+            if (!shadows->active[0] && !shadows->active[1] && !shadows->active[2] && !shadows->active[3])
+                continue;
+            int occluded = Occluded(*shadows);
+            for (uint32_t lane = 0; lane < PacketWidth; lane++)
+            {
+                if (shadows->active[lane] && !(occluded & (1 << lane)))
+                    packet.incomingLight[lane] += shadows->light[lane];
+            }
+        }
+    }
+}
+
+void CpuPathTracer::SampleLights(const HitInfo& info, const glm::vec3& outgoing, const glm::vec3& throughput, Rng& rng, uint32_t lane,
+    ShadowPacket& environmentShadows, ShadowPacket& emitterShadows)
+{
+    float smoothness = info.material->smoothness;
+    if (EnvironmentSampling())
+    {
+        rng.SetBounceDimension(SamplerEnvironment);
+        float u1 = RandomValue(rng);
+        float u2 = RandomValue(rng);
+        float lightPdf;
+        glm::vec3 direction = SampleEnvironment(u1, u2, lightPdf);
+
+        glm::vec3 environment = GetSkyLight(direction) + SunLight(direction);
+        float reflectance = EvaluateBsdf(info.hitNormal, outgoing, smoothness, direction);
+        float bsdfPdf = BsdfPdf(info.hitNormal, outgoing, smoothness, direction);
+        if (lightPdf > 0.0f && reflectance > 0.0f)
+        {
+            environmentShadows.origin[lane] = info.hitPos;
+            environmentShadows.direction[lane] = direction;
+            environmentShadows.maxDistance[lane] = FloatMax;
+            environmentShadows.light[lane] = throughput * environment * (reflectance / lightPdf * PowerHeuristic(lightPdf, bsdfPdf));
+            environmentShadows.active[lane] = true;
+        }
+    }
+
+    if (frameData.lightNumber > 0)
+    {
+        // Separate statements keep the order of the random numbers
+        rng.SetBounceDimension(SamplerEmitter);
+        float pick = RandomValue(rng) * frameData.lightNumber;
+        float u1 = RandomValue(rng);
+        float u2 = RandomValue(rng);
+
+        uint32_t slot = std::min(static_cast<uint32_t>(pick), frameData.lightNumber - 1);
+        const Light& emitter = _lights[pick - static_cast<float>(slot) < _lights[slot].probability ? slot : _lights[slot].alias];
+
+        glm::vec3 direction;
+        float lightPdf = 0.0f;
+        float maxDistance = 0.0f;
+        if (emitter.sphereIndex >= 0)
+        {
+            const Sphere& sphere = _spheres[emitter.sphereIndex];
+            glm::vec3 toCenter = sphere.center - info.hitPos;
+            float distanceSquared = glm::dot(toCenter, toCenter);
+            if (distanceSquared > sphere.radius * sphere.radius)
+            {
+                float cosThetaMax = std::sqrt(1.0f - sphere.radius * sphere.radius / distanceSquared);
+                direction = ConeDirection(glm::normalize(toCenter), 1.0f - u1 * (1.0f - cosThetaMax), u2 * 2.0f * Pi);
+                float lightDistance = RaySphere(info.hitPos, direction, sphere);
+                if (lightDistance > 0.0f)
+                {
+                    lightPdf = emitter.power / frameData.lightPower * SphereConePdf(info.hitPos, sphere);
+                    maxDistance = lightDistance;
+                }
+            }
+        }
+        else
+        {
+            const Triangle& tri = _triangles[emitter.triangleIndex];
+            float su = std::sqrt(u1);
+            glm::vec3 point = glm::vec3(tri.p1) * (1.0f - su) + glm::vec3(tri.p2) * (u2 * su) + glm::vec3(tri.p3) * (su * (1.0f - u2));
+            direction = glm::normalize(point - info.hitPos);
+            lightPdf = TriangleLightPdf(info.hitPos, tri, emitter.light, point);
+            maxDistance = glm::length(point - info.hitPos);
+        }
+
+        if (lightPdf > 0.0f)
+        {
+            float reflectance = EvaluateBsdf(info.hitNormal, outgoing, smoothness, direction);
+            float bsdfPdf = BsdfPdf(info.hitNormal, outgoing, smoothness, direction);
+            if (reflectance > 0.0f)
+            {
+                emitterShadows.origin[lane] = info.hitPos;
+                emitterShadows.direction[lane] = direction;
+                // The emitter itself must not count as an occluder
+                emitterShadows.maxDistance[lane] = maxDistance * 0.9999f;
+                emitterShadows.light[lane] = throughput * (emitter.light * reflectance / lightPdf * PowerHeuristic(lightPdf, bsdfPdf));
+                emitterShadows.active[lane] = true;
+            }
+        }
+    }
+}
+
+float CpuPathTracer::TriangleLightPdf(const glm::vec3& origin, const Triangle& tri, float light, const glm::vec3& point)
+{
+    glm::vec3 toLight = point - origin;
+    float distanceSquared = glm::dot(toLight, toLight);
+    glm::vec3 normal = glm::normalize(glm::cross(glm::vec3(tri.p2) - glm::vec3(tri.p1), glm::vec3(tri.p3) - glm::vec3(tri.p1)));
+    float cosLight = -glm::dot(toLight, normal) / std::sqrt(distanceSquared);
+    if (cosLight <= 0.0f)
+        return 0.0f;
+    return light * distanceSquared / (frameData.lightPower * cosLight);
+}
+
+float CpuPathTracer::LightPdf(const glm::vec3& origin, const HitInfo& info)
+{
+    if (frameData.lightSampling == 0 || frameData.lightNumber == 0 || info.material->light <= 0.0f)
+        return 0.0f;
+    if (info.sphereIndex >= 0)
+    {
+        const Sphere& sphere = _spheres[info.sphereIndex];
+        float power = sphere.material.light * 4.0f * Pi * sphere.radius * sphere.radius;
+        return power / frameData.lightPower * SphereConePdf(origin, sphere);
+    }
+    return TriangleLightPdf(origin, _triangles[info.triangleIndex], info.material->light, info.hitPos);
+}
+
+void CpuPathTracer::UpdateEnvironment()
+{
+    EnvironmentParameters parameters = EnvironmentParameters::FromFrameData(frameData);
+    if (_environmentBuilt && parameters == _environmentParameters)
+        return;
+    _environmentParameters = parameters;
+    _environmentBuilt = true;
+
+    // Same texel centres, weights and normalization as Environment.comp
+    std::vector<float>& distribution = _environmentDistribution;
+    distribution.assign(EnvironmentDistributionSize, 0.0f);
+    const uint32_t marginal = 1;
+    const uint32_t conditional = marginal + EnvironmentHeight + 1;
+    for (uint32_t y = 0; y < EnvironmentHeight; y++)
+    {
+        float theta = (y + 0.5f) / EnvironmentHeight * Pi;
+        uint32_t first = conditional + y * (EnvironmentWidth + 1);
+        float sum = 0.0f;
+        for (uint32_t x = 0; x < EnvironmentWidth; x++)
+        {
+            float phi = (x + 0.5f) / EnvironmentWidth * 2.0f * Pi;
+            glm::vec3 direction = glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+            glm::vec3 radiance = GetSkyLight(direction) + SunLight(direction);
+            sum += 0.2126f * radiance.x + 0.7152f * radiance.y + 0.0722f * radiance.z;
+            distribution[first + x + 1] = sum;
+        }
+        for (uint32_t x = 1; x <= EnvironmentWidth; x++)
+            distribution[first + x] = sum > 0.0f ? distribution[first + x] / sum : static_cast<float>(x) / EnvironmentWidth;
+        distribution[marginal + y + 1] = sum * std::sin(theta);
+    }
+
+    float sum = 0.0f;
+    for (uint32_t y = 1; y <= EnvironmentHeight; y++)
+    {
+        sum += distribution[marginal + y];
+        distribution[marginal + y] = sum;
+    }
+    for (uint32_t y = 1; y <= EnvironmentHeight; y++)
+        distribution[marginal + y] = sum > 0.0f ? distribution[marginal + y] / sum : static_cast<float>(y) / EnvironmentHeight;
+    distribution[0] = sum;
+}
+
+bool CpuPathTracer::EnvironmentSampling()
+{
+    return frameData.lightSampling != 0 && _environmentDistribution[0] > 0.0f;
+}
+
+// Index i of the interval cdf[i] <= u < cdf[i + 1] of a CDF with size + 1 entries
+static uint32_t FindInterval(const float* cdf, uint32_t size, float u)
+{
+    uint32_t low = 0;
+    uint32_t high = size;
+    while (high - low > 1)
+    {
+        uint32_t middle = (low + high) / 2;
+        if (cdf[middle] <= u)
+            low = middle;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+glm::vec3 CpuPathTracer::SampleEnvironment(float u1, float u2, float& pdf)
+{
+    const float* marginal = &_environmentDistribution[1];
+    uint32_t y = FindInterval(marginal, EnvironmentHeight, u1);
+    const float* row = &_environmentDistribution[1 + EnvironmentHeight + 1 + y * (EnvironmentWidth + 1)];
+    uint32_t x = FindInterval(row, EnvironmentWidth, u2);
+
+    float v = (y + std::clamp((u1 - marginal[y]) / (marginal[y + 1] - marginal[y]), 0.0f, 1.0f)) / EnvironmentHeight;
+    float u = (x + std::clamp((u2 - row[x]) / (row[x + 1] - row[x]), 0.0f, 1.0f)) / EnvironmentWidth;
+    float theta = v * Pi;
+    float phi = u * 2.0f * Pi;
+    float sinTheta = std::sin(theta);
+
+    pdf = sinTheta > 0.0f ? (marginal[y + 1] - marginal[y]) * (row[x + 1] - row[x]) * EnvironmentWidth * EnvironmentHeight / (2.0f * Pi * Pi * sinTheta) : 0.0f;
+    return glm::vec3(sinTheta * std::cos(phi), std::cos(theta), sinTheta * std::sin(phi));
+}
+
+float CpuPathTracer::EnvironmentPdf(const glm::vec3& direction)
+{
+    float theta = std::acos(std::clamp(direction.y, -1.0f, 1.0f));
+    float phi = std::atan2(direction.z, direction.x);
+    if (phi < 0.0f)
+        phi += 2.0f * Pi;
+    float sinTheta = std::sin(theta);
+    if (sinTheta <= 0.0f)
+        return 0.0f;
+
+    uint32_t y = std::min(static_cast<uint32_t>(theta / Pi * EnvironmentHeight), EnvironmentHeight - 1);
+    uint32_t x = std::min(static_cast<uint32_t>(phi / (2.0f * Pi) * EnvironmentWidth), EnvironmentWidth - 1);
+    const float* marginal = &_environmentDistribution[1];
+    const float* row = &_environmentDistribution[1 + EnvironmentHeight + 1 + y * (EnvironmentWidth + 1)];
+    return (marginal[y + 1] - marginal[y]) * (row[x + 1] - row[x]) * EnvironmentWidth * EnvironmentHeight / (2.0f * Pi * Pi * sinTheta);
+}
+
+void CpuPathTracer::ClosestHit(Packet& packet, HitInfo* hits)
+{
+    // Finished lanes keep their last ray, their results are ignored
+    Vec3x4 origin, direction;
+    origin.x = Float4(packet.origin[0].x, packet.origin[1].x, packet.origin[2].x, packet.origin[3].x);
+    origin.y = Float4(packet.origin[0].y, packet.origin[1].y, packet.origin[2].y, packet.origin[3].y);
+    origin.z = Float4(packet.origin[0].z, packet.origin[1].z, packet.origin[2].z, packet.origin[3].z);
+    direction.x = Float4(packet.direction[0].x, packet.direction[1].x, packet.direction[2].x, packet.direction[3].x);
+    direction.y = Float4(packet.direction[0].y, packet.direction[1].y, packet.direction[2].y, packet.direction[3].y);
+    direction.z = Float4(packet.direction[0].z, packet.direction[1].z, packet.direction[2].z, packet.direction[3].z);
+    Float4 active = Float4(packet.active[0] ? 1.0f : 0.0f, packet.active[1] ? 1.0f : 0.0f, packet.active[2] ? 1.0f : 0.0f, packet.active[3] ? 1.0f : 0.0f) > Float4(0.0f);
+
+    Float4 closest(FloatMax);
+    int32_t sphereIndex[PacketWidth] = { -1, -1, -1, -1 };
+    int32_t triangleIndex[PacketWidth] = { -1, -1, -1, -1 };
+    int32_t meshIndex[PacketWidth] = { -1, -1, -1, -1 };
+    float hitU[PacketWidth], hitV[PacketWidth];
+
+    // RaySphere
+    Float4 a = Dot(direction, direction);
+    for (size_t i = 0; i < _spheres.size(); i++)
+    {
+        const Sphere& sphere = _spheres[i];
+        Vec3x4 offsetRayOrigin = origin - Broadcast(sphere.center);
+        Float4 b = Float4(2.0f) * Dot(offsetRayOrigin, direction);
+        Float4 c = Dot(offsetRayOrigin, offsetRayOrigin) - Float4(sphere.radius * sphere.radius);
+        Float4 discriminant = b * b - Float4(4.0f) * a * c;
+        Float4 dst = (-b - Sqrt(Max(discriminant, Float4(0.0f)))) / (Float4(2.0f) * a);
+
+        Float4 hit = active & (discriminant >= Float4(0.0f)) & (dst > Float4(0.0001f)) & (dst < closest);
+        int mask = MoveMask(hit);
+        if (mask == 0)
+            continue;
+        closest = Select(hit, dst, closest);
+        for (uint32_t lane = 0; lane < PacketWidth; lane++)
+        {
+            if (mask & (1 << lane))
+                sphereIndex[lane] = static_cast<int32_t>(i);
+        }
+    }
+
+    // RayBox, then RayTriangle for the lanes inside the box
+    Vec3x4 dirFrac = { Float4(1.0f) / direction.x, Float4(1.0f) / direction.y, Float4(1.0f) / direction.z };
+    for (size_t m = 0; m < _meshes.size(); m++)
+    {
+        const Mesh& mesh = _meshes[m];
+        Float4 t1 = (Float4(mesh.boundingPoint1.x) - origin.x) * dirFrac.x;
+        Float4 t2 = (Float4(mesh.boundingPoint2.x) - origin.x) * dirFrac.x;
+        Float4 t3 = (Float4(mesh.boundingPoint1.y) - origin.y) * dirFrac.y;
+        Float4 t4 = (Float4(mesh.boundingPoint2.y) - origin.y) * dirFrac.y;
+        Float4 t5 = (Float4(mesh.boundingPoint1.z) - origin.z) * dirFrac.z;
+        Float4 t6 = (Float4(mesh.boundingPoint2.z) - origin.z) * dirFrac.z;
+        Float4 tmin = Max(Max(Min(t1, t2), Min(t3, t4)), Min(t5, t6));
+        Float4 tmax = Min(Min(Max(t1, t2), Max(t3, t4)), Max(t5, t6));
+        Float4 inBox = AndNot(active, (tmax < Float4(0.0f)) | (tmin > tmax));
+        if (MoveMask(inBox) == 0)
+            continue;
+
+        for (int32_t j = mesh.startTriangle; j < mesh.startTriangle + mesh.numTriangles; j++)
+        {
+            const Triangle& tri = _triangles[j];
+            glm::vec3 edgeAB = glm::vec3(tri.p2) - glm::vec3(tri.p1);
+            glm::vec3 edgeAC = glm::vec3(tri.p3) - glm::vec3(tri.p1);
+            Vec3x4 normal = Broadcast(glm::cross(edgeAB, edgeAC));
+            Vec3x4 ao = origin - Broadcast(glm::vec3(tri.p1));
+            Vec3x4 dao = Cross(ao, direction);
+
+            Float4 determinant = -Dot(direction, normal);
+            Float4 invDet = Float4(1.0f) / determinant;
+            Float4 dst = Dot(ao, normal) * invDet;
+            Float4 u = Dot(Broadcast(edgeAC), dao) * invDet;
+            Float4 v = -Dot(Broadcast(edgeAB), dao) * invDet;
+            Float4 w = Float4(1.0f) - u - v;
+
+            Float4 zero(0.0f);
+            Float4 hit = inBox & (determinant >= Float4(1e-6f)) & (dst >= zero) & (u >= zero) & (v >= zero) & (w >= zero) & (dst < closest);
+            int mask = MoveMask(hit);
+            if (mask == 0)
+                continue;
+            closest = Select(hit, dst, closest);
+            for (uint32_t lane = 0; lane < PacketWidth; lane++)
+            {
+                if (mask & (1 << lane))
+                {
+                    triangleIndex[lane] = j;
+                    meshIndex[lane] = static_cast<int32_t>(m);
+                    hitU[lane] = u[lane];
+                    hitV[lane] = v[lane];
+                }
+            }
+        }
+    }
+
+    // A triangle hit always lies in front of every earlier sphere hit
+    for (uint32_t lane = 0; lane < PacketWidth; lane++)
+    {
+        HitInfo& info = hits[lane];
+        float distance = closest[lane];
+        info.hitPos = packet.origin[lane] + packet.direction[lane] * distance;
+        if (triangleIndex[lane] >= 0)
+        {
+            const Triangle& tri = _triangles[triangleIndex[lane]];
+            float w = 1.0f - hitU[lane] - hitV[lane];
+            info.didHit = true;
+            info.hitNormal = glm::normalize(glm::vec3(tri.n1) * w + glm::vec3(tri.n2) * hitU[lane] + glm::vec3(tri.n3) * hitV[lane]);
+            info.material = &_meshes[meshIndex[lane]].material;
+            info.sphereIndex = -1;
+            info.triangleIndex = triangleIndex[lane];
+        }
+        else if (sphereIndex[lane] >= 0)
+        {
+            const Sphere& sphere = _spheres[sphereIndex[lane]];
+            info.didHit = true;
+            info.hitNormal = glm::normalize(info.hitPos - sphere.center);
+            info.material = &sphere.material;
+            info.sphereIndex = sphereIndex[lane];
+            info.triangleIndex = -1;
+        }
+        else
+            info.didHit = false;
+    }
+}
+
+int CpuPathTracer::Occluded(const ShadowPacket& shadows)
+{
+    Vec3x4 origin, direction;
+    origin.x = Float4(shadows.origin[0].x, shadows.origin[1].x, shadows.origin[2].x, shadows.origin[3].x);
+    origin.y = Float4(shadows.origin[0].y, shadows.origin[1].y, shadows.origin[2].y, shadows.origin[3].y);
+    origin.z = Float4(shadows.origin[0].z, shadows.origin[1].z, shadows.origin[2].z, shadows.origin[3].z);
+    direction.x = Float4(shadows.direction[0].x, shadows.direction[1].x, shadows.direction[2].x, shadows.direction[3].x);
+    direction.y = Float4(shadows.direction[0].y, shadows.direction[1].y, shadows.direction[2].y, shadows.direction[3].y);
+    direction.z = Float4(shadows.direction[0].z, shadows.direction[1].z, shadows.direction[2].z, shadows.direction[3].z);
+    Float4 maxDistance = Float4(shadows.maxDistance[0], shadows.maxDistance[1], shadows.maxDistance[2], shadows.maxDistance[3]);
+    int activeMask = (shadows.active[0] ? 1 : 0) | (shadows.active[1] ? 2 : 0) | (shadows.active[2] ? 4 : 0) | (shadows.active[3] ? 8 : 0);
+
+    // Stops as soon as every active lane is blocked
+    int occluded = 0;
+    Float4 a = Dot(direction, direction);
+    for (size_t i = 0; i < _spheres.size() && (occluded & activeMask) != activeMask; i++)
+    {
+        const Sphere& sphere = _spheres[i];
+        Vec3x4 offsetRayOrigin = origin - Broadcast(sphere.center);
+        Float4 b = Float4(2.0f) * Dot(offsetRayOrigin, direction);
+        Float4 c = Dot(offsetRayOrigin, offsetRayOrigin) - Float4(sphere.radius * sphere.radius);
+        Float4 discriminant = b * b - Float4(4.0f) * a * c;
+        Float4 dst = (-b - Sqrt(Max(discriminant, Float4(0.0f)))) / (Float4(2.0f) * a);
+        occluded |= MoveMask((discriminant >= Float4(0.0f)) & (dst > Float4(0.0001f)) & (dst < maxDistance));
+    }
+
+    Vec3x4 dirFrac = { Float4(1.0f) / direction.x, Float4(1.0f) / direction.y, Float4(1.0f) / direction.z };
+    for (size_t m = 0; m < _meshes.size() && (occluded & activeMask) != activeMask; m++)
+    {
+        const Mesh& mesh = _meshes[m];
+        Float4 t1 = (Float4(mesh.boundingPoint1.x) - origin.x) * dirFrac.x;
+        Float4 t2 = (Float4(mesh.boundingPoint2.x) - origin.x) * dirFrac.x;
+        Float4 t3 = (Float4(mesh.boundingPoint1.y) - origin.y) * dirFrac.y;
+        Float4 t4 = (Float4(mesh.boundingPoint2.y) - origin.y) * dirFrac.y;
+        Float4 t5 = (Float4(mesh.boundingPoint1.z) - origin.z) * dirFrac.z;
+        Float4 t6 = (Float4(mesh.boundingPoint2.z) - origin.z) * dirFrac.z;
+        Float4 tmin = Max(Max(Min(t1, t2), Min(t3, t4)), Min(t5, t6));
+        Float4 tmax = Min(Min(Max(t1, t2), Max(t3, t4)), Max(t5, t6));
+        int inBox = ~MoveMask((tmax < Float4(0.0f)) | (tmin > tmax)) & activeMask & ~occluded;
+        if (inBox == 0)
+            continue;
+
+        for (int32_t j = mesh.startTriangle; j < mesh.startTriangle + mesh.numTriangles && (occluded & inBox) != inBox; j++)
+        {
+            const Triangle& tri = _triangles[j];
+            glm::vec3 edgeAB = glm::vec3(tri.p2) - glm::vec3(tri.p1);
+            glm::vec3 edgeAC = glm::vec3(tri.p3) - glm::vec3(tri.p1);
+            Vec3x4 normal = Broadcast(glm::cross(edgeAB, edgeAC));
+            Vec3x4 ao = origin - Broadcast(glm::vec3(tri.p1));
+            Vec3x4 dao = Cross(ao, direction);
+
+            Float4 determinant = -Dot(direction, normal);
+            Float4 invDet = Float4(1.0f) / determinant;
+            Float4 dst = Dot(ao, normal) * invDet;
+            Float4 u = Dot(Broadcast(edgeAC), dao) * invDet;
+            Float4 v = -Dot(Broadcast(edgeAB), dao) * invDet;
+            Float4 w = Float4(1.0f) - u - v;
+
+            Float4 zero(0.0f);
+            Float4 hit = (determinant >= Float4(1e-6f)) & (dst >= zero) & (u >= zero) & (v >= zero) & (w >= zero) & (dst < maxDistance);
+            occluded |= MoveMask(hit) & inBox;
+        }
+    }
+    return occluded & activeMask;
+}
+
+glm::vec3 CpuPathTracer::GetSkyLight(const glm::vec3& direction)
+{
+    glm::vec3 skyColorHorizon = glm::vec3(frameData.skyColorHorizon);
+    glm::vec3 skyColorZenith = glm::vec3(frameData.skyColorZenith);
+    glm::vec3 groundColor = glm::vec3(frameData.groundColor);
+
+    float skyGradientT = std::pow(Smoothstep(0.0f, 0.4f, direction.y), 0.35f);
+    glm::vec3 skyGradient = glm::mix(skyColorHorizon, skyColorZenith, skyGradientT);
+
+    float groundToSkyT = Smoothstep(-0.01f, 0.0f, direction.y);
+    return glm::mix(groundColor, skyGradient, groundToSkyT);
+}
+
+float CpuPathTracer::SunLight(const glm::vec3& direction)
+{
+    // Same xzy swizzle as the shader
+    glm::vec3 sunLightDirection = glm::vec3(frameData.sunLightDirection.x, frameData.sunLightDirection.z, frameData.sunLightDirection.y);
+    float sun = std::pow(std::max(0.0f, glm::dot(direction, -sunLightDirection)), frameData.sunFocus) * frameData.sunIntensity;
+    return direction.y >= 0.0f ? sun : 0.0f;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include "../RayTracingStructs.h"
+#include "ThreadPool.h"
+#include <vector>
+
+/* Reference implementation of Raytracing.comp on the CPU. It	*/
+/* reads the same FrameData and scene structs and draws the same	*/
+/* random numbers, so images match the GPU up to float rounding	*/
+class CpuPathTracer
+{
+public:
+	CpuPathTracer(uint32_t width, uint32_t height, uint32_t threadCount = 0);
+	~CpuPathTracer();
+
+	void SetScene(const std::vector<Sphere>& spheres, const std::vector<Triangle>& triangles, const std::vector<Mesh>& meshes);
+	/* Renders dispatchCount accumulation passes like			*/
+	/* PathTracer::CmdDispatch, blocks until they are done		*/
+	void Dispatch(uint32_t dispatchCount = 1);
+
+	/* Sum of the per dispatch averages, their count in alpha	*/
+	const std::vector<glm::vec4>& GetAccumulation() { return _accumulation; }
+	uint32_t GetThreadCount() { return _threadPool.GetThreadCount(); }
+
+	FrameData frameData;
+
+private:
+
+	struct HitInfo;
+	struct Packet;
+	struct ShadowPacket;
+	struct Rng;
+
+	/* Same numbers as RandomValue in the shader for the		*/
+	/* sampler of frameData									*/
+	float RandomValue(Rng& rng);
+
+	void RenderTile(uint32_t tileIndex, uint32_t firstFrameIndex, uint32_t dispatchCount);
+	/* Mean luminance deviation over all pixels, the reduction	*/
+	/* pass of Adaptive.comp									*/
+	float MeanDeviation();
+	void TracePacket(Packet& packet);
+	void ClosestHit(Packet& packet, HitInfo* hits);
+	/* One bit per lane whose shadow ray is blocked			*/
+	int Occluded(const ShadowPacket& shadows);
+	/* Queues the lane's light samples like SampleLights in	*/
+	/* the shader, they count once their shadow rays are traced	*/
+	void SampleLights(const HitInfo& info, const glm::vec3& outgoing, const glm::vec3& throughput, Rng& rng, uint32_t lane,
+		ShadowPacket& environmentShadows, ShadowPacket& emitterShadows);
+	/* Density of a light sample toward the emitter a BSDF		*/
+	/* sampled ray from origin hit, see LightPdf in the shader	*/
+	float LightPdf(const glm::vec3& origin, const HitInfo& info);
+	float TriangleLightPdf(const glm::vec3& origin, const Triangle& tri, float light, const glm::vec3& point);
+	/* Builds the distribution Environment.comp builds on the GPU	*/
+	/* when the sky parameters in frameData have changed			*/
+	void UpdateEnvironment();
+	bool EnvironmentSampling();
+	glm::vec3 SampleEnvironment(float u1, float u2, float& pdf);
+	float EnvironmentPdf(const glm::vec3& direction);
+	float SunLight(const glm::vec3& direction);
+	/* The environment without the sun						*/
+	glm::vec3 GetSkyLight(const glm::vec3& direction);
+
+	uint32_t _width;
+	uint32_t _height;
+	uint32_t _tilesX;
+	uint32_t _tilesY;
+
+	std::vector<Sphere> _spheres;
+	std::vector<Triangle> _triangles;
+	std::vector<Mesh> _meshes;
+	std::vector<Light> _lights;
+	std::vector<glm::vec4> _accumulation;
+	/* Count, mean and M2 of the sample luminance per pixel,	*/
+	/* the statistics image of AdaptiveSampler					*/
+	std::vector<glm::vec4> _statistics;
+	float _meanDeviation = 0.0f;
+	std::vector<float> _environmentDistribution;
+	EnvironmentParameters _environmentParameters;
+	bool _environmentBuilt = false;
+
+	ThreadPool _threadPool;
+};
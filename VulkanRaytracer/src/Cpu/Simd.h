@@ -0,0 +1,97 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE
+#include <emmintrin.h>
+#endif
+
+/* Four floats processed together, SSE on x86 and plain loops	*/
+/* elsewhere. Comparisons return all bits set per true lane		*/
+struct Float4
+{
+#ifdef SIMD_SSE
+	__m128 v;
+
+	Float4() = default;
+	Float4(__m128 value) : v(value) {}
+	Float4(float value) : v(_mm_set1_ps(value)) {}
+	Float4(float x, float y, float z, float w) : v(_mm_setr_ps(x, y, z, w)) {}
+
+	float operator[](int lane) const { alignas(16) float f[4]; _mm_store_ps(f, v); return f[lane]; }
+
+	friend Float4 operator+(Float4 a, Float4 b) { return _mm_add_ps(a.v, b.v); }
+	friend Float4 operator-(Float4 a, Float4 b) { return _mm_sub_ps(a.v, b.v); }
+	friend Float4 operator*(Float4 a, Float4 b) { return _mm_mul_ps(a.v, b.v); }
+	friend Float4 operator/(Float4 a, Float4 b) { return _mm_div_ps(a.v, b.v); }
+	friend Float4 operator-(Float4 a) { return _mm_xor_ps(a.v, _mm_set1_ps(-0.0f)); }
+
+	friend Float4 operator<(Float4 a, Float4 b) { return _mm_cmplt_ps(a.v, b.v); }
+	friend Float4 operator>(Float4 a, Float4 b) { return _mm_cmpgt_ps(a.v, b.v); }
+	friend Float4 operator>=(Float4 a, Float4 b) { return _mm_cmpge_ps(a.v, b.v); }
+	friend Float4 operator&(Float4 a, Float4 b) { return _mm_and_ps(a.v, b.v); }
+	friend Float4 operator|(Float4 a, Float4 b) { return _mm_or_ps(a.v, b.v); }
+	/* a and not b											*/
+	friend Float4 AndNot(Float4 a, Float4 b) { return _mm_andnot_ps(b.v, a.v); }
+
+	friend Float4 Min(Float4 a, Float4 b) { return _mm_min_ps(a.v, b.v); }
+	friend Float4 Max(Float4 a, Float4 b) { return _mm_max_ps(a.v, b.v); }
+	friend Float4 Sqrt(Float4 a) { return _mm_sqrt_ps(a.v); }
+	/* mask ? a : b per lane									*/
+	friend Float4 Select(Float4 mask, Float4 a, Float4 b) { return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)); }
+	/* One bit per lane, lane 0 is the lowest bit			*/
+	friend int MoveMask(Float4 mask) { return _mm_movemask_ps(mask.v); }
+#else
+	float v[4];
+
+	Float4() = default;
+	Float4(float value) : v{ value, value, value, value } {}
+	Float4(float x, float y, float z, float w) : v{ x, y, z, w } {}
+
+	float operator[](int lane) const { return v[lane]; }
+
+	template<typename Op>
+	static Float4 Map(Float4 a, Float4 b, Op op) { Float4 r; for (int i = 0; i < 4; i++) r.v[i] = op(a.v[i], b.v[i]); return r; }
+	static float Bits(bool value) { uint32_t bits = value ? 0xFFFFFFFFu : 0u; float f; memcpy(&f, &bits, 4); return f; }
+	static uint32_t ToBits(float value) { uint32_t bits; memcpy(&bits, &value, 4); return bits; }
+
+	friend Float4 operator+(Float4 a, Float4 b) { return Map(a, b, [](float x, float y) { return x + y; }); }
+	friend Float4 operator-(Float4 a, Float4 b) { return Map(a, b, [](float x, float y) { return x - y; }); }
+	friend Float4 operator*(Float4 a, Float4 b) { return Map(a, b, [](float x, float y) { return x * y; }); }
+	friend Float4 operator/(Float4 a, Float4 b) { return Map(a, b, [](float x, float y) { return x / y; }); }
+	friend Float4 operator-(Float4 a) { return Float4(0.0f) - a; }
+
+	friend Float4 operator<(Float4 a, Float4 b) { return Map(a, b, [](float x, float y) { return Bits(x < y); }); }
+	friend Float4 operator>(Float4 a, Float4 b) { return Map(a, b, [](float x, float y) { return Bits(x > y); }); }
+	friend Float4 operator>=(Float4 a, Float4 b) { return Map(a, b, [](float x, float y) { return Bits(x >= y); }); }
+	friend Float4 operator&(Float4 a, Float4 b) { return Map(a, b, [](float x, float y) { return Bits(ToBits(x) & ToBits(y)); }); }
+	friend Float4 operator|(Float4 a, Float4 b) { return Map(a, b, [](float x, float y) { return Bits(ToBits(x) | ToBits(y)); }); }
+	friend Float4 AndNot(Float4 a, Float4 b) { return Map(a, b, [](float x, float y) { return Bits(ToBits(x) && !ToBits(y)); }); }
+
+	friend Float4 Min(Float4 a, Float4 b) { return Map(a, b, [](float x, float y) { return y < x ? y : x; }); }
+	friend Float4 Max(Float4 a, Float4 b) { return Map(a, b, [](float x, float y) { return y > x ? y : x; }); }
+	friend Float4 Sqrt(Float4 a) { return Map(a, a, [](float x, float) { return std::sqrt(x); }); }
+	friend Float4 Select(Float4 mask, Float4 a, Float4 b) { Float4 r; for (int i = 0; i < 4; i++) r.v[i] = ToBits(mask.v[i]) ? a.v[i] : b.v[i]; return r; }
+	friend int MoveMask(Float4 mask) { int bits = 0; for (int i = 0; i < 4; i++) bits |= (ToBits(mask.v[i]) >> 31) << i; return bits; }
+#endif
+};
+
+/* Four 3D vectors in structure of arrays layout				*/
+struct Vec3x4
+{
+	Float4 x;
+	Float4 y;
+	Float4 z;
+
+	friend Vec3x4 operator+(const Vec3x4& a, const Vec3x4& b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+	friend Vec3x4 operator-(const Vec3x4& a, const Vec3x4& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+	friend Vec3x4 operator*(const Vec3x4& a, Float4 s) { return { a.x * s, a.y * s, a.z * s }; }
+};
+
+inline Float4 Dot(const Vec3x4& a, const Vec3x4& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline Vec3x4 Cross(const Vec3x4& a, const Vec3x4& b)
+{
+	return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
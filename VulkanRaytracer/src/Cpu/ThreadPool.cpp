@@ -0,0 +1,117 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+    if (threadCount == 0)
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+    _task = nullptr;
+    _generation = 0;
+    _remaining = 0;
+    _activeThreads = 0;
+    _stop = false;
+
+    for (uint32_t i = 0; i < threadCount; i++)
+        _queues.push_back(std::make_unique<Queue>());
+    for (uint32_t i = 0; i < threadCount; i++)
+        _threads.emplace_back(&ThreadPool::WorkerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _workAvailable.notify_all();
+    for (std::thread& thread : _threads)
+        thread.join();
+}
+
+void ThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t)>& task)
+{
+    if (count == 0)
+        return;
+
+    // The task is published before any item becomes visible, a worker that wakes late for the
+    // previous call sees either no items or the ones of this call together with this task
+    std::unique_lock<std::mutex> lock(_mutex);
+    _task = &task;
+    _remaining = count;
+    _generation++;
+
+    // Contiguous shares keep neighbouring tiles on one thread until stealing starts
+    uint32_t threadCount = GetThreadCount();
+    for (uint32_t i = 0; i < threadCount; i++)
+    {
+        uint32_t begin = static_cast<uint32_t>(static_cast<uint64_t>(count) * i / threadCount);
+        uint32_t end = static_cast<uint32_t>(static_cast<uint64_t>(count) * (i + 1) / threadCount);
+        std::lock_guard<std::mutex> queueLock(_queues[i]->mutex);
+        _queues[i]->generation = _generation;
+        for (uint32_t item = begin; item < end; item++)
+            _queues[i]->items.push_back(item);
+    }
+
+    _workAvailable.notify_all();
+    _workDone.wait(lock, [&]() { return _remaining == 0 && _activeThreads == 0; });
+    _task = nullptr;
+}
+
+void ThreadPool::WorkerLoop(uint32_t threadIndex)
+{
+    uint64_t generation = 0;
+    while (true)
+    {
+        const std::function<void(uint32_t)>* task;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _workAvailable.wait(lock, [&]() { return _stop || _generation != generation; });
+            if (_stop)
+                return;
+            generation = _generation;
+            task = _task;
+            _activeThreads++;
+        }
+
+        // Items of a later call are left to the next round, they belong to another task
+        uint32_t item;
+        while (PopOrSteal(threadIndex, generation, item))
+        {
+            (*task)(item);
+            _remaining--;
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _activeThreads--;
+        _workDone.notify_all();
+    }
+}
+
+bool ThreadPool::PopOrSteal(uint32_t threadIndex, uint64_t generation, uint32_t& item)
+{
+    {
+        Queue& own = *_queues[threadIndex];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (own.generation == generation && !own.items.empty())
+        {
+            item = own.items.front();
+            own.items.pop_front();
+            return true;
+        }
+    }
+
+    uint32_t threadCount = GetThreadCount();
+    for (uint32_t offset = 1; offset < threadCount; offset++)
+    {
+        Queue& victim = *_queues[(threadIndex + offset) % threadCount];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.generation == generation && !victim.items.empty())
+        {
+            item = victim.items.back();
+            victim.items.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+/* Fixed set of threads that run the indices of a ParallelFor.	*/
+/* Each thread starts on its own contiguous share and steals	*/
+/* from the back of other queues once its own one is empty		*/
+class ThreadPool
+{
+public:
+	/* 0 uses one thread per hardware thread					*/
+	ThreadPool(uint32_t threadCount = 0);
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/* Runs task(i) for every i below count, blocks until all	*/
+	/* finished. Not reentrant									*/
+	void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& task);
+
+	uint32_t GetThreadCount() { return static_cast<uint32_t>(_threads.size()); }
+
+private:
+
+	struct Queue
+	{
+		std::mutex mutex;
+		/* ParallelFor call the items belong to					*/
+		uint64_t generation = 0;
+		std::deque<uint32_t> items;
+	};
+
+	void WorkerLoop(uint32_t threadIndex);
+	/* Only takes items of the given ParallelFor call			*/
+	bool PopOrSteal(uint32_t threadIndex, uint64_t generation, uint32_t& item);
+
+	std::vector<std::thread> _threads;
+	std::vector<std::unique_ptr<Queue>> _queues;
+
+	std::mutex _mutex;
+	std::condition_variable _workAvailable;
+	std::condition_variable _workDone;
+	const std::function<void(uint32_t)>* _task;
+	uint64_t _generation;
+	std::atomic<uint32_t> _remaining;
+	/* Threads inside a ParallelFor, ParallelFor returns only	*/
+	/* once none of them can still pick up an item				*/
+	uint32_t _activeThreads;
+	bool _stop;
+};
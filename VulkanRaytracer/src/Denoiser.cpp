@@ -0,0 +1,114 @@
+#include "Denoiser.h"
+
+// Matches DenoiseData in Denoise.comp
+struct DenoiseData
+{
+    uint32_t raysPerPixel;
+    uint32_t pass;
+    uint32_t last;
+    float colorPhi;
+    float normalPhi;
+    float depthPhi;
+};
+
+// Scope names have to outlive the profiler
+static const char* PassNames[Denoiser::MaxIterations + 1] = {
+    "Denoise prepare", "A-trous 1", "A-trous 2", "A-trous 4", "A-trous 8", "A-trous 16"
+};
+
+Denoiser::Denoiser(Image* accumulationImage, Image* outputImage, Image* statisticsImage, Image* featureImage, Image* albedoImage, uint32_t frameCount)
+    : _timer(frameCount, Renderer::Get()->GetComputeQueueFamilyIndex())
+{
+    SpirvHelper::Init();
+    _shader = std::make_unique<Shader>("res/Shaders/Denoise.comp");
+    SpirvHelper::Finalize();
+
+    _layout = std::make_unique<DescriptorSetLayout>(std::vector<DescriptorSetLayout::DescriptorSetInfo>{
+        { 1, DescriptorType::StorageImage, ShaderStage::Compute },
+        { 1, DescriptorType::StorageImage, ShaderStage::Compute },
+        { 1, DescriptorType::StorageImage, ShaderStage::Compute },
+        { 1, DescriptorType::StorageImage, ShaderStage::Compute },
+        { 1, DescriptorType::StorageImage, ShaderStage::Compute },
+        { 1, DescriptorType::StorageImage, ShaderStage::Compute },
+        { 1, DescriptorType::StorageImage, ShaderStage::Compute },
+        });
+
+    _pipeline = std::make_unique<ComputePipeline>(ComputePipeline::PipelineInfo{
+        _shader->GetShaderStage(),
+        _layout->GetHandle(),
+        VK_NULL_HANDLE
+        });
+
+    _extent = { accumulationImage->Width(), accumulationImage->Height() };
+    std::vector<uint8_t> zero(4 * 4 * _extent.width * _extent.height, 0);
+    for (std::unique_ptr<Image>& image : _filterImages)
+    {
+        image = std::make_unique<Image>(_extent, Format::R32G32B32A32_Sfloat, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+        image->SetData(zero.data(), static_cast<uint32_t>(zero.size()), ImageLayout::General);
+    }
+
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        _descriptors[i] = Renderer::Get()->AllocateDescriptorSet(_layout->GetHandle());
+        Renderer::Get()->UpdateDescriptorSet(_descriptors[i], {
+            { 0, DescriptorType::StorageImage, {}, {VK_NULL_HANDLE, accumulationImage->GetImageView(), VK_IMAGE_LAYOUT_GENERAL}},
+            { 1, DescriptorType::StorageImage, {}, {VK_NULL_HANDLE, outputImage->GetImageView(), VK_IMAGE_LAYOUT_GENERAL}},
+            { 2, DescriptorType::StorageImage, {}, {VK_NULL_HANDLE, statisticsImage->GetImageView(), VK_IMAGE_LAYOUT_GENERAL}},
+            { 3, DescriptorType::StorageImage, {}, {VK_NULL_HANDLE, featureImage->GetImageView(), VK_IMAGE_LAYOUT_GENERAL}},
+            { 4, DescriptorType::StorageImage, {}, {VK_NULL_HANDLE, albedoImage->GetImageView(), VK_IMAGE_LAYOUT_GENERAL}},
+            { 5, DescriptorType::StorageImage, {}, {VK_NULL_HANDLE, _filterImages[1 - i]->GetImageView(), VK_IMAGE_LAYOUT_GENERAL}},
+            { 6, DescriptorType::StorageImage, {}, {VK_NULL_HANDLE, _filterImages[i]->GetImageView(), VK_IMAGE_LAYOUT_GENERAL}},
+            });
+    }
+
+    _iterations = parameters.maxIterations;
+}
+
+Denoiser::~Denoiser()
+{
+
+}
+
+void Denoiser::CmdDenoise(VkCommandBuffer cmd, const FrameData& frameData, uint32_t frameIndex, GpuProfiler* profiler)
+{
+    uint32_t maxIterations = std::clamp(parameters.maxIterations, 1u, MaxIterations);
+    double denoiseMs;
+    // Without timestamps the budget can not be measured, always run the maximum
+    if (parameters.budgetMs <= 0.0 || !_timer.IsSupported())
+    {
+        _iterations = maxIterations;
+    }
+    else if (_timer.GetResult(frameIndex, denoiseMs))
+    {
+        // Like the accumulation budget, grow by one pass and shrink immediately
+        double passMs = std::max(denoiseMs / (_iterations + 1), 0.01);
+        uint32_t target = static_cast<uint32_t>(std::max(parameters.budgetMs / passMs - 1.0, 1.0));
+        _iterations = std::clamp(std::min(target, _iterations + 1), 1u, maxIterations);
+    }
+
+    DenoiseData data = { frameData.raysPerPixel, 0, 0, parameters.colorPhi, parameters.normalPhi, parameters.depthPhi };
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline->GetHandle());
+
+    VkMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    _timer.CmdBegin(cmd, frameIndex);
+    for (data.pass = 0; data.pass <= _iterations; data.pass++)
+    {
+        // The accumulation dispatches before the first pass and every pass before the next
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+        if (profiler)
+            profiler->CmdBeginScope(cmd, PassNames[data.pass]);
+
+        data.last = data.pass == _iterations ? 1 : 0;
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline->GetLayout(), 0, 1, &_descriptors[data.pass % 2], 0, nullptr);
+        vkCmdPushConstants(cmd, _pipeline->GetLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(data), &data);
+        vkCmdDispatch(cmd, (_extent.width + 15) / 16, (_extent.height + 15) / 16, 1);
+
+        if (profiler)
+            profiler->CmdEndScope(cmd);
+    }
+    _timer.CmdEnd(cmd, frameIndex);
+}
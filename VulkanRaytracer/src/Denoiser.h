@@ -0,0 +1,59 @@
+#pragma once
+#include "Vulkan/VKHeaders.h"
+#include "RayTracingStructs.h"
+
+/* Edge-avoiding a-trous filter of the accumulated image into	*/
+/* the output image, guided by the first hit features and the	*/
+/* sample statistics of a PathTracer with frameData.denoise on.	*/
+/* Every filter pass doubles the footprint, the number of		*/
+/* passes follows the measured GPU time of earlier frames		*/
+class Denoiser
+{
+public:
+	struct Parameters
+	{
+		/* Luminance differences in standard deviations of the	*/
+		/* pixel mean that still blur							*/
+		float colorPhi = 4.0f;
+		/* Exponent of the normal weight							*/
+		float normalPhi = 128.0f;
+		/* Relative distance change per pixel that still blurs	*/
+		float depthPhi = 0.05f;
+		/* GPU time of all passes, 0 always runs the maximum		*/
+		double budgetMs = 2.0;
+		uint32_t maxIterations = 5;
+	};
+
+	/* Compiles Denoise.comp like EnvironmentMap does, the		*/
+	/* images are the ones of the PathTracer it filters.		*/
+	/* frameCount is the number of frames in flight, the		*/
+	/* budget timer records on the Renderer's compute queue	*/
+	Denoiser(Image* accumulationImage, Image* outputImage, Image* statisticsImage, Image* featureImage, Image* albedoImage, uint32_t frameCount);
+	~Denoiser();
+
+	/* Records the prepare and filter passes after the			*/
+	/* accumulation dispatches of the frame in flight			*/
+	/* frameIndex, the profiler gets a scope per pass when given	*/
+	void CmdDenoise(VkCommandBuffer cmd, const FrameData& frameData, uint32_t frameIndex, GpuProfiler* profiler = nullptr);
+
+	/* Filter passes of the last recorded frame				*/
+	uint32_t GetIterations() { return _iterations; }
+
+	Parameters parameters;
+
+	static constexpr uint32_t MaxIterations = 5;
+
+private:
+
+	std::unique_ptr<Shader> _shader;
+	std::unique_ptr<DescriptorSetLayout> _layout;
+	std::unique_ptr<ComputePipeline> _pipeline;
+	/* Set i writes _filterImages[i] and reads the other one	*/
+	VkDescriptorSet _descriptors[2];
+
+	std::array<std::unique_ptr<Image>, 2> _filterImages;
+	VkExtent2D _extent;
+
+	TimestampQuery _timer;
+	uint32_t _iterations;
+};
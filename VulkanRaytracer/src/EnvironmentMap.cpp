@@ -0,0 +1,73 @@
+#include "EnvironmentMap.h"
+
+EnvironmentMap::EnvironmentMap()
+{
+    SpirvHelper::Init();
+    _shader = std::make_unique<Shader>("res/Shaders/Environment.comp");
+    SpirvHelper::Finalize();
+
+    _layout = std::make_unique<DescriptorSetLayout>(std::vector<DescriptorSetLayout::DescriptorSetInfo>{
+        { 1, DescriptorType::StorageImage, ShaderStage::Compute },
+        { 1, DescriptorType::StorageBuffer, ShaderStage::Compute },
+        });
+
+    _descriptor = Renderer::Get()->AllocateDescriptorSet(_layout->GetHandle());
+    _pipeline = std::make_unique<ComputePipeline>(ComputePipeline::PipelineInfo{
+        _shader->GetShaderStage(),
+        _layout->GetHandle(),
+        VK_NULL_HANDLE
+        });
+
+    VkExtent2D extent = { EnvironmentWidth, EnvironmentHeight };
+    _radianceImage = std::make_unique<Image>(extent, Format::R32G32B32A32_Sfloat, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+    std::vector<uint8_t> zero(4 * 4 * EnvironmentWidth * EnvironmentHeight, 0);
+    _radianceImage->SetData(zero.data(), static_cast<uint32_t>(zero.size()), ImageLayout::General);
+
+    _distributionBuffer = std::make_unique<Buffer>(EnvironmentDistributionSize * sizeof(float), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    Renderer::Get()->UpdateDescriptorSet(_descriptor, {
+        { 0, DescriptorType::StorageImage, {}, {VK_NULL_HANDLE, _radianceImage->GetImageView(), VK_IMAGE_LAYOUT_GENERAL}},
+        { 1, DescriptorType::StorageBuffer, {_distributionBuffer->GetHandle(), 0, VK_WHOLE_SIZE}, {}},
+        });
+
+    _parameters = {};
+    _built = false;
+}
+
+EnvironmentMap::~EnvironmentMap()
+{
+
+}
+
+void EnvironmentMap::CmdUpdate(VkCommandBuffer cmd, const FrameData& frameData)
+{
+    EnvironmentParameters parameters = EnvironmentParameters::FromFrameData(frameData);
+    if (_built && parameters == _parameters)
+        return;
+    _parameters = parameters;
+    _built = true;
+
+    // Earlier dispatches may still read the distribution, and each pass reads what the previous one wrote
+    VkMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline->GetHandle());
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline->GetLayout(), 0, 1, &_descriptor, 0, nullptr);
+    for (uint32_t pass = 0; pass < 3; pass++)
+    {
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+        parameters.pass = pass;
+        vkCmdPushConstants(cmd, _pipeline->GetLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(parameters), &parameters);
+        // One invocation per texel, then per row, then a single one
+        if (pass == 0)
+            vkCmdDispatch(cmd, (EnvironmentWidth + 63) / 64, EnvironmentHeight, 1);
+        else if (pass == 1)
+            vkCmdDispatch(cmd, (EnvironmentHeight + 63) / 64, 1, 1);
+        else
+            vkCmdDispatch(cmd, 1, 1, 1);
+    }
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "Vulkan/VKHeaders.h"
+#include "RayTracingStructs.h"
+
+/* The sky baked into a lat-long image and the distribution	*/
+/* Raytracing.comp importance samples it with, both rebuilt on	*/
+/* the GPU whenever the sky parameters change					*/
+class EnvironmentMap
+{
+public:
+	/* Compiles Environment.comp, so every PathTracer gets one	*/
+	/* without its callers loading another shader				*/
+	EnvironmentMap();
+	~EnvironmentMap();
+
+	/* Records the bake and the CDF passes if the sky of		*/
+	/* frameData differs from the last recorded one			*/
+	void CmdUpdate(VkCommandBuffer cmd, const FrameData& frameData);
+
+	Image* GetRadianceImage() { return _radianceImage.get(); }
+	Buffer* GetDistributionBuffer() { return _distributionBuffer.get(); }
+
+private:
+
+	std::unique_ptr<Shader> _shader;
+	std::unique_ptr<DescriptorSetLayout> _layout;
+	std::unique_ptr<ComputePipeline> _pipeline;
+	VkDescriptorSet _descriptor;
+
+	std::unique_ptr<Image> _radianceImage;
+	std::unique_ptr<Buffer> _distributionBuffer;
+
+	EnvironmentParameters _parameters;
+	bool _built;
+};
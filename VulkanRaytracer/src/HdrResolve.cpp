@@ -0,0 +1,48 @@
+#include "HdrResolve.h"
+
+HdrResolve::HdrResolve(Image* accumulationImage, VkPipelineShaderStageCreateInfo resolveShaderStage, bool halfFloat)
+{
+    _extent = { accumulationImage->Width(), accumulationImage->Height() };
+    _halfFloat = halfFloat;
+
+    _layout = std::make_unique<DescriptorSetLayout>(std::vector<DescriptorSetLayout::DescriptorSetInfo>{
+        { 1, DescriptorType::StorageImage, ShaderStage::Compute },
+        { 1, DescriptorType::StorageBuffer, ShaderStage::Compute },
+        });
+
+    _descriptor = Renderer::Get()->AllocateDescriptorSet(_layout->GetHandle());
+    _pipeline = std::make_unique<ComputePipeline>(ComputePipeline::PipelineInfo{
+        resolveShaderStage,
+        _layout->GetHandle(),
+        VK_NULL_HANDLE
+        });
+
+    _buffer = std::make_unique<Buffer>(_extent.width * _extent.height * GetBytesPerPixel(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    Renderer::Get()->UpdateDescriptorSet(_descriptor, {
+        { 0, DescriptorType::StorageImage, {}, {VK_NULL_HANDLE, accumulationImage->GetImageView(), VK_IMAGE_LAYOUT_GENERAL}},
+        { 1, DescriptorType::StorageBuffer, {_buffer->GetHandle(), 0, VK_WHOLE_SIZE}, {}},
+        });
+}
+
+HdrResolve::~HdrResolve()
+{
+
+}
+
+void HdrResolve::CmdResolve(VkCommandBuffer cmd)
+{
+    // Wait for the accumulation dispatches, and for earlier copies out of the buffer
+    VkMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    uint32_t pushData[1] = { _halfFloat ? 1u : 0u };
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline->GetHandle());
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline->GetLayout(), 0, 1, &_descriptor, 0, nullptr);
+    vkCmdPushConstants(cmd, _pipeline->GetLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushData), pushData);
+    vkCmdDispatch(cmd, (_extent.width + 15) / 16, (_extent.height + 15) / 16, 1);
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "Vulkan/VKHeaders.h"
+
+/* Divides the accumulation image by the number of accumulated	*/
+/* frames of every pixel, its alpha, into a linear rgba buffer,	*/
+/* float or half per channel									*/
+class HdrResolve
+{
+public:
+	HdrResolve(Image* accumulationImage, VkPipelineShaderStageCreateInfo resolveShaderStage, bool halfFloat);
+	~HdrResolve();
+
+	void CmdResolve(VkCommandBuffer cmd);
+
+	Buffer* GetBuffer() { return _buffer.get(); }
+	uint32_t GetBytesPerPixel() { return _halfFloat ? 8 : 16; }
+	bool IsHalfFloat() { return _halfFloat; }
+
+private:
+
+	VkExtent2D _extent;
+	bool _halfFloat;
+
+	std::unique_ptr<DescriptorSetLayout> _layout;
+	std::unique_ptr<ComputePipeline> _pipeline;
+	VkDescriptorSet _descriptor;
+	std::unique_ptr<Buffer> _buffer;
+};
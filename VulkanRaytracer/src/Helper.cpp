@@ -1,5 +1,12 @@
 #include "Helper.h"
 #include "../dependencies/stb/stb_image.h"
+#include "../dependencies/stb/stb_image_write.h"
+#include <vector>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
 
 void* LoadImageFromFile(const char* filePath)
 {
@@ -12,4 +19,299 @@ void* LoadImageFromFile(const char* filePath)
 void ReleaseImageData(void* data)
 {
     stbi_image_free(data);
-}
\ No newline at end of file
+}
+
+static const uint8_t* GetSRGBTable()
+{
+    static const std::array<uint8_t, 256> table = []() {
+        std::array<uint8_t, 256> result;
+        for (int i = 0; i < 256; i++)
+        {
+            float linear = i / 255.0f;
+            float srgb = linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+            result[i] = static_cast<uint8_t>(std::round(srgb * 255.0f));
+        }
+        return result;
+    }();
+    return table.data();
+}
+
+bool WriteImagePNG(const std::string& path, uint32_t width, uint32_t height, const uint8_t* linearPixels)
+{
+    const uint8_t* table = GetSRGBTable();
+    std::vector<uint8_t> pixels(4 * width * height);
+    for (size_t i = 0; i < pixels.size(); i += 4)
+    {
+        pixels[i + 0] = table[linearPixels[i + 0]];
+        pixels[i + 1] = table[linearPixels[i + 1]];
+        pixels[i + 2] = table[linearPixels[i + 2]];
+        pixels[i + 3] = 0xFF;
+    }
+
+    return stbi_write_png(path.c_str(), width, height, 4, pixels.data(), width * 4) != 0;
+}
+
+bool WriteImagePFM(const std::string& path, uint32_t width, uint32_t height, const float* pixels)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    // Negative scale means little endian, scanlines are stored bottom to top
+    file << "PF\n" << width << " " << height << "\n-1.0\n";
+    std::vector<float> row(3 * width);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        const float* src = pixels + 4 * static_cast<size_t>(height - 1 - y) * width;
+        for (uint32_t x = 0; x < width; x++)
+        {
+            row[3 * x + 0] = src[4 * x + 0];
+            row[3 * x + 1] = src[4 * x + 1];
+            row[3 * x + 2] = src[4 * x + 2];
+        }
+        file.write(reinterpret_cast<const char*>(row.data()), row.size() * sizeof(float));
+    }
+    return file.good();
+}
+
+bool ReadImagePFM(const std::string& path, uint32_t& width, uint32_t& height, std::vector<float>& pixels)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    std::string type;
+    float scale;
+    file >> type >> width >> height >> scale;
+    file.get();
+    if (!file || (type != "PF" && type != "Pf") || width == 0 || height == 0)
+        return false;
+
+    uint32_t channels = type == "PF" ? 3 : 1;
+    std::vector<float> row(static_cast<size_t>(channels) * width);
+    pixels.resize(4 * static_cast<size_t>(width) * height);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        if (!file.read(reinterpret_cast<char*>(row.data()), row.size() * sizeof(float)))
+            return false;
+
+        // A positive scale means big endian
+        if (scale > 0.0f)
+        {
+            for (float& value : row)
+            {
+                uint8_t* bytes = reinterpret_cast<uint8_t*>(&value);
+                std::reverse(bytes, bytes + sizeof(float));
+            }
+        }
+
+        float* dst = pixels.data() + 4 * static_cast<size_t>(height - 1 - y) * width;
+        for (uint32_t x = 0; x < width; x++)
+        {
+            for (uint32_t c = 0; c < 3; c++)
+                dst[4 * x + c] = row[channels * x + (channels == 3 ? c : 0)];
+            dst[4 * x + 3] = 1.0f;
+        }
+    }
+    return true;
+}
+
+bool WriteImageEXR(const std::string& path, uint32_t width, uint32_t height, const void* pixels, bool halfFloat)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    // Everything in the file is little endian
+    auto writeBytes = [&](const void* data, size_t size) { file.write(static_cast<const char*>(data), size); };
+    auto writeInt = [&](int32_t value) { writeBytes(&value, sizeof(value)); };
+    auto writeString = [&](const char* str) { writeBytes(str, strlen(str) + 1); };
+    auto writeAttribute = [&](const char* name, const char* type, int32_t size) {
+        writeString(name);
+        writeString(type);
+        writeInt(size);
+    };
+
+    const uint32_t magic = 20000630;
+    const uint32_t version = 2;
+    writeBytes(&magic, sizeof(magic));
+    writeBytes(&version, sizeof(version));
+
+    // Channels are sorted by name, every entry is name, pixel type, pLinear, reserved and sampling
+    const int32_t pixelType = halfFloat ? 1 : 2;
+    const char* channelNames[] = { "B", "G", "R" };
+    writeAttribute("channels", "chlist", 3 * (2 + 16) + 1);
+    for (const char* name : channelNames)
+    {
+        writeString(name);
+        writeInt(pixelType);
+        const uint8_t linearAndReserved[4] = { 0, 0, 0, 0 };
+        writeBytes(linearAndReserved, sizeof(linearAndReserved));
+        writeInt(1);
+        writeInt(1);
+    }
+    writeBytes("", 1);
+
+    const uint8_t noCompression = 0;
+    writeAttribute("compression", "compression", 1);
+    writeBytes(&noCompression, 1);
+
+    const int32_t window[4] = { 0, 0, static_cast<int32_t>(width) - 1, static_cast<int32_t>(height) - 1 };
+    writeAttribute("dataWindow", "box2i", sizeof(window));
+    writeBytes(window, sizeof(window));
+    writeAttribute("displayWindow", "box2i", sizeof(window));
+    writeBytes(window, sizeof(window));
+
+    const uint8_t increasingY = 0;
+    writeAttribute("lineOrder", "lineOrder", 1);
+    writeBytes(&increasingY, 1);
+
+    const float one = 1.0f;
+    const float center[2] = { 0.0f, 0.0f };
+    writeAttribute("pixelAspectRatio", "float", sizeof(float));
+    writeBytes(&one, sizeof(one));
+    writeAttribute("screenWindowCenter", "v2f", sizeof(center));
+    writeBytes(center, sizeof(center));
+    writeAttribute("screenWindowWidth", "float", sizeof(float));
+    writeBytes(&one, sizeof(one));
+    writeBytes("", 1);
+
+    // Without compression every scanline is its own block
+    const size_t channelSize = halfFloat ? 2 : 4;
+    const size_t lineSize = 3 * channelSize * width;
+    uint64_t offset = static_cast<uint64_t>(file.tellp()) + sizeof(uint64_t) * height;
+    for (uint32_t y = 0; y < height; y++)
+    {
+        writeBytes(&offset, sizeof(offset));
+        offset += 2 * sizeof(int32_t) + lineSize;
+    }
+
+    const uint8_t* src = static_cast<const uint8_t*>(pixels);
+    std::vector<uint8_t> line(lineSize);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        const uint8_t* row = src + 4 * channelSize * static_cast<size_t>(y) * width;
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            // B, G, R planes from interleaved rgba
+            size_t channel = 2 - c;
+            uint8_t* dst = line.data() + c * channelSize * width;
+            for (uint32_t x = 0; x < width; x++)
+                memcpy(dst + x * channelSize, row + (4 * x + channel) * channelSize, channelSize);
+        }
+        writeInt(static_cast<int32_t>(y));
+        writeInt(static_cast<int32_t>(lineSize));
+        writeBytes(line.data(), lineSize);
+    }
+    return file.good();
+}
+
+static uint16_t FloatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    if (((bits >> 23) & 0xFF) == 0xFF)
+        return static_cast<uint16_t>(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+    if (exponent >= 31)
+        return static_cast<uint16_t>(sign | 0x7C00);
+    if (exponent <= 0)
+    {
+        // Denormals, anything below the smallest one flushes to zero
+        if (exponent < -10)
+            return static_cast<uint16_t>(sign);
+        mantissa |= 0x800000;
+        return static_cast<uint16_t>(sign | (mantissa >> (14 - exponent)));
+    }
+    return static_cast<uint16_t>(sign | (exponent << 10) | (mantissa >> 13));
+}
+
+bool WriteImageLinear(const std::string& path, uint32_t width, uint32_t height, const float* pixels, bool halfFloat)
+{
+    std::string extension = path.size() >= 4 ? path.substr(path.size() - 4) : "";
+    size_t count = 4 * static_cast<size_t>(width) * height;
+    if (extension == ".pfm")
+        return WriteImagePFM(path, width, height, pixels);
+
+    if (extension == ".exr")
+    {
+        if (!halfFloat)
+            return WriteImageEXR(path, width, height, pixels, false);
+
+        std::vector<uint16_t> halfs(count);
+        for (size_t i = 0; i < count; i++)
+            halfs[i] = FloatToHalf(pixels[i]);
+        return WriteImageEXR(path, width, height, halfs.data(), true);
+    }
+
+    // Same quantization as the rgba8 output image
+    std::vector<uint8_t> linear(count);
+    for (size_t i = 0; i < count; i++)
+        linear[i] = static_cast<uint8_t>(std::clamp(pixels[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+    return WriteImagePNG(path, width, height, linear.data());
+}
+
+bool Y4MWriter::Open(const std::string& path, uint32_t width, uint32_t height, uint32_t framesPerSecond)
+{
+    _file.open(path, std::ios::binary);
+    if (!_file.is_open())
+        return false;
+
+    _width = width;
+    _height = height;
+    uint32_t chromaWidth = (width + 1) / 2;
+    uint32_t chromaHeight = (height + 1) / 2;
+    _planes.resize(width * height + 2 * chromaWidth * chromaHeight);
+
+    _file << "YUV4MPEG2 W" << width << " H" << height << " F" << framesPerSecond << ":1 Ip A1:1 C420jpeg\n";
+    return _file.good();
+}
+
+bool Y4MWriter::WriteFrame(const uint8_t* linearPixels)
+{
+    const uint8_t* table = GetSRGBTable();
+    uint32_t chromaWidth = (_width + 1) / 2;
+    uint32_t chromaHeight = (_height + 1) / 2;
+    uint8_t* yPlane = _planes.data();
+    uint8_t* uPlane = yPlane + _width * _height;
+    uint8_t* vPlane = uPlane + chromaWidth * chromaHeight;
+
+    for (uint32_t y = 0; y < _height; y++)
+    {
+        for (uint32_t x = 0; x < _width; x++)
+        {
+            const uint8_t* p = linearPixels + 4 * (static_cast<size_t>(y) * _width + x);
+            float r = table[p[0]] / 255.0f;
+            float g = table[p[1]] / 255.0f;
+            float b = table[p[2]] / 255.0f;
+            yPlane[y * _width + x] = static_cast<uint8_t>(std::lround(16.0f + 65.481f * r + 128.553f * g + 24.966f * b));
+        }
+    }
+
+    // Chroma of each 2x2 block, edge pixels repeat on odd sizes
+    for (uint32_t cy = 0; cy < chromaHeight; cy++)
+    {
+        for (uint32_t cx = 0; cx < chromaWidth; cx++)
+        {
+            float r = 0.0f, g = 0.0f, b = 0.0f;
+            for (uint32_t i = 0; i < 4; i++)
+            {
+                uint32_t x = std::min(2 * cx + (i & 1), _width - 1);
+                uint32_t y = std::min(2 * cy + (i >> 1), _height - 1);
+                const uint8_t* p = linearPixels + 4 * (static_cast<size_t>(y) * _width + x);
+                r += table[p[0]] / (4.0f * 255.0f);
+                g += table[p[1]] / (4.0f * 255.0f);
+                b += table[p[2]] / (4.0f * 255.0f);
+            }
+            uPlane[cy * chromaWidth + cx] = static_cast<uint8_t>(std::lround(128.0f - 37.797f * r - 74.203f * g + 112.0f * b));
+            vPlane[cy * chromaWidth + cx] = static_cast<uint8_t>(std::lround(128.0f + 112.0f * r - 93.786f * g - 18.214f * b));
+        }
+    }
+
+    _file << "FRAME\n";
+    _file.write(reinterpret_cast<const char*>(_planes.data()), _planes.size());
+    return _file.good();
+}
@@ -1,4 +1,39 @@
 #pragma once
+#include <string>
+#include <cstdint>
+#include <vector>
+#include <fstream>
 
 void* LoadImageFromFile(const char* filePath);
-void ReleaseImageData(void* data);
\ No newline at end of file
+void ReleaseImageData(void* data);
+
+/* Encodes linear RGBA8 pixels to sRGB and writes a png	*/
+/* Matches what the present pass writes to the swapchain	*/
+bool WriteImagePNG(const std::string& path, uint32_t width, uint32_t height, const uint8_t* linearPixels);
+
+/* Linear rgba float pixels, top row first, alpha is dropped	*/
+bool WriteImagePFM(const std::string& path, uint32_t width, uint32_t height, const float* pixels);
+/* Reads what WriteImagePFM writes, 1 or 3 channels of either	*/
+/* byte order, into rgba floats with the top row first			*/
+bool ReadImagePFM(const std::string& path, uint32_t& width, uint32_t& height, std::vector<float>& pixels);
+/* Uncompressed scanline OpenEXR with R, G and B channels		*/
+/* pixels holds four halfs or four floats per pixel, top row first	*/
+bool WriteImageEXR(const std::string& path, uint32_t width, uint32_t height, const void* pixels, bool halfFloat);
+/* Picks png, exr or pfm from the extension of path, png is sRGB encoded	*/
+bool WriteImageLinear(const std::string& path, uint32_t width, uint32_t height, const float* pixels, bool halfFloat);
+
+/* Raw YUV4MPEG2 stream, 4:2:0 BT.601 limited range			*/
+/* Frames are appended in the order WriteFrame is called	*/
+class Y4MWriter
+{
+public:
+	bool Open(const std::string& path, uint32_t width, uint32_t height, uint32_t framesPerSecond);
+	/* Linear RGBA8 pixels, sRGB encoded like WriteImagePNG		*/
+	bool WriteFrame(const uint8_t* linearPixels);
+
+private:
+	std::ofstream _file;
+	uint32_t _width = 0;
+	uint32_t _height = 0;
+	std::vector<uint8_t> _planes;
+};
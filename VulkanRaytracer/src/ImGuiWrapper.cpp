@@ -152,4 +152,60 @@ void ImGuiEndFrame(VkCommandBuffer cmd)
 	ImGui::Render();
 	//ImGui::UpdatePlatformWindows();
 	ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmd);
-}
\ No newline at end of file
+}
+
+void ImGuiProfilerWindow(GpuProfiler& profiler)
+{
+	ImGui::Begin("GPU Profiler", 0, ImGuiWindowFlags_AlwaysAutoResize);
+	if (ImGui::BeginTable("Scopes", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+	{
+		ImGui::TableSetupColumn("Scope");
+		ImGui::TableSetupColumn("Last ms");
+		ImGui::TableSetupColumn("Avg ms");
+		ImGui::TableSetupColumn("Min ms");
+		ImGui::TableSetupColumn("Max ms");
+		ImGui::TableHeadersRow();
+		for (const GpuProfiler::ScopeStatistics& scope : profiler.GetStatistics())
+		{
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::Text("%*s%s", scope.depth * 2, "", scope.name.c_str());
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", scope.lastMs);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", scope.averageMs);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", scope.minMs);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", scope.maxMs);
+		}
+		ImGui::EndTable();
+	}
+
+	// Only the instrumented shader counts rays
+	const Renderer::RenderStatistics& statistics = Renderer::Get()->renderStatistics;
+	if (statistics.primaryRays > 0)
+	{
+		double rays = static_cast<double>(statistics.primaryRays + statistics.secondaryRays);
+		ImGui::Separator();
+		ImGui::Text("%.1f M rays/s", statistics.raysPerSecond / 1e6);
+		ImGui::Text("%.2f rays per path", rays / statistics.primaryRays);
+		ImGui::Text("Per ray: %.1f triangle, %.1f box, %.1f sphere tests", statistics.triangleTests / rays,
+			statistics.boxTests / rays, statistics.sphereTests / rays);
+	}
+
+	if (!profiler.IsCapturing())
+	{
+		if (ImGui::Button("Record trace"))
+		{
+			std::filesystem::create_directories("Profile");
+			if (!profiler.StartCapture("Profile/gpu_trace.json"))
+				Logger::PrintError("Failed to open Profile/gpu_trace.json");
+		}
+	}
+	else if (ImGui::Button("Stop recording"))
+	{
+		profiler.StopCapture();
+	}
+	ImGui::End();
+}
@@ -4,8 +4,15 @@
 #include "../dependencies/imgui-master/imgui_impl_glfw.h"
 #include "../dependencies/imgui-master/imgui_impl_vulkan.h"
 
+class GpuProfiler;
+
 void ImGuiInit(GLFWwindow* window);
 void ImGuiShutdown();
 
 void ImGuiBeginFrame();
-void ImGuiEndFrame(VkCommandBuffer cmd);
\ No newline at end of file
+void ImGuiEndFrame(VkCommandBuffer cmd);
+
+/* Timings of the profiler scopes and a button to record a	*/
+/* Chrome trace to Profile/gpu_trace.json, also the ray		*/
+/* counts of Renderer::renderStatistics when instrumented	*/
+void ImGuiProfilerWindow(GpuProfiler& profiler);
\ No newline at end of file
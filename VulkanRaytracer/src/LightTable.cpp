@@ -0,0 +1,74 @@
+#include "LightTable.h"
+#include <cmath>
+#include <cstdint>
+
+static const float Pi = 3.14159265f;
+
+std::vector<Light> CollectLights(const std::vector<Sphere>& spheres, const std::vector<Triangle>& triangles, const std::vector<Mesh>& meshes)
+{
+    std::vector<Light> lights;
+    for (size_t i = 0; i < spheres.size(); i++)
+    {
+        const Sphere& sphere = spheres[i];
+        if (sphere.material.light <= 0.0f)
+            continue;
+        float area = 4.0f * Pi * sphere.radius * sphere.radius;
+        lights.push_back({ 1.0f, 0, static_cast<int>(i), -1, sphere.material.light * area, sphere.material.light });
+    }
+
+    for (const Mesh& mesh : meshes)
+    {
+        if (mesh.material.light <= 0.0f)
+            continue;
+        for (int j = mesh.startTriangle; j < mesh.startTriangle + mesh.numTriangles; j++)
+        {
+            const Triangle& tri = triangles[j];
+            float area = 0.5f * glm::length(glm::cross(glm::vec3(tri.p2) - glm::vec3(tri.p1), glm::vec3(tri.p3) - glm::vec3(tri.p1)));
+            // Degenerate triangles can not be hit, they get no samples either
+            if (area > 0.0f)
+                lights.push_back({ 1.0f, 0, -1, j, mesh.material.light * area, mesh.material.light });
+        }
+    }
+    return lights;
+}
+
+float BuildAliasTable(std::vector<Light>& lights)
+{
+    double total = 0.0;
+    for (const Light& light : lights)
+        total += light.power;
+    if (lights.empty() || total <= 0.0)
+        return 0.0f;
+
+    // Vose's method, slots below the average are topped up by one above it
+    std::vector<double> scaled(lights.size());
+    std::vector<uint32_t> small, large;
+    for (size_t i = 0; i < lights.size(); i++)
+    {
+        scaled[i] = lights[i].power * lights.size() / total;
+        lights[i].alias = static_cast<int>(i);
+        (scaled[i] < 1.0 ? small : large).push_back(static_cast<uint32_t>(i));
+    }
+
+    while (!small.empty() && !large.empty())
+    {
+        uint32_t less = small.back();
+        small.pop_back();
+        uint32_t more = large.back();
+        lights[less].probability = static_cast<float>(scaled[less]);
+        lights[less].alias = static_cast<int>(more);
+
+        scaled[more] -= 1.0 - scaled[less];
+        if (scaled[more] < 1.0)
+        {
+            large.pop_back();
+            small.push_back(more);
+        }
+    }
+    // Whatever is left is 1 up to rounding
+    for (uint32_t i : small)
+        lights[i].probability = 1.0f;
+    for (uint32_t i : large)
+        lights[i].probability = 1.0f;
+    return static_cast<float>(total);
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include <vector>
+#include "RayTracingStructs.h"
+
+/* The emissive spheres and the emissive triangles of meshes,	*/
+/* in that order, without alias table slots yet					*/
+std::vector<Light> CollectLights(const std::vector<Sphere>& spheres, const std::vector<Triangle>& triangles, const std::vector<Mesh>& meshes);
+
+/* Fills the alias table slots so a light is picked with		*/
+/* probability power / total power in O(1), returns the total	*/
+float BuildAliasTable(std::vector<Light>& lights);
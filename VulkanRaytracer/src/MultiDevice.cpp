@@ -0,0 +1,222 @@
+#include "MultiDevice.h"
+#include "PathTracer.h"
+#include "Scene.h"
+#include "HdrResolve.h"
+#include "AccumulationMerge.h"
+#include "Helper.h"
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+
+namespace
+{
+    struct DeviceResult
+    {
+        std::string name;
+        uint32_t dispatches = 0;
+        double renderSeconds = 0.0;
+        std::vector<float> sums;
+    };
+
+    struct SharedState
+    {
+        std::mutex mutex;
+        std::condition_variable condition;
+        uint32_t nextDispatch = 0;
+        uint32_t totalDispatches = 0;
+        uint32_t finishedDevices = 0;
+        bool written = false;
+    };
+}
+
+// Hands out the next dispatches, a device asks for as many as it renders in
+// a fixed time at its measured speed, capped so the last chunks stay small
+static bool ClaimDispatches(SharedState& state, uint32_t deviceCount, uint32_t wanted, uint32_t& start, uint32_t& count)
+{
+    std::lock_guard<std::mutex> lock(state.mutex);
+    uint32_t remaining = state.totalDispatches - state.nextDispatch;
+    if (remaining == 0)
+        return false;
+    count = std::clamp(wanted, 1u, std::max(remaining / (2 * deviceCount), 1u));
+    count = std::min(count, remaining);
+    start = state.nextDispatch;
+    state.nextDispatch += count;
+    return true;
+}
+
+static void RenderOnDevice(const MultiDeviceSettings& settings, const Scene& scene, uint32_t deviceSlot,
+    std::mutex& shaderMutex, SharedState& state, std::vector<DeviceResult>& results)
+{
+    DeviceResult& result = results[deviceSlot];
+    bool merging = deviceSlot == settings.mergeDevice;
+    uint32_t deviceCount = static_cast<uint32_t>(settings.devices.size());
+
+    std::unique_ptr<Renderer> renderer = std::make_unique<Renderer>(nullptr, 2, VK_PRESENT_MODE_FIFO_KHR, false, settings.devices[deviceSlot]);
+    result.name = Core::Get()->GetPhysicalDeviceProperties().deviceName;
+    {
+        // glslang compiles one shader at a time
+        std::unique_ptr<Shader> computeShader;
+        std::unique_ptr<Shader> resolveShader;
+        std::unique_ptr<Shader> mergeShader;
+        {
+            std::lock_guard<std::mutex> lock(shaderMutex);
+            SpirvHelper::Init();
+            computeShader = std::make_unique<Shader>("res/Shaders/Raytracing.comp");
+            if (merging)
+            {
+                resolveShader = std::make_unique<Shader>("res/Shaders/Resolve.comp");
+                mergeShader = std::make_unique<Shader>("res/Shaders/Merge.comp");
+            }
+            SpirvHelper::Finalize();
+        }
+
+        PathTracer pathTracer(settings.extent, computeShader->GetShaderStage());
+        SetSceneFrameData(scene, settings.extent, pathTracer.frameData);
+        pathTracer.SetScene(scene.spheres, scene.triangles, scene.meshes);
+
+        // The first chunk measures the device, later chunks aim for a quarter second each
+        const uint32_t dispatchesPerSubmit = 16;
+        const double chunkSeconds = 0.25;
+        uint32_t wanted = dispatchesPerSubmit;
+        uint32_t start, count;
+        while (ClaimDispatches(state, deviceCount, wanted, start, count))
+        {
+            auto chunkStart = std::chrono::high_resolution_clock::now();
+            // Seeds follow the global dispatch index while frameIndex keeps counting this device's dispatches
+            pathTracer.frameData.seedOffset = start - result.dispatches;
+            for (uint32_t rendered = 0; rendered < count;)
+            {
+                uint32_t dispatches = std::min(dispatchesPerSubmit, count - rendered);
+                VkCommandBuffer cmd = renderer->BeginFrame();
+                pathTracer.frameData.frameIndex = result.dispatches + rendered + 1;
+                pathTracer.UpdateFrameData();
+                pathTracer.CmdDispatch(cmd, dispatches);
+                renderer->EndFrame();
+                rendered += dispatches;
+            }
+            Core::Get()->WaitIdle();
+            double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - chunkStart).count();
+
+            result.dispatches += count;
+            result.renderSeconds += seconds;
+            double dispatchesPerSecond = result.dispatches / std::max(result.renderSeconds, 1e-6);
+            wanted = static_cast<uint32_t>(std::min(dispatchesPerSecond * chunkSeconds, 65536.0));
+        }
+
+        if (!merging)
+        {
+            if (result.dispatches > 0)
+            {
+                result.sums.resize(static_cast<size_t>(settings.extent.width) * settings.extent.height * 4);
+                pathTracer.GetAccumulationImage()->GetData(result.sums.data(), static_cast<uint32_t>(result.sums.size() * sizeof(float)));
+            }
+        }
+        else
+        {
+            {
+                std::unique_lock<std::mutex> lock(state.mutex);
+                state.condition.wait(lock, [&]() { return state.finishedDevices == deviceCount - 1; });
+            }
+
+            // The accumulation image starts zeroed, so a device without dispatches merges as well
+
+            AccumulationMerge merge(pathTracer.GetAccumulationImage(), mergeShader->GetShaderStage());
+            for (DeviceResult& peer : results)
+            {
+                if (peer.sums.empty())
+                    continue;
+                merge.Upload(peer.sums.data());
+                VkCommandBuffer cmd = renderer->BeginFrame();
+                merge.CmdMerge(cmd);
+                renderer->EndFrame();
+                Core::Get()->WaitIdle();
+            }
+
+            HdrResolve resolve(pathTracer.GetAccumulationImage(), resolveShader->GetShaderStage(), false);
+            ImageReadback readback(settings.extent, resolve.GetBytesPerPixel(), 1);
+            VkCommandBuffer cmd = renderer->BeginFrame();
+            resolve.CmdResolve(cmd);
+            readback.CmdCaptureBuffer(cmd, resolve.GetBuffer()->GetHandle(), [&](const void* data, VkExtent2D extent) {
+                state.written = WriteImageLinear(settings.outputPath, extent.width, extent.height, static_cast<const float*>(data), settings.halfFloat);
+                });
+            renderer->EndFrame();
+            readback.Flush();
+        }
+        Core::Get()->WaitIdle();
+    }
+    renderer.reset();
+
+    if (!merging)
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.finishedDevices++;
+        state.condition.notify_all();
+    }
+}
+
+int RunMultiDevice(const MultiDeviceSettings& settings)
+{
+    Scene scene;
+    if (settings.scenePath.empty())
+        scene = CreateDefaultScene();
+    else if (!LoadScene(settings.scenePath, scene))
+        return 1;
+
+    std::vector<std::string> deviceNames = Core::EnumeratePhysicalDevices();
+    for (int32_t device : settings.devices)
+    {
+        if (device < 0 || static_cast<size_t>(device) >= deviceNames.size())
+        {
+            std::cout << "No device " << device << ", found " << deviceNames.size() << ":" << std::endl;
+            for (size_t i = 0; i < deviceNames.size(); i++)
+                std::cout << "  " << i << ": " << deviceNames[i] << std::endl;
+            return 1;
+        }
+    }
+    if (settings.devices.empty() || settings.mergeDevice >= settings.devices.size())
+    {
+        std::cout << "The merge device must be one of the " << settings.devices.size() << " devices" << std::endl;
+        return 1;
+    }
+
+    uint32_t raysPerPixel = std::max(scene.raysPerPixel, 1u);
+    SharedState state;
+    state.totalDispatches = (settings.samplesPerPixel + raysPerPixel - 1) / raysPerPixel;
+
+    std::mutex shaderMutex;
+    std::vector<DeviceResult> results(settings.devices.size());
+    std::vector<std::thread> threads;
+    auto startTime = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < settings.devices.size(); i++)
+        threads.emplace_back(RenderOnDevice, std::cref(settings), std::cref(scene), i, std::ref(shaderMutex), std::ref(state), std::ref(results));
+    for (std::thread& thread : threads)
+        thread.join();
+    double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+    if (!state.written)
+    {
+        std::cout << "Failed to write " << settings.outputPath << std::endl;
+        return 1;
+    }
+
+    uint64_t pixels = static_cast<uint64_t>(settings.extent.width) * settings.extent.height;
+    uint64_t samplesPerPixel = static_cast<uint64_t>(state.totalDispatches) * raysPerPixel;
+    std::cout << std::fixed << std::setprecision(2)
+        << "Rendered " << settings.extent.width << "x" << settings.extent.height << " at "
+        << samplesPerPixel << " spp to " << settings.outputPath << " in " << seconds << " s ("
+        << samplesPerPixel * pixels / seconds / 1e6 << " M samples/s)" << std::endl;
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const DeviceResult& result = results[i];
+        double samples = static_cast<double>(result.dispatches) * raysPerPixel * pixels;
+        std::cout << "  device " << settings.devices[i] << " " << result.name << ": "
+            << 100.0 * result.dispatches / state.totalDispatches << "% of the samples, "
+            << samples / std::max(result.renderSeconds, 1e-6) / 1e6 << " M samples/s"
+            << (i == settings.mergeDevice ? ", merged" : "") << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include "Vulkan/VKHeaders.h"
+#include <string>
+
+/* Renders one image on several devices of this machine, each	*/
+/* device runs on its own thread with its own Renderer and		*/
+/* accumulates a disjoint set of dispatches					*/
+struct MultiDeviceSettings
+{
+	std::string scenePath;
+	std::string outputPath = "output.png";
+	VkExtent2D extent = { 1280, 720 };
+	uint32_t samplesPerPixel = 256;
+	/* Physical device of every logical device, an index may	*/
+	/* repeat to run several devices on one GPU or lavapipe	*/
+	std::vector<int32_t> devices;
+	/* Position in devices of the device that merges and		*/
+	/* resolves the accumulations								*/
+	uint32_t mergeDevice = 0;
+	bool halfFloat = false;
+};
+
+int RunMultiDevice(const MultiDeviceSettings& settings);
@@ -0,0 +1,163 @@
+#include "Socket.h"
+#include <algorithm>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+using socklen_t = int;
+#else
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <cstring>
+#define closesocket close
+#endif
+
+static void InitSockets()
+{
+#ifdef _WIN32
+    static bool initialized = []() {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    (void)initialized;
+#endif
+}
+
+Socket::Socket()
+{
+    InitSockets();
+    _handle = InvalidHandle;
+}
+
+Socket::~Socket()
+{
+    Close();
+}
+
+bool Socket::Listen(uint16_t port)
+{
+    Close();
+    _handle = static_cast<Handle>(socket(AF_INET, SOCK_STREAM, IPPROTO_TCP));
+    if (!IsValid())
+        return false;
+
+    int reuse = 1;
+    setsockopt(_handle, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (bind(_handle, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(_handle, 64) != 0)
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool Socket::Connect(const std::string& host, uint16_t port)
+{
+    Close();
+
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0)
+        return false;
+
+    for (addrinfo* info = result; info; info = info->ai_next)
+    {
+        _handle = static_cast<Handle>(socket(info->ai_family, info->ai_socktype, info->ai_protocol));
+        if (!IsValid())
+            continue;
+        if (connect(_handle, info->ai_addr, static_cast<socklen_t>(info->ai_addrlen)) == 0)
+            break;
+        Close();
+    }
+    freeaddrinfo(result);
+
+    if (!IsValid())
+        return false;
+
+    // Messages are small and latency bound
+    int noDelay = 1;
+    setsockopt(_handle, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+    return true;
+}
+
+std::unique_ptr<Socket> Socket::Accept(uint32_t timeoutMs)
+{
+    if (!IsValid())
+        return nullptr;
+
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(_handle, &readSet);
+    timeval timeout = {};
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_usec = (timeoutMs % 1000) * 1000;
+    if (select(static_cast<int>(_handle + 1), &readSet, nullptr, nullptr, &timeout) <= 0)
+        return nullptr;
+
+    Handle handle = static_cast<Handle>(accept(_handle, nullptr, nullptr));
+    if (handle == InvalidHandle)
+        return nullptr;
+
+    int noDelay = 1;
+    setsockopt(handle, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+
+    std::unique_ptr<Socket> connection = std::make_unique<Socket>();
+    connection->_handle = handle;
+    return connection;
+}
+
+bool Socket::Send(const void* data, size_t size)
+{
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0 && IsValid())
+    {
+#ifdef _WIN32
+        int sent = send(_handle, bytes, static_cast<int>(std::min<size_t>(size, 1 << 30)), 0);
+#else
+        ssize_t sent = send(_handle, bytes, size, MSG_NOSIGNAL);
+#endif
+        if (sent <= 0)
+            return false;
+        bytes += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return size == 0;
+}
+
+bool Socket::Receive(void* data, size_t size)
+{
+    char* bytes = static_cast<char*>(data);
+    while (size > 0 && IsValid())
+    {
+#ifdef _WIN32
+        int received = recv(_handle, bytes, static_cast<int>(std::min<size_t>(size, 1 << 30)), 0);
+#else
+        ssize_t received = recv(_handle, bytes, size, 0);
+#endif
+        if (received <= 0)
+            return false;
+        bytes += received;
+        size -= static_cast<size_t>(received);
+    }
+    return size == 0;
+}
+
+void Socket::Close()
+{
+    if (IsValid())
+        closesocket(_handle);
+    _handle = InvalidHandle;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <cstdint>
+
+/* Blocking TCP socket on top of winsock or POSIX sockets	*/
+class Socket
+{
+public:
+	Socket();
+	~Socket();
+	Socket(const Socket&) = delete;
+	Socket& operator=(const Socket&) = delete;
+
+	/* Listens on every interface	*/
+	bool Listen(uint16_t port);
+	/* host is a name or an address	*/
+	bool Connect(const std::string& host, uint16_t port);
+	/* Returns nullptr if no connection arrived within the timeout	*/
+	std::unique_ptr<Socket> Accept(uint32_t timeoutMs);
+
+	/* Sends or receives exactly size bytes, false once the connection is gone	*/
+	bool Send(const void* data, size_t size);
+	bool Receive(void* data, size_t size);
+
+	void Close();
+	bool IsValid() { return _handle != InvalidHandle; }
+
+private:
+
+#ifdef _WIN32
+	using Handle = uintptr_t;
+#else
+	using Handle = int;
+#endif
+	static constexpr Handle InvalidHandle = static_cast<Handle>(-1);
+
+	Handle _handle;
+};
@@ -0,0 +1,301 @@
+#include "PathTracer.h"
+#include "LightTable.h"
+
+template<typename T>
+static std::unique_ptr<Buffer> CreateStorageBuffer(const std::vector<T>& data)
+{
+    // Empty arrays still need a valid buffer to bind
+    uint32_t size = static_cast<uint32_t>(sizeof(T) * std::max<size_t>(data.size(), 1));
+    std::unique_ptr<Buffer> buffer = std::make_unique<Buffer>(size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    if (data.size() > 0)
+    {
+        void* copyData = buffer->Map();
+        memcpy(copyData, data.data(), static_cast<size_t>(sizeof(T) * data.size()));
+        buffer->Unmap();
+    }
+    return buffer;
+}
+
+PathTracer::PathTracer(VkExtent2D extent, VkPipelineShaderStageCreateInfo computeShaderStage)
+{
+    _extent = extent;
+    _regionOffset = { 0, 0 };
+    _regionExtent = extent;
+    _counterBuffer = nullptr;
+    _shaderStage = computeShaderStage;
+    _debugView = DebugView::None;
+    _debugScale = 1.0f;
+    frameData = {};
+    frameData.window.x = extent.width;
+    frameData.window.y = extent.height;
+
+    _layout = std::make_unique<DescriptorSetLayout>(std::vector<DescriptorSetLayout::DescriptorSetInfo>{
+        { 1, DescriptorType::UniformBuffer, ShaderStage::Compute },
+        { 1, DescriptorType::StorageBuffer, ShaderStage::Compute },
+        { 1, DescriptorType::StorageBuffer, ShaderStage::Compute },
+        { 1, DescriptorType::StorageBuffer, ShaderStage::Compute },
+        { 1, DescriptorType::StorageImage, ShaderStage::Compute },
+        { 1, DescriptorType::StorageImage, ShaderStage::Compute },
+        // Ray counters, only used by the instrumentation build
+        { 1, DescriptorType::StorageBuffer, ShaderStage::Compute },
+        // Environment distribution of EnvironmentMap
+        { 1, DescriptorType::StorageBuffer, ShaderStage::Compute },
+        // Light table
+        { 1, DescriptorType::StorageBuffer, ShaderStage::Compute },
+        // Sample statistics and pixel list of AdaptiveSampler
+        { 1, DescriptorType::StorageImage, ShaderStage::Compute },
+        { 1, DescriptorType::StorageBuffer, ShaderStage::Compute },
+        // First hit features and albedo for the Denoiser
+        { 1, DescriptorType::StorageImage, ShaderStage::Compute },
+        { 1, DescriptorType::StorageImage, ShaderStage::Compute },
+        // Accumulation and features of the previous camera for reprojection
+        { 1, DescriptorType::StorageImage, ShaderStage::Compute },
+        { 1, DescriptorType::StorageImage, ShaderStage::Compute },
+        });
+
+    _descriptor = Renderer::Get()->AllocateDescriptorSet(_layout->GetHandle());
+    _pipelines[0] = std::make_unique<ComputePipeline>(ComputePipeline::PipelineInfo{
+        computeShaderStage,
+        _layout->GetHandle(),
+        VK_NULL_HANDLE
+        });
+
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    _outputImage = std::make_unique<Image>(extent, Format::R8G8B8A8_UNORM, usage);
+    _accumulationImage = std::make_unique<Image>(extent, Format::R32G32B32A32_Sfloat, usage);
+
+    std::vector<uint8_t> zero(4 * 4 * extent.width * extent.height, 0);
+    _outputImage->SetData(zero.data(), 4 * extent.width * extent.height, ImageLayout::General);
+    _accumulationImage->SetData(zero.data(), 4 * 4 * extent.width * extent.height, ImageLayout::General);
+
+    VkImageUsageFlags featureUsage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    _featureImage = std::make_unique<Image>(extent, Format::R32G32B32A32_Sfloat, featureUsage);
+    _albedoImage = std::make_unique<Image>(extent, Format::R8G8B8A8_UNORM, featureUsage);
+    _historyImage = std::make_unique<Image>(extent, Format::R32G32B32A32_Sfloat, featureUsage);
+    _previousFeatureImage = std::make_unique<Image>(extent, Format::R32G32B32A32_Sfloat, featureUsage);
+    _featureImage->SetData(zero.data(), 4 * 4 * extent.width * extent.height, ImageLayout::General);
+    _albedoImage->SetData(zero.data(), 4 * extent.width * extent.height, ImageLayout::General);
+    _historyImage->SetData(zero.data(), 4 * 4 * extent.width * extent.height, ImageLayout::General);
+    _previousFeatureImage->SetData(zero.data(), 4 * 4 * extent.width * extent.height, ImageLayout::General);
+
+    _frameBuffer = std::make_unique<Buffer>(sizeof(FrameData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    _environment = std::make_unique<EnvironmentMap>();
+    _adaptive = std::make_unique<AdaptiveSampler>(_accumulationImage.get(), _outputImage.get());
+    _preview = std::make_unique<PreviewUpscaler>(_accumulationImage.get(), _outputImage.get());
+
+    SetScene({}, {}, {});
+}
+
+PathTracer::~PathTracer()
+{
+
+}
+
+void PathTracer::SetScene(const std::vector<Sphere>& spheres, const std::vector<Triangle>& triangles, const std::vector<Mesh>& meshes)
+{
+    frameData.sphereNumber = static_cast<uint32_t>(spheres.size());
+    frameData.meshNumber = static_cast<uint32_t>(meshes.size());
+
+    _sphereBuffer = CreateStorageBuffer(spheres);
+    _triangleBuffer = CreateStorageBuffer(triangles);
+    _meshBuffer = CreateStorageBuffer(meshes);
+
+    // Room for every sphere so UpdateSpheres can make any of them emissive
+    _triangleLights = CollectLights({}, triangles, meshes);
+    _lightBuffer = CreateStorageBuffer(std::vector<Light>(spheres.size() + _triangleLights.size()));
+    UpdateLights(spheres);
+
+    UpdateDescriptorSet();
+    UpdateFrameData();
+}
+
+void PathTracer::UpdateSpheres(const std::vector<Sphere>& spheres)
+{
+    if (spheres.size() != frameData.sphereNumber)
+    {
+        Logger::PrintError("UpdateSpheres can not change the sphere count!");
+        return;
+    }
+    if (spheres.empty())
+        return;
+
+    // The light count and power go out with the next UpdateFrameData
+    UpdateLights(spheres);
+    void* copyData = _sphereBuffer->Map();
+    memcpy(copyData, spheres.data(), static_cast<size_t>(sizeof(Sphere) * spheres.size()));
+    _sphereBuffer->Unmap();
+}
+
+void PathTracer::UpdateLights(const std::vector<Sphere>& spheres)
+{
+    std::vector<Light> lights = CollectLights(spheres, {}, {});
+    lights.insert(lights.end(), _triangleLights.begin(), _triangleLights.end());
+    frameData.lightPower = BuildAliasTable(lights);
+    frameData.lightNumber = static_cast<uint32_t>(lights.size());
+
+    if (!lights.empty())
+    {
+        void* copyData = _lightBuffer->Map();
+        memcpy(copyData, lights.data(), static_cast<size_t>(sizeof(Light) * lights.size()));
+        _lightBuffer->Unmap();
+    }
+}
+
+void PathTracer::UpdateFrameData()
+{
+    void* copyData = _frameBuffer->Map();
+    memcpy(copyData, &frameData, static_cast<size_t>(sizeof(FrameData)));
+    _frameBuffer->Unmap();
+}
+
+void PathTracer::UpdateDescriptorSet()
+{
+    if (_counterBuffer)
+    {
+        Renderer::Get()->UpdateDescriptorSet(_descriptor, {
+            { 6, DescriptorType::StorageBuffer, {_counterBuffer->GetHandle(), 0, VK_WHOLE_SIZE}, {}},
+            });
+    }
+
+    Renderer::Get()->UpdateDescriptorSet(_descriptor, {
+        { 0, DescriptorType::UniformBuffer, {_frameBuffer->GetHandle(), 0, sizeof(FrameData)}, {}},
+        { 1, DescriptorType::StorageBuffer, {_sphereBuffer->GetHandle(), 0, VK_WHOLE_SIZE}, {}},
+        { 2, DescriptorType::StorageBuffer, {_triangleBuffer->GetHandle(), 0, VK_WHOLE_SIZE}, {}},
+        { 3, DescriptorType::StorageBuffer, {_meshBuffer->GetHandle(), 0, VK_WHOLE_SIZE}, {}},
+        { 4, DescriptorType::StorageImage, {}, {VK_NULL_HANDLE, _outputImage->GetImageView(), VK_IMAGE_LAYOUT_GENERAL}},
+        { 5, DescriptorType::StorageImage, {}, {VK_NULL_HANDLE, _accumulationImage->GetImageView(), VK_IMAGE_LAYOUT_GENERAL}},
+        { 7, DescriptorType::StorageBuffer, {_environment->GetDistributionBuffer()->GetHandle(), 0, VK_WHOLE_SIZE}, {}},
+        { 8, DescriptorType::StorageBuffer, {_lightBuffer->GetHandle(), 0, VK_WHOLE_SIZE}, {}},
+        { 9, DescriptorType::StorageImage, {}, {VK_NULL_HANDLE, _adaptive->GetStatisticsImage()->GetImageView(), VK_IMAGE_LAYOUT_GENERAL}},
+        { 10, DescriptorType::StorageBuffer, {_adaptive->GetPixelBuffer()->GetHandle(), 0, VK_WHOLE_SIZE}, {}},
+        { 11, DescriptorType::StorageImage, {}, {VK_NULL_HANDLE, _featureImage->GetImageView(), VK_IMAGE_LAYOUT_GENERAL}},
+        { 12, DescriptorType::StorageImage, {}, {VK_NULL_HANDLE, _albedoImage->GetImageView(), VK_IMAGE_LAYOUT_GENERAL}},
+        { 13, DescriptorType::StorageImage, {}, {VK_NULL_HANDLE, _historyImage->GetImageView(), VK_IMAGE_LAYOUT_GENERAL}},
+        { 14, DescriptorType::StorageImage, {}, {VK_NULL_HANDLE, _previousFeatureImage->GetImageView(), VK_IMAGE_LAYOUT_GENERAL}},
+        });
+}
+
+void PathTracer::SetCounterBuffer(Buffer* counterBuffer)
+{
+    _counterBuffer = counterBuffer;
+    UpdateDescriptorSet();
+}
+
+bool PathTracer::SetDebugView(DebugView view, float scale)
+{
+    if (view == DebugView::Cycles && !Core::Get()->HasShaderClock())
+    {
+        Logger::PrintWarn("The device has no shader clock for the cycles view");
+        return false;
+    }
+
+    uint32_t index = static_cast<uint32_t>(view);
+    if (!_pipelines[index])
+    {
+        // constant_id 0 in Raytracing.comp
+        VkSpecializationMapEntry entry = { 0, 0, sizeof(uint32_t) };
+        VkSpecializationInfo specialization = {};
+        specialization.mapEntryCount = 1;
+        specialization.pMapEntries = &entry;
+        specialization.dataSize = sizeof(uint32_t);
+        specialization.pData = &index;
+
+        VkPipelineShaderStageCreateInfo stage = _shaderStage;
+        stage.pSpecializationInfo = &specialization;
+        _pipelines[index] = std::make_unique<ComputePipeline>(ComputePipeline::PipelineInfo{
+            stage,
+            _layout->GetHandle(),
+            VK_NULL_HANDLE
+            });
+    }
+
+    _debugView = view;
+    _debugScale = std::max(scale, 1e-6f);
+    return true;
+}
+
+std::vector<std::string> PathTracer::GetShaderDefines()
+{
+    if (Core::Get()->HasShaderClock())
+        return { "SHADER_CLOCK" };
+    return {};
+}
+
+void PathTracer::SetRegion(VkOffset2D offset, VkExtent2D extent)
+{
+    _regionOffset = offset;
+    _regionExtent = { std::min(extent.width, _extent.width), std::min(extent.height, _extent.height) };
+}
+
+void PathTracer::CmdCopyHistory(VkCommandBuffer cmd)
+{
+    // The previous frame wrote both images, the shader reads the copies
+    VkMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    VkImageCopy region = {};
+    region.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    region.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    region.extent = { _extent.width, _extent.height, 1 };
+    vkCmdCopyImage(cmd, _accumulationImage->GetHandle(), VK_IMAGE_LAYOUT_GENERAL, _historyImage->GetHandle(), VK_IMAGE_LAYOUT_GENERAL, 1, &region);
+    vkCmdCopyImage(cmd, _featureImage->GetHandle(), VK_IMAGE_LAYOUT_GENERAL, _previousFeatureImage->GetHandle(), VK_IMAGE_LAYOUT_GENERAL, 1, &region);
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void PathTracer::CmdDispatch(VkCommandBuffer cmd, uint32_t dispatchCount)
+{
+    _environment->CmdUpdate(cmd, frameData);
+    if (frameData.frameIndex == 1 && frameData.maxHistory > 0 && _debugView == DebugView::None)
+        CmdCopyHistory(cmd);
+
+    // Previews trace one pixel per block and interleave the rest, Raytracing.comp maps the pixels the same way
+    bool preview = frameData.previewScale > 1 && _debugView == DebugView::None;
+    uint32_t scale = preview ? frameData.previewScale : 1;
+    VkExtent2D traced = { (_regionExtent.width + scale - 1) / scale, (_regionExtent.height + scale - 1) / scale };
+
+    // Every pixel gets the minimum samples before its error estimate decides, debug views trace all of them
+    bool adaptive = frameData.adaptiveThreshold > 0.0f && _debugView == DebugView::None && !preview;
+    uint32_t uniformDispatches = (frameData.adaptiveMinSamples + frameData.raysPerPixel - 1) / std::max(frameData.raysPerPixel, 1u);
+
+    ComputePipeline* pipeline = _pipelines[static_cast<size_t>(_debugView)].get();
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->GetHandle());
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->GetLayout(), 0, 1, &_descriptor, 0, nullptr);
+    for (uint32_t i = 0; i < dispatchCount; i++)
+    {
+        uint32_t frameIndex = frameData.frameIndex + i;
+        bool compacted = adaptive && frameIndex > std::max(uniformDispatches, 1u);
+        if (compacted)
+        {
+            // The pass brings its own barriers and pipeline
+            _adaptive->CmdBuildPixelList(cmd, frameData, _regionExtent);
+            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->GetHandle());
+            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->GetLayout(), 0, 1, &_descriptor, 0, nullptr);
+        }
+        else if (i > 0)
+        {
+            VkMemoryBarrier accumulationBarrier = {};
+            accumulationBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            accumulationBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            accumulationBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+            vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &accumulationBarrier, 0, nullptr, 0, nullptr);
+        }
+        // Matches DispatchData in Raytracing.comp
+        uint32_t dispatchData[5] = { i, static_cast<uint32_t>(_regionOffset.x), static_cast<uint32_t>(_regionOffset.y), 0, compacted ? 1u : 0u };
+        memcpy(&dispatchData[3], &_debugScale, sizeof(float));
+        vkCmdPushConstants(cmd, pipeline->GetLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(dispatchData), dispatchData);
+        if (compacted)
+            vkCmdDispatchIndirect(cmd, _adaptive->GetPixelBuffer()->GetHandle(), 0);
+        else
+            vkCmdDispatch(cmd, (traced.width + 63) / 64, (traced.height + 15) / 16, 1);
+    }
+
+    if (preview)
+        _preview->CmdReconstruct(cmd, scale, _regionExtent);
+}
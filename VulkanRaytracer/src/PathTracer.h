@@ -0,0 +1,117 @@
+#pragma once
+#include "Vulkan/VKHeaders.h"
+#include "RayTracingStructs.h"
+#include "EnvironmentMap.h"
+#include "AdaptiveSampler.h"
+#include "PreviewUpscaler.h"
+
+/* Owns the Raytracing.comp pipeline, scene buffers and the	*/
+/* output and accumulation images, used by both the window	*/
+/* and the headless renderer									*/
+class PathTracer
+{
+public:
+	/* Heatmaps written to the output image instead of the	*/
+	/* light, matches DEBUG_VIEW_ in Raytracing.comp			*/
+	enum class DebugView
+	{
+		None,
+		/* Sphere, box and triangle tests per sample			*/
+		Traversal,
+		/* Traced rays per sample								*/
+		PathLength,
+		/* Shader clock cycles per pixel and dispatch			*/
+		Cycles,
+		Count
+	};
+
+	/* The shader module has to outlive the path tracer, debug	*/
+	/* view pipelines are created from it on first use			*/
+	PathTracer(VkExtent2D extent, VkPipelineShaderStageCreateInfo computeShaderStage);
+	~PathTracer();
+
+	/* Recreates the scene buffers, the GPU must be idle		*/
+	void SetScene(const std::vector<Sphere>& spheres, const std::vector<Triangle>& triangles, const std::vector<Mesh>& meshes);
+	/* Overwrites the spheres in place, the count must not change	*/
+	/* and no submitted frame may still read them				*/
+	void UpdateSpheres(const std::vector<Sphere>& spheres);
+	/* Copies frameData to the uniform buffer				*/
+	void UpdateFrameData();
+	/* Renders only extent pixels of the images, which are the	*/
+	/* frame's pixels starting at offset, used to render tiles	*/
+	void SetRegion(VkOffset2D offset, VkExtent2D extent);
+	/* Binds the RayCounters buffer, required when the shader	*/
+	/* is the INSTRUMENTATION build							*/
+	void SetCounterBuffer(Buffer* counterBuffer);
+	/* Switches the pipeline, no shader is recompiled. A view	*/
+	/* value of scale is drawn at the top of the heatmap		*/
+	/* Returns false if the device can not show the view		*/
+	bool SetDebugView(DebugView view, float scale);
+	DebugView GetDebugView() { return _debugView; }
+	float GetDebugScale() { return _debugScale; }
+	/* Records dispatchCount accumulation dispatches, the first	*/
+	/* one uses frameData.frameIndex. Rebuilds the environment	*/
+	/* distribution first when the sky of frameData changed.	*/
+	/* With an adaptive target, dispatches after the minimum		*/
+	/* samples only trace the pixels below their budget. With	*/
+	/* frameIndex 1 and frameData.maxHistory the accumulation	*/
+	/* starts from the reprojected one of the previous camera.	*/
+	/* With frameData.previewScale a dispatch traces one pixel	*/
+	/* per block and the untraced ones get upscaled output,		*/
+	/* the history reaches them when they are first traced		*/
+	void CmdDispatch(VkCommandBuffer cmd, uint32_t dispatchCount = 1);
+
+	Image* GetOutputImage() { return _outputImage.get(); }
+	Image* GetAccumulationImage() { return _accumulationImage.get(); }
+	/* Luminance count, mean and M2 per pixel, kept while		*/
+	/* adaptive sampling or frameData.denoise is on				*/
+	Image* GetStatisticsImage() { return _adaptive->GetStatisticsImage(); }
+	/* Normal and distance of the first hit, 0 for the sky		*/
+	Image* GetFeatureImage() { return _featureImage.get(); }
+	Image* GetAlbedoImage() { return _albedoImage.get(); }
+	VkExtent2D GetExtent() { return _extent; }
+
+	/* Defines for Raytracing.comp, the cycles view needs them	*/
+	static std::vector<std::string> GetShaderDefines();
+
+	FrameData frameData;
+
+private:
+
+	void UpdateDescriptorSet();
+	/* Copies the accumulation and features the next dispatch	*/
+	/* reprojects before it overwrites them						*/
+	void CmdCopyHistory(VkCommandBuffer cmd);
+	/* Rebuilds the light table from the spheres and the		*/
+	/* emissive triangles of the last SetScene					*/
+	void UpdateLights(const std::vector<Sphere>& spheres);
+
+	VkExtent2D _extent;
+	VkOffset2D _regionOffset;
+	VkExtent2D _regionExtent;
+
+	std::unique_ptr<DescriptorSetLayout> _layout;
+	VkPipelineShaderStageCreateInfo _shaderStage;
+	std::array<std::unique_ptr<ComputePipeline>, static_cast<size_t>(DebugView::Count)> _pipelines;
+	DebugView _debugView;
+	float _debugScale;
+	VkDescriptorSet _descriptor;
+
+	std::unique_ptr<Image> _outputImage;
+	std::unique_ptr<Image> _accumulationImage;
+	std::unique_ptr<Image> _featureImage;
+	std::unique_ptr<Image> _albedoImage;
+	std::unique_ptr<Image> _historyImage;
+	std::unique_ptr<Image> _previousFeatureImage;
+
+	std::unique_ptr<Buffer> _frameBuffer;
+	std::unique_ptr<Buffer> _sphereBuffer;
+	std::unique_ptr<Buffer> _triangleBuffer;
+	std::unique_ptr<Buffer> _meshBuffer;
+	std::unique_ptr<Buffer> _lightBuffer;
+	std::vector<Light> _triangleLights;
+	Buffer* _counterBuffer;
+	std::unique_ptr<EnvironmentMap> _environment;
+	std::unique_ptr<AdaptiveSampler> _adaptive;
+	std::unique_ptr<PreviewUpscaler> _preview;
+};
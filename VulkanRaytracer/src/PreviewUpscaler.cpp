@@ -0,0 +1,54 @@
+#include "PreviewUpscaler.h"
+
+// Matches UpscaleData in Upscale.comp
+struct UpscaleData
+{
+    uint32_t scale;
+    uint32_t width;
+    uint32_t height;
+};
+
+PreviewUpscaler::PreviewUpscaler(Image* accumulationImage, Image* outputImage)
+{
+    SpirvHelper::Init();
+    _shader = std::make_unique<Shader>("res/Shaders/Upscale.comp");
+    SpirvHelper::Finalize();
+
+    _layout = std::make_unique<DescriptorSetLayout>(std::vector<DescriptorSetLayout::DescriptorSetInfo>{
+        { 1, DescriptorType::StorageImage, ShaderStage::Compute },
+        { 1, DescriptorType::StorageImage, ShaderStage::Compute },
+        });
+
+    _descriptor = Renderer::Get()->AllocateDescriptorSet(_layout->GetHandle());
+    _pipeline = std::make_unique<ComputePipeline>(ComputePipeline::PipelineInfo{
+        _shader->GetShaderStage(),
+        _layout->GetHandle(),
+        VK_NULL_HANDLE
+        });
+
+    Renderer::Get()->UpdateDescriptorSet(_descriptor, {
+        { 0, DescriptorType::StorageImage, {}, {VK_NULL_HANDLE, accumulationImage->GetImageView(), VK_IMAGE_LAYOUT_GENERAL}},
+        { 1, DescriptorType::StorageImage, {}, {VK_NULL_HANDLE, outputImage->GetImageView(), VK_IMAGE_LAYOUT_GENERAL}},
+        });
+}
+
+PreviewUpscaler::~PreviewUpscaler()
+{
+
+}
+
+void PreviewUpscaler::CmdReconstruct(VkCommandBuffer cmd, uint32_t scale, VkExtent2D region)
+{
+    // The last dispatch wrote the accumulation and the output of the traced pixels
+    VkMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    UpscaleData data = { scale, region.width, region.height };
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline->GetHandle());
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline->GetLayout(), 0, 1, &_descriptor, 0, nullptr);
+    vkCmdPushConstants(cmd, _pipeline->GetLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(data), &data);
+    vkCmdDispatch(cmd, (region.width + 15) / 16, (region.height + 15) / 16, 1);
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include "Vulkan/VKHeaders.h"
+
+/* Fills the output of the pixels preview dispatches of a		*/
+/* PathTracer have not traced yet from the traced ones around	*/
+/* them. Untraced pixels have a dispatch count of 0 in the		*/
+/* accumulation alpha											*/
+class PreviewUpscaler
+{
+public:
+	/* Compiles Upscale.comp like EnvironmentMap does, the		*/
+	/* images are the ones of the owning PathTracer				*/
+	PreviewUpscaler(Image* accumulationImage, Image* outputImage);
+	~PreviewUpscaler();
+
+	/* Records the reconstruction after the preview dispatches	*/
+	/* of a frame, scale is frameData.previewScale				*/
+	void CmdReconstruct(VkCommandBuffer cmd, uint32_t scale, VkExtent2D region);
+
+private:
+
+	std::unique_ptr<Shader> _shader;
+	std::unique_ptr<DescriptorSetLayout> _layout;
+	std::unique_ptr<ComputePipeline> _pipeline;
+	VkDescriptorSet _descriptor;
+};
@@ -0,0 +1,129 @@
+#include "RayCounters.h"
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+
+// Matches the COUNTER_ defines in Raytracing.comp, every counter is a low and a high word
+static const uint32_t CounterCount = 9 + RayStatistics::PathLengthBins;
+static const uint32_t CounterBufferSize = CounterCount * 2 * sizeof(uint32_t);
+
+RayCounters::RayCounters(uint32_t frameCount)
+{
+    _counterBuffer = std::make_unique<Buffer>(CounterBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    for (uint32_t i = 0; i < frameCount; i++)
+        _snapshots.push_back(std::make_unique<Buffer>(CounterBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+    _written.resize(frameCount, false);
+
+    VkCommandBuffer cmd = Core::Get()->BeginSingleTimeCommands();
+    CmdReset(cmd);
+    Core::Get()->EndSingleTimeCommands(cmd);
+}
+
+RayCounters::~RayCounters()
+{
+
+}
+
+void RayCounters::CmdReset(VkCommandBuffer cmd)
+{
+    VkMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    vkCmdFillBuffer(cmd, _counterBuffer->GetHandle(), 0, CounterBufferSize, 0);
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void RayCounters::CmdSnapshot(VkCommandBuffer cmd, uint32_t frameIndex)
+{
+    VkMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    VkBufferCopy region = {};
+    region.size = CounterBufferSize;
+    vkCmdCopyBuffer(cmd, _counterBuffer->GetHandle(), _snapshots[frameIndex]->GetHandle(), 1, &region);
+
+    // Later dispatches keep counting and must wait for the copy to read
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 1, &barrier, 0, nullptr, 0, nullptr);
+    _written[frameIndex] = true;
+}
+
+bool RayCounters::GetSnapshot(uint32_t frameIndex, RayStatistics& statistics)
+{
+    if (!_written[frameIndex])
+        return false;
+
+    uint32_t words[CounterCount * 2];
+    memcpy(words, _snapshots[frameIndex]->Map(), CounterBufferSize);
+    _snapshots[frameIndex]->Unmap();
+
+    uint64_t counters[CounterCount];
+    for (uint32_t i = 0; i < CounterCount; i++)
+        counters[i] = static_cast<uint64_t>(words[2 * i + 1]) << 32 | words[2 * i];
+
+    statistics.primaryRays = counters[0];
+    statistics.secondaryRays = counters[1];
+    statistics.triangleTests = counters[2];
+    statistics.boxTests = counters[3];
+    statistics.sphereTests = counters[4];
+    statistics.escapedPaths = counters[5];
+    statistics.roulettePaths = counters[6];
+    statistics.rouletteSkippedBounces = counters[7];
+    statistics.shadowRays = counters[8];
+    for (uint32_t i = 0; i < RayStatistics::PathLengthBins; i++)
+        statistics.pathLengths[i] = counters[9 + i];
+
+    _written[frameIndex] = false;
+    return true;
+}
+
+std::vector<std::string> RayCounters::GetShaderDefines()
+{
+    std::vector<std::string> defines = { "INSTRUMENTATION" };
+    const VkPhysicalDeviceSubgroupProperties& subgroup = Core::Get()->GetSubgroupProperties();
+    if ((subgroup.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT) && (subgroup.supportedOperations & VK_SUBGROUP_FEATURE_ARITHMETIC_BIT))
+        defines.push_back("SUBGROUP_ARITHMETIC");
+    return defines;
+}
+
+bool WriteRayStatistics(const std::string& path, const RayStatistics& statistics, double seconds)
+{
+    std::ofstream file(path);
+    if (!file.is_open())
+        return false;
+
+    seconds = std::max(seconds, 1e-9);
+    file << "counter,value\n"
+        << "seconds," << seconds << "\n"
+        << "primary_rays," << statistics.primaryRays << "\n"
+        << "secondary_rays," << statistics.secondaryRays << "\n"
+        << "rays_per_second," << statistics.GetRays() / seconds << "\n"
+        << "triangle_tests," << statistics.triangleTests << "\n"
+        << "box_tests," << statistics.boxTests << "\n"
+        << "sphere_tests," << statistics.sphereTests << "\n"
+        << "escaped_paths," << statistics.escapedPaths << "\n"
+        << "roulette_paths," << statistics.roulettePaths << "\n"
+        << "roulette_skipped_bounces," << statistics.rouletteSkippedBounces << "\n"
+        << "shadow_rays," << statistics.shadowRays << "\n";
+    for (uint32_t i = 0; i < RayStatistics::PathLengthBins; i++)
+    {
+        file << "paths_length_" << i + 1 << (i + 1 == RayStatistics::PathLengthBins ? "_or_more," : ",")
+            << statistics.pathLengths[i] << "\n";
+    }
+    return static_cast<bool>(file);
+}
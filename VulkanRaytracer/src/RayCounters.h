@@ -0,0 +1,60 @@
+#pragma once
+#include "Vulkan/VKHeaders.h"
+
+/* Totals of the INSTRUMENTATION build of Raytracing.comp	*/
+struct RayStatistics
+{
+	static constexpr uint32_t PathLengthBins = 16;
+
+	uint64_t primaryRays;
+	uint64_t secondaryRays;
+	uint64_t triangleTests;
+	uint64_t boxTests;
+	uint64_t sphereTests;
+	/* Paths that ended in the environment, the others hit	*/
+	/* the bounce limit										*/
+	uint64_t escapedPaths;
+	/* Paths ended by Russian roulette and the bounces they	*/
+	/* had left, an upper bound of the rays it saved			*/
+	uint64_t roulettePaths;
+	uint64_t rouletteSkippedBounces;
+	/* Light sampling's rays, not part of GetRays				*/
+	uint64_t shadowRays;
+	/* Paths by number of traced rays, index 0 is one ray,	*/
+	/* the last bin also holds the longer ones				*/
+	std::array<uint64_t, PathLengthBins> pathLengths;
+
+	uint64_t GetRays() const { return primaryRays + secondaryRays; }
+};
+
+/* Counter buffer bound to the instrumented shader with	*/
+/* one host snapshot per frame in flight					*/
+class RayCounters
+{
+public:
+	RayCounters(uint32_t frameCount);
+	~RayCounters();
+
+	/* Zeroes the counters before the following dispatches	*/
+	void CmdReset(VkCommandBuffer cmd);
+	/* Copies the totals after the frame's dispatches			*/
+	void CmdSnapshot(VkCommandBuffer cmd, uint32_t frameIndex);
+	/* Does not wait for the GPU							*/
+	/* Returns false if the frame took no snapshot			*/
+	bool GetSnapshot(uint32_t frameIndex, RayStatistics& statistics);
+
+	Buffer* GetBuffer() { return _counterBuffer.get(); }
+
+	/* Shader defines of the instrumentation build, subgroup	*/
+	/* reductions are used when the device supports them		*/
+	static std::vector<std::string> GetShaderDefines();
+
+private:
+
+	std::unique_ptr<Buffer> _counterBuffer;
+	std::vector<std::unique_ptr<Buffer>> _snapshots;
+	std::vector<bool> _written;
+};
+
+/* Counters and the rates over seconds as counter,value csv	*/
+bool WriteRayStatistics(const std::string& path, const RayStatistics& statistics, double seconds);
@@ -1,6 +1,16 @@
 #pragma once
 #include <glm/glm.hpp>
 
+/* Where the random numbers of a sample come from, matches	*/
+/* SAMPLER_ in Raytracing.comp								*/
+enum class SamplerType : unsigned int
+{
+    /* A PCG stream per pixel and dispatch					*/
+    Pcg,
+    /* Owen scrambled Sobol points, one sequence per pixel	*/
+    Sobol
+};
+
 struct FrameData
 {
     glm::mat4 cameraInverseProjection;
@@ -19,6 +29,71 @@ struct FrameData
     unsigned int frameIndex;
     unsigned int sphereNumber;
     unsigned int meshNumber;
+    unsigned int seedOffset;
+    unsigned int rouletteDepth;
+    unsigned int lightSampling;
+    /* Entries of the light table and the sum of their power	*/
+    unsigned int lightNumber;
+    float lightPower;
+    /* A SamplerType										*/
+    unsigned int samplerType;
+    /* Luminance RMSE adaptive sampling budgets the pixel	*/
+    /* samples for, 0 traces every pixel every dispatch		*/
+    float adaptiveThreshold;
+    /* Samples every pixel gets before its deviation is trusted	*/
+    unsigned int adaptiveMinSamples;
+    /* Keeps the sample statistics for the Denoiser even		*/
+    /* without adaptive sampling, reset the accumulation when	*/
+    /* it changes												*/
+    unsigned int denoise;
+    /* Dispatches the reprojected history of a pixel counts		*/
+    /* for at most when the pixel is first traced after a		*/
+    /* reset, 0 starts from scratch								*/
+    unsigned int maxHistory;
+    /* Side of the pixel blocks a dispatch traces one pixel of,	*/
+    /* 0 and 1 trace them all. Also keeps the matrices below on	*/
+    /* 16 bytes like in std140									*/
+    unsigned int previewScale;
+    /* Camera before the last reset, the history was traced		*/
+    /* with it. The inverses of its inverse matrices and its	*/
+    /* position													*/
+    glm::mat4 previousView;
+    glm::mat4 previousProjection;
+    glm::vec4 previousCameraPos;
+};
+
+/* Resolution of the lat-long environment the light sampling	*/
+/* distribution is built from, matches Raytracing.comp		*/
+static const unsigned int EnvironmentWidth = 512;
+static const unsigned int EnvironmentHeight = 256;
+/* Floats of the distribution: the integral, the marginal CDF	*/
+/* over the rows and the conditional CDF of every row			*/
+static const unsigned int EnvironmentDistributionSize = 1 + (EnvironmentHeight + 1) + EnvironmentHeight * (EnvironmentWidth + 1);
+
+/* The FrameData fields the environment depends on, the push	*/
+/* constants of Environment.comp								*/
+struct EnvironmentParameters
+{
+    glm::vec4 skyColorHorizon;
+    glm::vec4 skyColorZenith;
+    glm::vec4 groundColor;
+    glm::vec4 sunLightDirection;
+    float sunFocus;
+    float sunIntensity;
+    unsigned int pass;
+
+    static EnvironmentParameters FromFrameData(const FrameData& frameData)
+    {
+        return { frameData.skyColorHorizon, frameData.skyColorZenith, frameData.groundColor, frameData.sunLightDirection,
+            frameData.sunFocus, frameData.sunIntensity, 0 };
+    }
+    /* Ignores pass											*/
+    bool operator==(const EnvironmentParameters& other) const
+    {
+        return skyColorHorizon == other.skyColorHorizon && skyColorZenith == other.skyColorZenith && groundColor == other.groundColor
+            && sunLightDirection == other.sunLightDirection && sunFocus == other.sunFocus && sunIntensity == other.sunIntensity;
+    }
+    bool operator!=(const EnvironmentParameters& other) const { return !(*this == other); }
 };
 
 struct Material
@@ -57,4 +132,21 @@ struct Triangle
     glm::vec4 n1;
     glm::vec4 n2;
     glm::vec4 n3;
+};
+
+/* An emissive sphere or triangle and its slot of the alias	*/
+/* table light sampling picks from, see LightTable.h			*/
+struct Light
+{
+    /* The slot keeps its light with this probability and		*/
+    /* picks the light of slot alias otherwise					*/
+    float probability;
+    int alias;
+    /* One of them is -1										*/
+    int sphereIndex;
+    int triangleIndex;
+    /* Emitted radiance times area, the weight of the light	*/
+    float power;
+    /* Emitted radiance of the material						*/
+    float light;
 };
\ No newline at end of file
@@ -0,0 +1,313 @@
+#include "Regression.h"
+#include "PathTracer.h"
+#include "Cpu/CpuPathTracer.h"
+#include "Scene.h"
+#include "Helper.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <functional>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+    struct RegressionCase
+    {
+        std::string scenePath;
+        VkExtent2D extent;
+        uint32_t samplesPerPixel;
+        /* 0 skips the convergence measurement				*/
+        float targetRmse;
+        /* Compares against a uniform image of referenceRadiance	*/
+        /* instead of a rendered reference, for furnace tests		*/
+        bool constantReference;
+        float referenceRadiance;
+    };
+
+    // Renders count dispatches continuing the accumulation, readSums returns the accumulated sums
+    struct Backend
+    {
+        std::function<void(uint32_t start, uint32_t count)> render;
+        std::function<void(std::vector<float>& sums)> readSums;
+        uint32_t dispatchesPerBatch;
+    };
+}
+
+// An unchanged shader at other seeds differs from the reference by noise
+// alone, its expected RMSE is sqrt(2) times the noise of one render. The
+// noise estimate is itself noisy with fireflies, 1.5 failed about one run in ten
+static const double RmseTolerance = 2.0;
+// Standard errors the mean brightness may move before it counts as bias
+static const double BiasTolerance = 5.0;
+
+static bool LoadManifest(const std::string& path, std::vector<RegressionCase>& cases)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        std::cout << "Failed to open " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    uint32_t lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+
+        std::istringstream stream(line);
+        RegressionCase regressionCase;
+        if (!(stream >> regressionCase.scenePath))
+            continue;
+        if (!(stream >> regressionCase.extent.width >> regressionCase.extent.height >> regressionCase.samplesPerPixel)
+            || regressionCase.extent.width == 0 || regressionCase.extent.height == 0 || regressionCase.samplesPerPixel == 0)
+        {
+            std::cout << path << ":" << lineNumber << ": expected <scene> <width> <height> <spp> [target rmse] [reference radiance]" << std::endl;
+            return false;
+        }
+        if (!(stream >> regressionCase.targetRmse))
+            regressionCase.targetRmse = 0.0f;
+        regressionCase.constantReference = static_cast<bool>(stream >> regressionCase.referenceRadiance);
+        cases.push_back(regressionCase);
+    }
+    return true;
+}
+
+static double ComputeRmse(const std::vector<float>& sums, float scale, const std::vector<float>& reference)
+{
+    double squaredError = 0.0;
+    for (size_t i = 0; i < sums.size(); i += 4)
+    {
+        for (size_t c = 0; c < 3; c++)
+        {
+            double difference = sums[i + c] * scale - reference[i + c];
+            squaredError += difference * difference;
+        }
+    }
+    return std::sqrt(squaredError / (sums.size() / 4 * 3));
+}
+
+static bool RunCase(const RegressionSettings& settings, const RegressionCase& regressionCase, const Scene& scene,
+    Backend& backend, std::ofstream& results)
+{
+    std::string name = std::filesystem::path(regressionCase.scenePath).stem().string();
+    std::string referencePath = (std::filesystem::path(settings.directory) / (name + ".ref.pfm")).string();
+    VkExtent2D extent = regressionCase.extent;
+
+    std::vector<float> reference;
+    if (regressionCase.constantReference)
+    {
+        // The expected image is known, there is nothing to update
+        if (settings.updateReferences)
+        {
+            std::cout << "KEEP " << name << ": constant reference " << regressionCase.referenceRadiance << std::endl;
+            return true;
+        }
+        reference.assign(static_cast<size_t>(extent.width) * extent.height * 4, regressionCase.referenceRadiance);
+    }
+    else if (!settings.updateReferences)
+    {
+        uint32_t width, height;
+        if (!ReadImagePFM(referencePath, width, height, reference))
+        {
+            std::cout << "FAIL " << name << ": no reference " << referencePath << ", run with --update-references" << std::endl;
+            return false;
+        }
+        if (width != extent.width || height != extent.height)
+        {
+            std::cout << "FAIL " << name << ": reference is " << width << "x" << height << std::endl;
+            return false;
+        }
+    }
+
+    // Two halves of the dispatches give two independent estimates, their difference measures the noise
+    uint32_t raysPerPixel = std::max(scene.raysPerPixel, 1u);
+    uint32_t totalDispatches = std::max((regressionCase.samplesPerPixel + raysPerPixel - 1) / raysPerPixel, 2u);
+    uint32_t halfDispatches = totalDispatches / 2;
+
+    std::vector<float> firstHalf, sums;
+    double renderSeconds = 0.0;
+    double timeToTarget = -1.0;
+    int64_t samplesToTarget = -1;
+    for (uint32_t rendered = 0; rendered < totalDispatches;)
+    {
+        uint32_t end = rendered < halfDispatches ? halfDispatches : totalDispatches;
+        uint32_t count = std::min(backend.dispatchesPerBatch, end - rendered);
+        auto startTime = std::chrono::high_resolution_clock::now();
+        backend.render(rendered, count);
+        renderSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+        rendered += count;
+
+        if (rendered == halfDispatches)
+        {
+            backend.readSums(firstHalf);
+            sums = firstHalf;
+        }
+        else if (rendered == totalDispatches || (timeToTarget < 0.0 && regressionCase.targetRmse > 0.0f && !reference.empty()))
+            backend.readSums(sums);
+
+        // Readbacks do not count towards the render time
+        if (timeToTarget < 0.0 && regressionCase.targetRmse > 0.0f && !reference.empty()
+            && ComputeRmse(sums, 1.0f / rendered, reference) <= regressionCase.targetRmse)
+        {
+            timeToTarget = renderSeconds;
+            samplesToTarget = static_cast<int64_t>(rendered) * raysPerPixel;
+        }
+    }
+
+    std::vector<float> image(sums.size());
+    double varianceSum = 0.0;
+    double meanDifference = 0.0;
+    float fullScale = 1.0f / totalDispatches;
+    float firstScale = 1.0f / halfDispatches;
+    float secondScale = 1.0f / (totalDispatches - halfDispatches);
+    double halfFactor = static_cast<double>(halfDispatches) * (totalDispatches - halfDispatches) / (static_cast<double>(totalDispatches) * totalDispatches);
+    for (size_t i = 0; i < sums.size(); i += 4)
+    {
+        for (size_t c = 0; c < 3; c++)
+        {
+            image[i + c] = sums[i + c] * fullScale;
+            // E[(A - B)^2] = sigma^2 * K / (h * (K - h)) and the variance of the full mean is sigma^2 / K
+            double difference = firstHalf[i + c] * firstScale - (sums[i + c] - firstHalf[i + c]) * secondScale;
+            varianceSum += difference * difference * halfFactor;
+            if (!reference.empty())
+                meanDifference += image[i + c] - reference[i + c];
+        }
+        image[i + 3] = 1.0f;
+    }
+    size_t valueCount = sums.size() / 4 * 3;
+    double variance = varianceSum / valueCount;
+    double samplesPerSecond = static_cast<double>(totalDispatches) * raysPerPixel * extent.width * extent.height / std::max(renderSeconds, 1e-9);
+
+    if (settings.updateReferences)
+    {
+        bool written = WriteImagePFM(referencePath, extent.width, extent.height, image.data());
+        std::cout << (written ? "WROTE " : "FAIL ") << referencePath << std::endl;
+        results << name << "," << totalDispatches * raysPerPixel << ",,," << std::sqrt(variance) << ",," << renderSeconds << ",,," << (written ? "updated" : "failed") << "\n";
+        return written;
+    }
+
+    double rmse = ComputeRmse(image, 1.0f, reference);
+    double rmseLimit = RmseTolerance * std::sqrt(2.0 * variance) + 1e-4;
+    double bias = meanDifference / valueCount;
+    // The noise of pixels adaptive sampling stopped is not in the difference of the halves, so
+    // the rmse is only measured. Their error is budgeted to about the target, which bounds the
+    // noise of the mean and keeps the bias check
+    bool adaptive = scene.adaptiveThreshold > 0.0f;
+    double adaptiveVariance = adaptive ? static_cast<double>(scene.adaptiveThreshold) * scene.adaptiveThreshold : 0.0;
+    double biasLimit = BiasTolerance * std::sqrt((2.0 * variance + adaptiveVariance) / valueCount) + 1e-4;
+    bool passed = (adaptive || rmse <= rmseLimit) && std::abs(bias) <= biasLimit;
+    const char* result = passed ? "pass" : "fail";
+
+    std::cout << std::setprecision(5) << (passed ? "PASS " : "FAIL ") << name << ": rmse " << rmse;
+    if (adaptive)
+        std::cout << " (measured)";
+    else
+        std::cout << " (limit " << rmseLimit << ")";
+    std::cout << ", bias " << bias << " (limit " << biasLimit << "), "
+        << std::setprecision(2) << renderSeconds << " s, " << samplesPerSecond / 1e6 << " M samples/s";
+    if (regressionCase.targetRmse > 0.0f)
+    {
+        if (timeToTarget >= 0.0)
+            std::cout << ", rmse " << regressionCase.targetRmse << " after " << timeToTarget << " s and " << samplesToTarget << " spp";
+        else
+            std::cout << ", never reached rmse " << regressionCase.targetRmse;
+    }
+    std::cout << std::endl;
+
+    results << name << "," << totalDispatches * raysPerPixel << "," << rmse << "," << rmseLimit << "," << std::sqrt(variance) << ","
+        << bias << "," << renderSeconds << "," << timeToTarget << "," << samplesToTarget << "," << result << "\n";
+    return passed;
+}
+
+int RunRegression(const RegressionSettings& settings)
+{
+    std::vector<RegressionCase> cases;
+    if (!LoadManifest((std::filesystem::path(settings.directory) / "regression.txt").string(), cases))
+        return 1;
+
+    std::string resultsPath = (std::filesystem::path(settings.directory) / "results.csv").string();
+    std::ofstream results(resultsPath);
+    results << "scene,spp,rmse,rmse_limit,noise,bias,seconds,seconds_to_target,samples_to_target,result\n";
+
+    // Lavapipe is enough for the GPU path, CI machines need no GPU
+    std::unique_ptr<Renderer> renderer;
+    std::unique_ptr<Shader> computeShader;
+    if (!settings.cpu)
+    {
+        renderer = std::make_unique<Renderer>(nullptr, 2, VK_PRESENT_MODE_FIFO_KHR);
+        SpirvHelper::Init();
+        computeShader = std::make_unique<Shader>("res/Shaders/Raytracing.comp");
+        SpirvHelper::Finalize();
+    }
+
+    uint32_t failed = 0;
+    for (const RegressionCase& regressionCase : cases)
+    {
+        Scene scene;
+        if (!LoadScene(regressionCase.scenePath, scene))
+        {
+            std::cout << "FAIL " << regressionCase.scenePath << ": invalid scene" << std::endl;
+            failed++;
+            continue;
+        }
+        scene.lightSampling &= settings.lightSampling;
+        if (settings.overrideSampler)
+            scene.sampler = settings.sampler;
+        if (settings.overrideAdaptive)
+            scene.adaptiveThreshold = settings.adaptiveThreshold;
+
+        VkExtent2D extent = regressionCase.extent;
+        size_t sumCount = static_cast<size_t>(extent.width) * extent.height * 4;
+        Backend backend;
+        bool passed;
+        if (settings.cpu)
+        {
+            CpuPathTracer pathTracer(extent.width, extent.height, settings.threadCount);
+            SetSceneFrameData(scene, extent, pathTracer.frameData);
+            pathTracer.SetScene(scene.spheres, scene.triangles, scene.meshes);
+            backend.dispatchesPerBatch = 1;
+            backend.render = [&](uint32_t start, uint32_t count) {
+                pathTracer.frameData.frameIndex = start + 1;
+                pathTracer.Dispatch(count);
+            };
+            backend.readSums = [&](std::vector<float>& sums) {
+                sums.assign(&pathTracer.GetAccumulation()[0].x, &pathTracer.GetAccumulation()[0].x + sumCount);
+            };
+            passed = RunCase(settings, regressionCase, scene, backend, results);
+        }
+        else
+        {
+            PathTracer pathTracer(extent, computeShader->GetShaderStage());
+            SetSceneFrameData(scene, extent, pathTracer.frameData);
+            pathTracer.SetScene(scene.spheres, scene.triangles, scene.meshes);
+            backend.dispatchesPerBatch = 16;
+            backend.render = [&](uint32_t start, uint32_t count) {
+                VkCommandBuffer cmd = renderer->BeginFrame();
+                pathTracer.frameData.frameIndex = start + 1;
+                pathTracer.UpdateFrameData();
+                pathTracer.CmdDispatch(cmd, count);
+                renderer->EndFrame();
+                Core::Get()->WaitIdle();
+            };
+            backend.readSums = [&](std::vector<float>& sums) {
+                sums.resize(sumCount);
+                pathTracer.GetAccumulationImage()->GetData(sums.data(), static_cast<uint32_t>(sumCount * sizeof(float)));
+            };
+            passed = RunCase(settings, regressionCase, scene, backend, results);
+            Core::Get()->WaitIdle();
+        }
+        failed += passed ? 0 : 1;
+    }
+
+    computeShader.reset();
+    renderer.reset();
+
+    std::cout << cases.size() - failed << " of " << cases.size() << " scenes passed, results in " << resultsPath << std::endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include "RayTracingStructs.h"
+
+/* Renders the scenes listed in <directory>/regression.txt with	*/
+/* fixed seeds and compares them against <scene>.ref.pfm in the	*/
+/* same directory. A line of regression.txt is					*/
+/*   <scene file> <width> <height> <spp> [target rmse]			*/
+/*   [reference radiance]										*/
+/* where a reference radiance replaces the .ref.pfm by a		*/
+/* uniform image, as the white furnace test expects				*/
+struct RegressionSettings
+{
+	std::string directory;
+	/* Stores the renders as new references instead of comparing	*/
+	bool updateReferences = false;
+	/* Renders with CpuPathTracer against the same references	*/
+	bool cpu = false;
+	uint32_t threadCount = 0;
+	/* False turns off light sampling in every scene, comparing	*/
+	/* seconds_to_target of both runs gives its speedup			*/
+	bool lightSampling = true;
+	/* Replaces the sampler of every scene, comparing		*/
+	/* samples_to_target of pcg and sobol runs gives its gain	*/
+	bool overrideSampler = false;
+	SamplerType sampler = SamplerType::Sobol;
+	/* Replaces the adaptive target RMSE of every scene, against	*/
+	/* a uniform run seconds_to_target gives its speedup. The	*/
+	/* pixels it skips repeat their mean, the halves are no		*/
+	/* longer independent and only the bias is checked			*/
+	bool overrideAdaptive = false;
+	float adaptiveThreshold = 0.0f;
+};
+
+/* 0 when every scene passed, results go to results.csv		*/
+int RunRegression(const RegressionSettings& settings);
@@ -0,0 +1,367 @@
+#include "RenderFarm.h"
+#include "Network/Socket.h"
+#include "PathTracer.h"
+#include "Scene.h"
+#include "Helper.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+
+// Every message starts with a header, workers and coordinator must share the byte order
+enum class MessageType : uint32_t
+{
+    Setup,
+    Job,
+    Result,
+    Shutdown
+};
+
+struct MessageHeader
+{
+    MessageType type;
+    uint32_t size;
+};
+
+// Followed by the scene path and the scene text, an empty text is the default scene
+struct SetupMessage
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t tileSize;
+    uint32_t pathSize;
+    uint32_t textSize;
+};
+
+// A result repeats the job followed by width * height float rgba sums
+struct JobMessage
+{
+    uint32_t id;
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+    uint32_t dispatchStart;
+    uint32_t dispatchCount;
+};
+
+static bool SendFarmMessage(Socket& socket, MessageType type, const void* data, size_t size, const void* payload = nullptr, size_t payloadSize = 0)
+{
+    MessageHeader header = { type, static_cast<uint32_t>(size + payloadSize) };
+    return socket.Send(&header, sizeof(header)) && socket.Send(data, size) && (payloadSize == 0 || socket.Send(payload, payloadSize));
+}
+
+namespace
+{
+    struct FarmState
+    {
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::deque<JobMessage> pendingJobs;
+        size_t completedJobs = 0;
+        size_t totalJobs = 0;
+        uint32_t activeWorkers = 0;
+        std::vector<float> sums;
+    };
+}
+
+static void ServeWorker(std::unique_ptr<Socket> socket, uint32_t workerIndex, const FarmSettings& settings,
+    const std::string& sceneText, FarmState& state)
+{
+    SetupMessage setup = { settings.extent.width, settings.extent.height, settings.tileSize,
+        static_cast<uint32_t>(settings.scenePath.size()), static_cast<uint32_t>(sceneText.size()) };
+    std::string setupPayload = settings.scenePath + sceneText;
+    bool connected = SendFarmMessage(*socket, MessageType::Setup, &setup, sizeof(setup), setupPayload.data(), setupPayload.size());
+
+    std::vector<float> tile;
+    uint32_t renderedJobs = 0;
+    while (connected)
+    {
+        JobMessage job;
+        {
+            std::unique_lock<std::mutex> lock(state.mutex);
+            state.condition.wait(lock, [&]() { return !state.pendingJobs.empty() || state.completedJobs == state.totalJobs; });
+            if (state.pendingJobs.empty())
+                break;
+            job = state.pendingJobs.front();
+            state.pendingJobs.pop_front();
+        }
+
+        MessageHeader header;
+        JobMessage result;
+        tile.resize(static_cast<size_t>(job.width) * job.height * 4);
+        size_t tileSize = tile.size() * sizeof(float);
+        connected = SendFarmMessage(*socket, MessageType::Job, &job, sizeof(job))
+            && socket->Receive(&header, sizeof(header))
+            && header.type == MessageType::Result && header.size == sizeof(result) + tileSize
+            && socket->Receive(&result, sizeof(result)) && result.id == job.id
+            && socket->Receive(tile.data(), tileSize);
+
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (!connected)
+        {
+            // Another worker picks the job up again
+            state.pendingJobs.push_front(job);
+            state.condition.notify_all();
+            break;
+        }
+
+        for (uint32_t y = 0; y < job.height; y++)
+        {
+            float* dst = state.sums.data() + ((static_cast<size_t>(job.y) + y) * settings.extent.width + job.x) * 4;
+            const float* src = tile.data() + static_cast<size_t>(y) * job.width * 4;
+            for (uint32_t i = 0; i < job.width * 4; i++)
+                dst[i] += src[i];
+        }
+        renderedJobs++;
+        state.completedJobs++;
+        if (state.completedJobs == state.totalJobs)
+            state.condition.notify_all();
+    }
+
+    if (connected)
+        SendFarmMessage(*socket, MessageType::Shutdown, nullptr, 0);
+    else
+        std::cout << "Lost worker " << workerIndex << std::endl;
+
+    std::lock_guard<std::mutex> lock(state.mutex);
+    std::cout << "  worker " << workerIndex << ": " << renderedJobs << " jobs" << std::endl;
+    state.activeWorkers--;
+    state.condition.notify_all();
+}
+
+int RunCoordinator(const FarmSettings& settings, const std::string& executablePath)
+{
+    Scene scene;
+    std::string sceneText;
+    if (settings.scenePath.empty())
+        scene = CreateDefaultScene();
+    else
+    {
+        std::ifstream file(settings.scenePath);
+        if (!file.is_open())
+        {
+            std::cout << "Failed to open scene " << settings.scenePath << std::endl;
+            return 1;
+        }
+        std::stringstream text;
+        text << file.rdbuf();
+        sceneText = text.str();
+        if (!LoadSceneFromText(sceneText, settings.scenePath, scene))
+            return 1;
+    }
+
+    Socket listener;
+    if (!listener.Listen(settings.port))
+    {
+        std::cout << "Failed to listen on port " << settings.port << std::endl;
+        return 1;
+    }
+
+    // Every dispatch adds raysPerPixel samples, a job renders whole dispatches of one tile
+    uint32_t raysPerPixel = std::max(scene.raysPerPixel, 1u);
+    uint32_t totalDispatches = (settings.samplesPerPixel + raysPerPixel - 1) / raysPerPixel;
+    uint32_t jobDispatches = settings.jobSamples == 0 ? totalDispatches : std::max((settings.jobSamples + raysPerPixel - 1) / raysPerPixel, 1u);
+
+    FarmState state;
+    state.sums.resize(static_cast<size_t>(settings.extent.width) * settings.extent.height * 4, 0.0f);
+    for (uint32_t dispatchStart = 0; dispatchStart < totalDispatches; dispatchStart += jobDispatches)
+    {
+        for (uint32_t y = 0; y < settings.extent.height; y += settings.tileSize)
+        {
+            for (uint32_t x = 0; x < settings.extent.width; x += settings.tileSize)
+            {
+                JobMessage job;
+                job.id = static_cast<uint32_t>(state.pendingJobs.size());
+                job.x = x;
+                job.y = y;
+                job.width = std::min(settings.tileSize, settings.extent.width - x);
+                job.height = std::min(settings.tileSize, settings.extent.height - y);
+                job.dispatchStart = dispatchStart;
+                job.dispatchCount = std::min(jobDispatches, totalDispatches - dispatchStart);
+                state.pendingJobs.push_back(job);
+            }
+        }
+    }
+    state.totalJobs = state.pendingJobs.size();
+
+    std::cout << "Coordinator on port " << settings.port << ": " << state.totalJobs << " jobs of "
+        << settings.tileSize << "x" << settings.tileSize << " pixels and up to " << jobDispatches * raysPerPixel << " spp" << std::endl;
+
+    // Local workers are ordinary processes that connect back over loopback
+    std::atomic<uint32_t> runningProcesses = settings.localWorkers;
+    std::vector<std::thread> processes;
+    for (uint32_t i = 0; i < settings.localWorkers; i++)
+    {
+        std::string command = "\"" + executablePath + "\" --worker 127.0.0.1:" + std::to_string(settings.port);
+#ifdef _WIN32
+        // cmd.exe strips the outer quotes of the whole command line
+        command = "\"" + command + "\"";
+#endif
+        processes.emplace_back([command, &runningProcesses]() {
+            if (std::system(command.c_str()) != 0)
+                std::cout << "Worker process failed: " << command << std::endl;
+            runningProcesses--;
+            });
+    }
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+    std::vector<std::thread> workers;
+    bool failed = false;
+    while (true)
+    {
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (state.completedJobs == state.totalJobs)
+                break;
+            // Without remote workers nobody else can finish the jobs
+            if (settings.localWorkers > 0 && runningProcesses == 0 && state.activeWorkers == 0)
+            {
+                std::cout << "All workers exited with " << state.totalJobs - state.completedJobs << " jobs left" << std::endl;
+                failed = true;
+                break;
+            }
+        }
+
+        std::unique_ptr<Socket> connection = listener.Accept(100);
+        if (!connection)
+            continue;
+
+        std::lock_guard<std::mutex> lock(state.mutex);
+        uint32_t workerIndex = static_cast<uint32_t>(workers.size());
+        state.activeWorkers++;
+        workers.emplace_back(ServeWorker, std::move(connection), workerIndex, std::cref(settings), std::cref(sceneText), std::ref(state));
+    }
+    listener.Close();
+
+    {
+        std::unique_lock<std::mutex> lock(state.mutex);
+        state.condition.notify_all();
+    }
+    for (std::thread& worker : workers)
+        worker.join();
+    for (std::thread& process : processes)
+        process.join();
+    if (failed)
+        return 1;
+
+    double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+    // The accumulation image holds the sum of per dispatch averages
+    std::vector<float>& pixels = state.sums;
+    for (size_t i = 0; i < pixels.size(); i += 4)
+    {
+        for (size_t c = 0; c < 3; c++)
+            pixels[i + c] /= static_cast<float>(totalDispatches);
+        pixels[i + 3] = 1.0f;
+    }
+    if (!WriteImageLinear(settings.outputPath, settings.extent.width, settings.extent.height, pixels.data(), settings.halfFloat))
+    {
+        std::cout << "Failed to write " << settings.outputPath << std::endl;
+        return 1;
+    }
+
+    uint64_t samplesPerPixel = static_cast<uint64_t>(totalDispatches) * raysPerPixel;
+    uint64_t samples = samplesPerPixel * settings.extent.width * settings.extent.height;
+    std::cout << std::fixed << std::setprecision(2)
+        << "Rendered " << settings.extent.width << "x" << settings.extent.height << " at "
+        << samplesPerPixel << " spp to " << settings.outputPath << " in " << seconds << " s on "
+        << workers.size() << " workers (" << samples / seconds / 1e6 << " M samples/s)" << std::endl;
+    return 0;
+}
+
+int RunWorker(const std::string& host, uint16_t port)
+{
+    // The coordinator may still be starting up
+    Socket socket;
+    for (uint32_t attempt = 0; !socket.Connect(host, port); attempt++)
+    {
+        if (attempt == 50)
+        {
+            std::cout << "Failed to connect to " << host << ":" << port << std::endl;
+            return 1;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+
+    MessageHeader header;
+    SetupMessage setup;
+    if (!socket.Receive(&header, sizeof(header)) || header.type != MessageType::Setup
+        || header.size < sizeof(setup) || !socket.Receive(&setup, sizeof(setup))
+        || header.size != sizeof(setup) + setup.pathSize + setup.textSize)
+    {
+        std::cout << "Invalid setup from " << host << ":" << port << std::endl;
+        return 1;
+    }
+    std::string scenePath(setup.pathSize, '\0');
+    std::string sceneText(setup.textSize, '\0');
+    if (!socket.Receive(scenePath.data(), scenePath.size()) || !socket.Receive(sceneText.data(), sceneText.size()))
+        return 1;
+
+    Scene scene;
+    if (sceneText.empty())
+        scene = CreateDefaultScene();
+    else if (!LoadSceneFromText(sceneText, scenePath, scene))
+        return 1;
+
+    std::unique_ptr<Renderer> renderer = std::make_unique<Renderer>(nullptr, 2, VK_PRESENT_MODE_FIFO_KHR);
+    uint32_t renderedJobs = 0;
+    {
+        SpirvHelper::Init();
+        Shader computeShader("res/Shaders/Raytracing.comp");
+        SpirvHelper::Finalize();
+
+        // The images only hold one tile, the camera still covers the whole frame
+        VkExtent2D frameExtent = { setup.width, setup.height };
+        VkExtent2D tileExtent = { std::min(setup.tileSize, setup.width), std::min(setup.tileSize, setup.height) };
+        PathTracer pathTracer(tileExtent, computeShader.GetShaderStage());
+        SetSceneFrameData(scene, frameExtent, pathTracer.frameData);
+        pathTracer.SetScene(scene.spheres, scene.triangles, scene.meshes);
+
+        std::vector<float> accumulation(static_cast<size_t>(tileExtent.width) * tileExtent.height * 4);
+        std::vector<float> tile;
+        const uint32_t dispatchesPerSubmit = 16;
+        while (socket.Receive(&header, sizeof(header)) && header.type == MessageType::Job)
+        {
+            JobMessage job;
+            if (header.size != sizeof(job) || !socket.Receive(&job, sizeof(job)))
+                break;
+
+            pathTracer.SetRegion({ static_cast<int32_t>(job.x), static_cast<int32_t>(job.y) }, { job.width, job.height });
+            // Seeds follow the global dispatch index, so the samples match a single process render
+            pathTracer.frameData.seedOffset = job.dispatchStart;
+            for (uint32_t rendered = 0; rendered < job.dispatchCount;)
+            {
+                uint32_t dispatches = std::min(dispatchesPerSubmit, job.dispatchCount - rendered);
+                VkCommandBuffer cmd = renderer->BeginFrame();
+                pathTracer.frameData.frameIndex = rendered + 1;
+                pathTracer.UpdateFrameData();
+                pathTracer.CmdDispatch(cmd, dispatches);
+                renderer->EndFrame();
+                rendered += dispatches;
+            }
+            Core::Get()->WaitIdle();
+
+            pathTracer.GetAccumulationImage()->GetData(accumulation.data(), static_cast<uint32_t>(accumulation.size() * sizeof(float)));
+            tile.resize(static_cast<size_t>(job.width) * job.height * 4);
+            for (uint32_t y = 0; y < job.height; y++)
+                std::copy_n(accumulation.data() + static_cast<size_t>(y) * tileExtent.width * 4, job.width * 4, tile.data() + static_cast<size_t>(y) * job.width * 4);
+
+            if (!SendFarmMessage(socket, MessageType::Result, &job, sizeof(job), tile.data(), tile.size() * sizeof(float)))
+                break;
+            renderedJobs++;
+        }
+        Core::Get()->WaitIdle();
+    }
+
+    std::cout << "Worker rendered " << renderedJobs << " jobs" << std::endl;
+    return 0;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "Vulkan/VKHeaders.h"
+#include <string>
+
+/* Splits one image into jobs of a tile and a range of samples,	*/
+/* worker processes render the jobs headless and send back the	*/
+/* float sums which the coordinator merges into the image		*/
+struct FarmSettings
+{
+	/* Sent to the workers as text, meshes it references must	*/
+	/* exist relative to the working directory of every worker	*/
+	std::string scenePath;
+	std::string outputPath = "output.png";
+	VkExtent2D extent = { 1280, 720 };
+	uint32_t samplesPerPixel = 256;
+	uint32_t tileSize = 256;
+	/* Samples per job, 0 renders all samples of a tile at once	*/
+	uint32_t jobSamples = 0;
+	uint16_t port = 47000;
+	/* Worker processes started on this machine, more can		*/
+	/* connect from other machines with --worker				*/
+	uint32_t localWorkers = 0;
+	bool halfFloat = false;
+};
+
+/* executablePath starts the local workers					*/
+int RunCoordinator(const FarmSettings& settings, const std::string& executablePath);
+/* Renders jobs until the coordinator shuts it down			*/
+int RunWorker(const std::string& host, uint16_t port);
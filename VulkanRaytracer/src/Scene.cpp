@@ -0,0 +1,240 @@
+#include "Scene.h"
+#include "ModelLoader.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+
+static bool ReadVec3(std::istringstream& stream, glm::vec3& v)
+{
+    return static_cast<bool>(stream >> v.x >> v.y >> v.z);
+}
+
+static bool ReadMaterial(std::istringstream& stream, Material& material)
+{
+    material = {};
+    return ReadVec3(stream, material.color) && static_cast<bool>(stream >> material.light >> material.smoothness);
+}
+
+static bool ReadColor(std::istringstream& stream, glm::vec4& color)
+{
+    glm::vec3 c;
+    if (!ReadVec3(stream, c))
+        return false;
+    color = glm::vec4(c, 0.0);
+    return true;
+}
+
+// One mesh of nx * nz small right triangles with legs of size, facing down
+// from a width by depth rectangle centred on center
+static void AddEmitterGrid(Scene& scene, uint32_t nx, uint32_t nz, glm::vec3 center, float width, float depth, float size, const Material& material)
+{
+    Mesh mesh = {};
+    mesh.startTriangle = static_cast<int>(scene.triangles.size());
+    mesh.numTriangles = static_cast<int>(nx * nz);
+    mesh.boundingPoint1 = glm::vec4(center, 0.0f);
+    mesh.boundingPoint2 = glm::vec4(center, 0.0f);
+    mesh.material = material;
+
+    glm::vec4 down = glm::vec4(0.0f, -1.0f, 0.0f, 0.0f);
+    for (uint32_t z = 0; z < nz; z++)
+    {
+        for (uint32_t x = 0; x < nx; x++)
+        {
+            // The legs are centred on the cell
+            glm::vec3 corner = glm::vec3(center.x - width * 0.5f + (x + 0.5f) * width / nx - size * 0.5f, center.y,
+                center.z - depth * 0.5f + (z + 0.5f) * depth / nz - size * 0.5f);
+            Triangle tri;
+            // cross(p2 - p1, p3 - p1) points down, RayTriangle only hits the front
+            tri.p1 = glm::vec4(corner, 0.0f);
+            tri.p2 = glm::vec4(corner + glm::vec3(size, 0.0f, 0.0f), 0.0f);
+            tri.p3 = glm::vec4(corner + glm::vec3(0.0f, 0.0f, size), 0.0f);
+            tri.n1 = tri.n2 = tri.n3 = down;
+            scene.triangles.push_back(tri);
+
+            mesh.boundingPoint1 = glm::min(mesh.boundingPoint1, tri.p1);
+            mesh.boundingPoint2 = glm::max(mesh.boundingPoint2, tri.p2 + tri.p3 - tri.p1);
+        }
+    }
+    scene.meshes.push_back(mesh);
+}
+
+bool ParseSamplerType(const std::string& name, SamplerType& type)
+{
+    if (name == "pcg")
+        type = SamplerType::Pcg;
+    else if (name == "sobol")
+        type = SamplerType::Sobol;
+    else
+        return false;
+    return true;
+}
+
+bool LoadScene(const std::string& filePath, Scene& scene)
+{
+    std::ifstream file(filePath);
+    if (!file.is_open())
+    {
+        std::cout << "Failed to open scene " << filePath << std::endl;
+        return false;
+    }
+
+    std::stringstream text;
+    text << file.rdbuf();
+    return LoadSceneFromText(text.str(), filePath, scene);
+}
+
+bool LoadSceneFromText(const std::string& text, const std::string& filePath, Scene& scene)
+{
+    std::istringstream file(text);
+    scene = Scene();
+    std::string line;
+    uint32_t lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+
+        std::istringstream stream(line);
+        std::string directive;
+        if (!(stream >> directive))
+            continue;
+
+        bool valid = true;
+        if (directive == "camera")
+        {
+            valid = ReadVec3(stream, scene.cameraPosition) && ReadVec3(stream, scene.cameraTarget);
+            float fov;
+            if (valid && stream >> fov)
+                scene.cameraFov = fov;
+        }
+        else if (directive == "sky_horizon")
+            valid = ReadColor(stream, scene.skyColorHorizon);
+        else if (directive == "sky_zenith")
+            valid = ReadColor(stream, scene.skyColorZenith);
+        else if (directive == "ground")
+            valid = ReadColor(stream, scene.groundColor);
+        else if (directive == "sun")
+        {
+            glm::vec3 direction;
+            valid = ReadVec3(stream, direction) && static_cast<bool>(stream >> scene.sunFocus >> scene.sunIntensity);
+            scene.sunLightDirection = glm::vec4(direction, 0.0);
+        }
+        else if (directive == "rays_per_pixel")
+            valid = static_cast<bool>(stream >> scene.raysPerPixel) && scene.raysPerPixel > 0;
+        else if (directive == "max_bounces")
+            valid = static_cast<bool>(stream >> scene.maxBounces);
+        else if (directive == "roulette_depth")
+            valid = static_cast<bool>(stream >> scene.rouletteDepth);
+        else if (directive == "light_sampling")
+            valid = static_cast<bool>(stream >> scene.lightSampling);
+        else if (directive == "sampler")
+        {
+            std::string name;
+            valid = static_cast<bool>(stream >> name) && ParseSamplerType(name, scene.sampler);
+        }
+        else if (directive == "adaptive")
+        {
+            valid = static_cast<bool>(stream >> scene.adaptiveThreshold) && scene.adaptiveThreshold >= 0.0f;
+            uint32_t minSamples;
+            if (valid && stream >> minSamples)
+                scene.adaptiveMinSamples = minSamples;
+        }
+        else if (directive == "sphere")
+        {
+            Sphere sphere;
+            valid = ReadVec3(stream, sphere.center) && static_cast<bool>(stream >> sphere.radius) && ReadMaterial(stream, sphere.material);
+            if (valid)
+                scene.spheres.push_back(sphere);
+        }
+        else if (directive == "mesh")
+        {
+            std::string path;
+            Material material;
+            glm::vec3 translate = { 0.0, 0.0, 0.0 };
+            glm::vec3 scale = { 1.0, 1.0, 1.0 };
+            valid = static_cast<bool>(stream >> path) && ReadMaterial(stream, material);
+            // Translation and scale are optional
+            if (valid && ReadVec3(stream, translate))
+                ReadVec3(stream, scale);
+            if (valid)
+            {
+                size_t meshCount = scene.meshes.size();
+                LoadModel(path.c_str(), scene.triangles, scene.meshes, material, translate, scale);
+                if (scene.meshes.size() == meshCount)
+                {
+                    std::cout << filePath << ":" << lineNumber << ": failed to load mesh " << path << std::endl;
+                    return false;
+                }
+            }
+        }
+        else if (directive == "emitter_grid")
+        {
+            uint32_t nx, nz;
+            glm::vec3 center;
+            float width, depth, size;
+            Material material;
+            valid = static_cast<bool>(stream >> nx >> nz) && ReadVec3(stream, center) && static_cast<bool>(stream >> width >> depth >> size)
+                && ReadMaterial(stream, material) && nx > 0 && nz > 0 && size > 0.0f;
+            if (valid)
+                AddEmitterGrid(scene, nx, nz, center, width, depth, size, material);
+        }
+        else
+        {
+            std::cout << filePath << ":" << lineNumber << ": unknown directive " << directive << std::endl;
+            return false;
+        }
+
+        if (!valid)
+        {
+            std::cout << filePath << ":" << lineNumber << ": invalid " << directive << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+Scene CreateDefaultScene()
+{
+    Scene scene;
+
+    Sphere s;
+    s.center = { 1, 1, 0 };
+    s.radius = 0.5;
+    s.material = { { 1, 1, 1 }, 0, 0.1 };
+    scene.spheres.push_back(s);
+
+    LoadModel("res/Meshes/plane.obj", scene.triangles, scene.meshes, { {1, 1, 1}, 0, 0.8 }, { 0, 0, 0 }, { 2, 1, 2 });
+    LoadModel("res/Meshes/cube.obj", scene.triangles, scene.meshes, { {0.9, 0.9, 0.9}, 0, 0.1 }, { -1, 1, 0 });
+
+    return scene;
+}
+
+void SetSceneFrameData(const Scene& scene, VkExtent2D extent, FrameData& frameData)
+{
+    glm::vec3 forward = glm::normalize(scene.cameraTarget - scene.cameraPosition);
+    frameData.cameraInverseProjection = glm::inverse(glm::perspectiveFov(scene.cameraFov, (float)extent.width, (float)extent.height, 0.1f, 1000.0f));
+    frameData.cameraInverseView = glm::inverse(glm::lookAtLH(scene.cameraPosition, scene.cameraTarget, { 0.0, 1.0, 0.0 }));
+    frameData.cameraPos = glm::vec4(scene.cameraPosition, 0);
+    frameData.cameraDirection = glm::vec4(forward, 0);
+
+    frameData.window.x = extent.width;
+    frameData.window.y = extent.height;
+    frameData.raysPerPixel = scene.raysPerPixel;
+    frameData.maxBouceLimit = scene.maxBounces;
+    frameData.rouletteDepth = scene.rouletteDepth;
+    frameData.lightSampling = scene.lightSampling ? 1 : 0;
+    frameData.samplerType = static_cast<uint32_t>(scene.sampler);
+    frameData.adaptiveThreshold = scene.adaptiveThreshold;
+    frameData.adaptiveMinSamples = scene.adaptiveMinSamples;
+    frameData.frameIndex = 0;
+    frameData.sunLightDirection = scene.sunLightDirection;
+    frameData.sunFocus = scene.sunFocus;
+    frameData.sunIntensity = scene.sunIntensity;
+
+    frameData.skyColorHorizon = scene.skyColorHorizon;
+    frameData.skyColorZenith = scene.skyColorZenith;
+    frameData.groundColor = scene.groundColor;
+}
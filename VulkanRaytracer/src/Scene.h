@@ -0,0 +1,70 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+#include "RayTracingStructs.h"
+#include "Vulkan/VKHeaders.h"
+
+/* Everything needed to render one image, loaded from a	*/
+/* .scene file or built in code							*/
+struct Scene
+{
+    std::vector<Sphere> spheres;
+    std::vector<Triangle> triangles;
+    std::vector<Mesh> meshes;
+
+    glm::vec3 cameraPosition = { 4.0, 1.5, 0.0 };
+    glm::vec3 cameraTarget = { 0.0, 0.0, 0.0 };
+    /* Same units as CameraFPS::fov	*/
+    float cameraFov = 70.0f;
+
+    glm::vec4 skyColorHorizon = { 0.7, 0.3, 0.1, 0.0 };
+    glm::vec4 skyColorZenith = { 0.2, 0.56, 0.95, 0.0 };
+    glm::vec4 groundColor = { 0.9, 0.9, 0.9, 0.0 };
+    glm::vec4 sunLightDirection = { -0.4, -0.4, -0.4, 0.0 };
+    float sunFocus = 1.0f;
+    float sunIntensity = 1.0f;
+
+    uint32_t raysPerPixel = 4;
+    uint32_t maxBounces = 6;
+    /* Bounces before Russian roulette may end a path, a value	*/
+    /* of maxBounces or more disables it							*/
+    uint32_t rouletteDepth = 3;
+    /* Next event estimation toward the environment and the	*/
+    /* emitters, false samples the BSDF only					*/
+    bool lightSampling = true;
+    /* Random numbers of the samples, Sobol needs fewer of	*/
+    /* them for the same error									*/
+    SamplerType sampler = SamplerType::Sobol;
+    /* Target luminance RMSE of adaptive sampling, noisy		*/
+    /* pixels get more samples than flat ones, 0 disables it	*/
+    float adaptiveThreshold = 0.0f;
+    uint32_t adaptiveMinSamples = 64;
+};
+
+/* Line based text format, one directive per line, # starts a comment	*/
+/*   camera px py pz tx ty tz [fov]										*/
+/*   sky_horizon r g b / sky_zenith r g b / ground r g b				*/
+/*   sun dx dy dz focus intensity										*/
+/*   rays_per_pixel n / max_bounces n / roulette_depth n				*/
+/*   light_sampling 0|1 / sampler pcg|sobol								*/
+/*   adaptive target_rmse [min samples]									*/
+/*   sphere cx cy cz radius r g b light smoothness						*/
+/*   mesh file.obj r g b light smoothness [tx ty tz [sx sy sz]]			*/
+/*   emitter_grid nx nz cx cy cz width depth size r g b light smoothness	*/
+/*     nx * nz downward facing triangles with legs of size, one mesh		*/
+/* smoothness 0 is Lambertian and 1 a mirror, in between a GGX lobe	*/
+/* of roughness (1 - smoothness)^2 is picked with that probability		*/
+/* Mesh paths are relative to the working directory, like LoadModel	*/
+bool LoadScene(const std::string& filePath, Scene& scene);
+/* Same format from memory, filePath is only used in error messages	*/
+bool LoadSceneFromText(const std::string& text, const std::string& filePath, Scene& scene);
+
+/* pcg or sobol, false for anything else				*/
+bool ParseSamplerType(const std::string& name, SamplerType& type);
+
+/* The scene the interactive renderer starts with	*/
+Scene CreateDefaultScene();
+
+/* Fills the camera, sky and sampling fields of frameData	*/
+void SetSceneFrameData(const Scene& scene, VkExtent2D extent, FrameData& frameData);
@@ -0,0 +1,247 @@
+#include "Timeline.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+
+void Track::AddKey(float time, glm::vec4 value)
+{
+    auto it = std::upper_bound(keys.begin(), keys.end(), time, [](float t, const Keyframe& key) { return t < key.time; });
+    keys.insert(it, { time, value });
+}
+
+glm::vec4 Track::Evaluate(float time) const
+{
+    if (keys.empty())
+        return glm::vec4(0.0);
+    if (time <= keys.front().time)
+        return keys.front().value;
+    if (time >= keys.back().time)
+        return keys.back().value;
+
+    size_t i = 1;
+    while (keys[i].time < time)
+        i++;
+    const Keyframe& a = keys[i - 1];
+    const Keyframe& b = keys[i];
+
+    float t = (time - a.time) / std::max(b.time - a.time, 1e-6f);
+    if (interpolation == Interpolation::Step)
+        return a.value;
+    if (interpolation == Interpolation::Smooth)
+        t = t * t * (3.0f - 2.0f * t);
+    return (a.value * (1.0f - t)) + (b.value * t);
+}
+
+/* Number of values and the sphere index of a parameter name, 0 values if unknown	*/
+static uint32_t ParseParameter(const std::string& parameter, int& sphereIndex, std::string& sphereField)
+{
+    sphereIndex = -1;
+    if (parameter == "camera_position" || parameter == "camera_target" || parameter == "camera_orbit" ||
+        parameter == "sky_horizon" || parameter == "sky_zenith" || parameter == "ground" || parameter == "sun_direction")
+        return 3;
+    if (parameter == "camera_fov" || parameter == "sun_focus" || parameter == "sun_intensity")
+        return 1;
+
+    if (parameter.rfind("sphere.", 0) == 0)
+    {
+        size_t dot = parameter.find('.', 7);
+        if (dot == std::string::npos)
+            return 0;
+        try
+        {
+            sphereIndex = std::stoi(parameter.substr(7, dot - 7));
+        }
+        catch (const std::exception&)
+        {
+            return 0;
+        }
+        sphereField = parameter.substr(dot + 1);
+        if (sphereIndex < 0)
+            return 0;
+        if (sphereField == "center" || sphereField == "color")
+            return 3;
+        if (sphereField == "radius" || sphereField == "light" || sphereField == "smoothness")
+            return 1;
+    }
+    return 0;
+}
+
+bool Timeline::AddKey(const std::string& parameter, float time, glm::vec4 value)
+{
+    int sphereIndex;
+    std::string sphereField;
+    if (ParseParameter(parameter, sphereIndex, sphereField) == 0)
+        return false;
+
+    _tracks[parameter].AddKey(time, value);
+    return true;
+}
+
+bool Timeline::Load(const std::string& filePath)
+{
+    std::ifstream file(filePath);
+    if (!file.is_open())
+    {
+        std::cout << "Failed to open timeline " << filePath << std::endl;
+        return false;
+    }
+
+    std::string line;
+    uint32_t lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+
+        std::istringstream stream(line);
+        std::string directive;
+        if (!(stream >> directive))
+            continue;
+
+        bool valid = true;
+        if (directive == "duration")
+            valid = static_cast<bool>(stream >> duration) && duration > 0.0f;
+        else if (directive == "fps")
+            valid = static_cast<bool>(stream >> framesPerSecond) && framesPerSecond > 0;
+        else if (directive == "interpolation")
+        {
+            std::string parameter;
+            std::string mode;
+            valid = static_cast<bool>(stream >> parameter >> mode);
+            int sphereIndex;
+            std::string sphereField;
+            if (valid && ParseParameter(parameter, sphereIndex, sphereField) == 0)
+            {
+                std::cout << filePath << ":" << lineNumber << ": unknown parameter " << parameter << std::endl;
+                return false;
+            }
+            Track& track = _tracks[parameter];
+            if (mode == "linear")
+                track.interpolation = Track::Interpolation::Linear;
+            else if (mode == "smooth")
+                track.interpolation = Track::Interpolation::Smooth;
+            else if (mode == "step")
+                track.interpolation = Track::Interpolation::Step;
+            else
+                valid = false;
+        }
+        else if (directive == "key")
+        {
+            float time;
+            std::string parameter;
+            valid = static_cast<bool>(stream >> time >> parameter);
+
+            int sphereIndex;
+            std::string sphereField;
+            uint32_t count = valid ? ParseParameter(parameter, sphereIndex, sphereField) : 0;
+            glm::vec4 value(0.0);
+            for (uint32_t i = 0; i < count && valid; i++)
+                valid = static_cast<bool>(stream >> value[i]);
+            if (valid && count == 0)
+            {
+                std::cout << filePath << ":" << lineNumber << ": unknown parameter " << parameter << std::endl;
+                return false;
+            }
+            if (valid)
+                AddKey(parameter, time, value);
+        }
+        else
+        {
+            std::cout << filePath << ":" << lineNumber << ": unknown directive " << directive << std::endl;
+            return false;
+        }
+
+        if (!valid)
+        {
+            std::cout << filePath << ":" << lineNumber << ": invalid " << directive << std::endl;
+            return false;
+        }
+    }
+
+    // Interpolation lines alone do not make a track
+    for (auto it = _tracks.begin(); it != _tracks.end();)
+        it = it->second.keys.empty() ? _tracks.erase(it) : std::next(it);
+
+    return true;
+}
+
+void Timeline::Apply(float time, Scene& scene) const
+{
+    for (const auto& [parameter, track] : _tracks)
+    {
+        glm::vec4 v = track.Evaluate(time);
+        if (parameter == "camera_position")
+            scene.cameraPosition = glm::vec3(v);
+        else if (parameter == "camera_target")
+            scene.cameraTarget = glm::vec3(v);
+        else if (parameter == "camera_fov")
+            scene.cameraFov = v.x;
+        else if (parameter == "sky_horizon")
+            scene.skyColorHorizon = glm::vec4(glm::vec3(v), 0.0);
+        else if (parameter == "sky_zenith")
+            scene.skyColorZenith = glm::vec4(glm::vec3(v), 0.0);
+        else if (parameter == "ground")
+            scene.groundColor = glm::vec4(glm::vec3(v), 0.0);
+        else if (parameter == "sun_direction")
+            scene.sunLightDirection = glm::vec4(glm::vec3(v), 0.0);
+        else if (parameter == "sun_focus")
+            scene.sunFocus = v.x;
+        else if (parameter == "sun_intensity")
+            scene.sunIntensity = v.x;
+    }
+
+    // The orbit is relative to the target, so it is applied after it
+    auto orbit = _tracks.find("camera_orbit");
+    if (orbit != _tracks.end())
+    {
+        glm::vec4 v = orbit->second.Evaluate(time);
+        float angle = glm::radians(v.x);
+        scene.cameraPosition = scene.cameraTarget + glm::vec3(v.y * cos(angle), v.z, v.y * sin(angle));
+    }
+
+    for (const auto& [parameter, track] : _tracks)
+    {
+        int sphereIndex;
+        std::string field;
+        ParseParameter(parameter, sphereIndex, field);
+        if (sphereIndex < 0 || sphereIndex >= static_cast<int>(scene.spheres.size()))
+            continue;
+
+        Sphere& sphere = scene.spheres[sphereIndex];
+        glm::vec4 v = track.Evaluate(time);
+        if (field == "center")
+            sphere.center = glm::vec3(v);
+        else if (field == "radius")
+            sphere.radius = v.x;
+        else if (field == "color")
+            sphere.material.color = glm::vec3(v);
+        else if (field == "light")
+            sphere.material.light = v.x;
+        else if (field == "smoothness")
+            sphere.material.smoothness = v.x;
+    }
+}
+
+bool Timeline::AnimatesSpheres() const
+{
+    for (const auto& [parameter, track] : _tracks)
+    {
+        if (parameter.rfind("sphere.", 0) == 0)
+            return true;
+    }
+    return false;
+}
+
+uint32_t Timeline::GetFrameCount() const
+{
+    return std::max(static_cast<uint32_t>(std::lround(duration * framesPerSecond)), 1u);
+}
+
+float Timeline::GetFrameTime(uint32_t frame) const
+{
+    return static_cast<float>(frame) / static_cast<float>(framesPerSecond);
+}
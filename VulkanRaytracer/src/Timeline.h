@@ -0,0 +1,63 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+#include <map>
+#include "Scene.h"
+
+/* Keyframes of one scene parameter, every value is stored as a vec4	*/
+struct Track
+{
+    enum class Interpolation
+    {
+        Linear,
+        Smooth,
+        Step
+    };
+
+    struct Keyframe
+    {
+        float time;
+        glm::vec4 value;
+    };
+
+    /* Keeps the keyframes sorted by time	*/
+    void AddKey(float time, glm::vec4 value);
+    /* Clamps to the first and last keyframe	*/
+    glm::vec4 Evaluate(float time) const;
+
+    std::vector<Keyframe> keys;
+    Interpolation interpolation = Interpolation::Linear;
+};
+
+/* Keyframed camera, sky, sun and sphere parameters applied on top of a scene	*/
+/* Line based text format, # starts a comment									*/
+/*   duration seconds / fps n													*/
+/*   interpolation parameter linear|smooth|step									*/
+/*   key time parameter values...												*/
+/* Parameters: camera_position, camera_target, camera_fov,						*/
+/*   camera_orbit angle radius height (around camera_target, degrees),			*/
+/*   sky_horizon, sky_zenith, ground, sun_direction, sun_focus, sun_intensity,	*/
+/*   sphere.N.center, sphere.N.radius, sphere.N.color, sphere.N.light,			*/
+/*   sphere.N.smoothness															*/
+class Timeline
+{
+public:
+    bool Load(const std::string& filePath);
+
+    /* Returns false for an unknown parameter	*/
+    bool AddKey(const std::string& parameter, float time, glm::vec4 value);
+    void Apply(float time, Scene& scene) const;
+    /* True if a sphere is animated, the sphere buffer must be updated per frame	*/
+    bool AnimatesSpheres() const;
+
+    uint32_t GetFrameCount() const;
+    float GetFrameTime(uint32_t frame) const;
+
+    float duration = 1.0f;
+    uint32_t framesPerSecond = 30;
+
+private:
+
+    std::map<std::string, Track> _tracks;
+};
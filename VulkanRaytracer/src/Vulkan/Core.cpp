@@ -2,17 +2,21 @@
 #include <iostream>
 #include <set>
 #include <vector>
+#include <cstring>
 
-Core* Core::_coreInstance = nullptr;
+thread_local Core* Core::_coreInstance = nullptr;
 
-Core::Core(GLFWwindow* window)
+Core::Core(GLFWwindow* window, int32_t deviceIndex)
 {
     _coreInstance = this;
 
-    CreateInstance();
+    _surface = VK_NULL_HANDLE;
+
+    CreateInstance(window == nullptr);
     CreateDebugUtilsMessenger();
-    CreateSurface(window);
-    FindPhysicalDevice();
+    if (window)
+        CreateSurface(window);
+    FindPhysicalDevice(deviceIndex);
     FindQueueFamilyIndices();
     CreateLogicalDevice();
     GetDeviceQueue();
@@ -22,9 +26,12 @@ Core::Core(GLFWwindow* window)
 Core::~Core()
 {
     vkDeviceWaitIdle(_logicalDevice);
+    if (_computeCommandPool != _commandPool)
+        vkDestroyCommandPool(_logicalDevice, _computeCommandPool, nullptr);
     vkDestroyCommandPool(_logicalDevice, _commandPool, nullptr);
     vkDestroyDevice(_logicalDevice, nullptr);
-    vkDestroySurfaceKHR(_instance, _surface, nullptr);
+    if (_surface != VK_NULL_HANDLE)
+        vkDestroySurfaceKHR(_instance, _surface, nullptr);
 
 #ifdef VALIDATION
     PFN_vkDestroyDebugUtilsMessengerEXT func =
@@ -81,7 +88,7 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
     const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
     void* pUserData);
 
-void Core::CreateInstance()
+void Core::CreateInstance(bool headless)
 {
     VkApplicationInfo appInfo{};
     appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
@@ -113,9 +120,14 @@ void Core::CreateInstance()
     createInfo.pNext = (VkDebugUtilsMessengerCreateInfoEXT*)&debugCreateInfo;
 #endif
 
-    auto glfwExtensionCount = 0u;
-    auto glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-    std::vector<const char*> glfwExtensionsVector(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    // Headless runs never initialize GLFW, they need no surface extensions
+    std::vector<const char*> glfwExtensionsVector;
+    if (!headless)
+    {
+        auto glfwExtensionCount = 0u;
+        auto glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        glfwExtensionsVector.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
 
 #ifdef VALIDATION
     glfwExtensionsVector.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -150,7 +162,37 @@ void Core::CreateSurface(GLFWwindow* window)
     Logger::PrintFatalIf(err != VK_SUCCESS, "Failed to create window surface!");
 }
 
-void Core::FindPhysicalDevice()
+std::vector<std::string> Core::EnumeratePhysicalDevices()
+{
+    VkApplicationInfo appInfo{};
+    appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    appInfo.apiVersion = VK_API_VERSION_1_3;
+
+    VkInstanceCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    createInfo.pApplicationInfo = &appInfo;
+
+    VkInstance instance;
+    std::vector<std::string> names;
+    if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS)
+        return names;
+
+    uint32_t deviceCount = 0;
+    vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+    std::vector<VkPhysicalDevice> devices(deviceCount);
+    vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
+    for (VkPhysicalDevice device : devices)
+    {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(device, &properties);
+        names.push_back(properties.deviceName);
+    }
+
+    vkDestroyInstance(instance, nullptr);
+    return names;
+}
+
+void Core::FindPhysicalDevice(int32_t deviceIndex)
 {
     uint32_t deviceCount = 0;
     vkEnumeratePhysicalDevices(_instance, &deviceCount, nullptr);
@@ -163,6 +205,12 @@ void Core::FindPhysicalDevice()
     int32_t bestScore = 0;
     VkPhysicalDevice bestDevice = VK_NULL_HANDLE;
 
+    if (deviceIndex >= 0)
+    {
+        Logger::PrintFatalIf(static_cast<uint32_t>(deviceIndex) >= deviceCount, "Device index out of range!");
+        devices = { devices[deviceIndex] };
+    }
+
     for (VkPhysicalDevice& device : devices)
     {
         int32_t score = 0;
@@ -197,6 +245,13 @@ void Core::FindPhysicalDevice()
         _physicalDevice = bestDevice;
         vkGetPhysicalDeviceProperties(bestDevice, &_physicalDeviceProperties);
         Logger::PrintInfo("GPU name: %s", _physicalDeviceProperties.deviceName);
+
+        _subgroupProperties = {};
+        _subgroupProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+        VkPhysicalDeviceProperties2 properties2 = {};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &_subgroupProperties;
+        vkGetPhysicalDeviceProperties2(bestDevice, &properties2);
     }
 }
 
@@ -204,28 +259,37 @@ void Core::FindQueueFamilyIndices()
 {
     _queueFamilyIndices.graphicsFamilyIndex = uint32_t(-1);
     _queueFamilyIndices.presentFamilyIndex = uint32_t(-1);
+    _queueFamilyIndices.computeFamilyIndex = uint32_t(-1);
 
     uint32_t queueFamilyCount = 0;
     vkGetPhysicalDeviceQueueFamilyProperties(_physicalDevice, &queueFamilyCount, nullptr);
 
-    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
-    vkGetPhysicalDeviceQueueFamilyProperties(_physicalDevice, &queueFamilyCount, queueFamilies.data());
+    _queueFamilies.resize(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(_physicalDevice, &queueFamilyCount, _queueFamilies.data());
 
     int i = 0;
-    for (VkQueueFamilyProperties& queueFamily : queueFamilies)
+    for (VkQueueFamilyProperties& queueFamily : _queueFamilies)
     {
         if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT && queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) {
             _queueFamilyIndices.graphicsFamilyIndex = i;
         }
 
         VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(_physicalDevice, i, _surface, &presentSupport);
+        if (_surface != VK_NULL_HANDLE)
+            vkGetPhysicalDeviceSurfaceSupportKHR(_physicalDevice, i, _surface, &presentSupport);
         if (presentSupport) {
             _queueFamilyIndices.presentFamilyIndex = i;
         }
 
+        // A compute family without graphics support runs on its own hardware queue on most GPUs
+        if (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) &&
+            _queueFamilyIndices.computeFamilyIndex == uint32_t(-1)) {
+            _queueFamilyIndices.computeFamilyIndex = i;
+        }
+
         if (_queueFamilyIndices.graphicsFamilyIndex != -1 &&
-            _queueFamilyIndices.presentFamilyIndex != -1) {
+            _queueFamilyIndices.presentFamilyIndex != -1 &&
+            _queueFamilyIndices.computeFamilyIndex != -1) {
             break;
         }
 
@@ -235,12 +299,23 @@ void Core::FindQueueFamilyIndices()
     Logger::PrintFatalIf(_queueFamilyIndices.graphicsFamilyIndex == uint32_t(-1), 
         "Failed to find appropriate queue families!");
 
+    if (_surface == VK_NULL_HANDLE)
+        _queueFamilyIndices.presentFamilyIndex = _queueFamilyIndices.graphicsFamilyIndex;
+
+    if (_queueFamilyIndices.computeFamilyIndex == uint32_t(-1))
+        _queueFamilyIndices.computeFamilyIndex = _queueFamilyIndices.graphicsFamilyIndex;
+    else
+        Logger::PrintInfo("Dedicated compute queue family: %u", _queueFamilyIndices.computeFamilyIndex);
+
 }
 
 void Core::CreateLogicalDevice()
 {
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-    std::set<uint32_t> uniqueQueueFamilies = { _queueFamilyIndices.graphicsFamilyIndex, _queueFamilyIndices.presentFamilyIndex };
+    std::set<uint32_t> uniqueQueueFamilies = {
+        _queueFamilyIndices.graphicsFamilyIndex,
+        _queueFamilyIndices.presentFamilyIndex,
+        _queueFamilyIndices.computeFamilyIndex };
 
     float queuePriority = 1.0f;
     for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -252,15 +327,47 @@ void Core::CreateLogicalDevice()
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
-    VkPhysicalDeviceFeatures deviceFeatures = {};
-    deviceFeatures.textureCompressionBC = VK_TRUE;
-    deviceFeatures.imageCubeArray = VK_TRUE;
-    deviceFeatures.depthClamp = VK_TRUE;
-    deviceFeatures.depthBiasClamp = VK_TRUE;
-    deviceFeatures.depthBounds = VK_TRUE;
-    deviceFeatures.fillModeNonSolid = VK_TRUE;
+    // Only request what the device has, software devices like lavapipe lack some of these
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(_physicalDevice, &supportedFeatures);
 
-    std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+    VkPhysicalDeviceFeatures deviceFeatures = {};
+    deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+    deviceFeatures.imageCubeArray = supportedFeatures.imageCubeArray;
+    deviceFeatures.depthClamp = supportedFeatures.depthClamp;
+    deviceFeatures.depthBiasClamp = supportedFeatures.depthBiasClamp;
+    deviceFeatures.depthBounds = supportedFeatures.depthBounds;
+    deviceFeatures.fillModeNonSolid = supportedFeatures.fillModeNonSolid;
+
+    std::vector<const char*> deviceExtensions;
+    if (_surface != VK_NULL_HANDLE)
+        deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+
+    // Optional, per pixel cycle heatmaps use it
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(_physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(_physicalDevice, nullptr, &extensionCount, extensions.data());
+
+    VkPhysicalDeviceShaderClockFeaturesKHR clockFeatures = {};
+    clockFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_CLOCK_FEATURES_KHR;
+    _shaderClock = false;
+    for (const VkExtensionProperties& extension : extensions)
+    {
+        if (strcmp(extension.extensionName, VK_KHR_SHADER_CLOCK_EXTENSION_NAME) == 0)
+        {
+            VkPhysicalDeviceFeatures2 features2 = {};
+            features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+            features2.pNext = &clockFeatures;
+            vkGetPhysicalDeviceFeatures2(_physicalDevice, &features2);
+            _shaderClock = clockFeatures.shaderSubgroupClock == VK_TRUE;
+        }
+    }
+    if (_shaderClock)
+    {
+        deviceExtensions.push_back(VK_KHR_SHADER_CLOCK_EXTENSION_NAME);
+        clockFeatures.shaderDeviceClock = VK_FALSE;
+    }
 
     VkDeviceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -273,7 +380,7 @@ void Core::CreateLogicalDevice()
 
     VkPhysicalDeviceHostQueryResetFeatures resetFeatures;
     resetFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_QUERY_RESET_FEATURES;
-    resetFeatures.pNext = nullptr;
+    resetFeatures.pNext = _shaderClock ? &clockFeatures : nullptr;
     resetFeatures.hostQueryReset = VK_TRUE;
     createInfo.pNext = &resetFeatures;
 
@@ -292,6 +399,7 @@ void Core::GetDeviceQueue()
 {
     vkGetDeviceQueue(_logicalDevice, _queueFamilyIndices.graphicsFamilyIndex, 0, &_graphicsQueue);
     vkGetDeviceQueue(_logicalDevice, _queueFamilyIndices.presentFamilyIndex, 0, &_presentQueue);
+    vkGetDeviceQueue(_logicalDevice, _queueFamilyIndices.computeFamilyIndex, 0, &_computeQueue);
 }
 
 void Core::CreateCommandPool()
@@ -303,6 +411,14 @@ void Core::CreateCommandPool()
 
     VkResult err = vkCreateCommandPool(_logicalDevice, &poolInfo, nullptr, &_commandPool);
     Logger::PrintFatalIf(err != VK_SUCCESS, "Failed to create command pool!");
+
+    _computeCommandPool = _commandPool;
+    if (HasDedicatedComputeQueue())
+    {
+        poolInfo.queueFamilyIndex = _queueFamilyIndices.computeFamilyIndex;
+        err = vkCreateCommandPool(_logicalDevice, &poolInfo, nullptr, &_computeCommandPool);
+        Logger::PrintFatalIf(err != VK_SUCCESS, "Failed to create compute command pool!");
+    }
 }
 
 uint32_t Core::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags memoryVisibility)
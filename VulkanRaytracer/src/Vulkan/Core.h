@@ -5,13 +5,18 @@ struct QueueFamilyIndices
 {
 	uint32_t graphicsFamilyIndex;
 	uint32_t presentFamilyIndex;
+	uint32_t computeFamilyIndex;
 };
 
 class Swapchain;
 class Core
 {
 public:
-	Core(GLFWwindow* window);
+	/* Passing no window creates a headless device without	*/
+	/* surface and swapchain support							*/
+	/* deviceIndex selects a physical device by enumeration	*/
+	/* order, -1 picks the fastest one							*/
+	Core(GLFWwindow* window, int32_t deviceIndex = -1);
 	~Core();
 
 	void WaitIdle();
@@ -23,22 +28,37 @@ public:
 	VkDevice GetLogicalDevice() { return _logicalDevice; }
 	VkPhysicalDevice GetPhysicalDevice() { return _physicalDevice; }
 	VkPhysicalDeviceProperties& GetPhysicalDeviceProperties() { return _physicalDeviceProperties; }
+	VkPhysicalDeviceSubgroupProperties& GetSubgroupProperties() { return _subgroupProperties; }
 	VkCommandPool GetCommandPool() { return _commandPool; }
+	VkCommandPool GetComputeCommandPool() { return _computeCommandPool; }
 
 	QueueFamilyIndices GetQueueIndices() { return _queueFamilyIndices; }
 	VkQueue GetGraphicsQueue() { return _graphicsQueue; }
 	VkQueue GetPresentQueue() { return _presentQueue; }
+	VkQueue GetComputeQueue() { return _computeQueue; }
+	bool HasDedicatedComputeQueue() { return _queueFamilyIndices.computeFamilyIndex != _queueFamilyIndices.graphicsFamilyIndex; }
+	/* Meaningful bits of timestamps written on the family,	*/
+	/* 0 if its queues can not write timestamps at all			*/
+	uint32_t GetTimestampValidBits(uint32_t queueFamilyIndex) { return _queueFamilies[queueFamilyIndex].timestampValidBits; }
 	VkSurfaceKHR GetSurface() { return _surface; }
+	bool IsHeadless() { return _surface == VK_NULL_HANDLE; }
+	/* VK_KHR_shader_clock with subgroup clocks is enabled		*/
+	bool HasShaderClock() { return _shaderClock; }
 
 	uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags memoryVisibility);
 
+	/* Names of the physical devices in enumeration order	*/
+	static std::vector<std::string> EnumeratePhysicalDevices();
+
+	/* Every thread has its own current core, so one thread	*/
+	/* per device can drive several devices in one process		*/
 	static Core* Get() { return _coreInstance; }
 private:
 
-	void CreateInstance();
+	void CreateInstance(bool headless);
 	void CreateDebugUtilsMessenger();
 	void CreateSurface(GLFWwindow* window);
-	void FindPhysicalDevice();
+	void FindPhysicalDevice(int32_t deviceIndex);
 	void FindQueueFamilyIndices();
 	void CreateLogicalDevice();
 	void GetDeviceQueue();
@@ -48,16 +68,21 @@ private:
 	VkSurfaceKHR _surface;
 	VkPhysicalDevice _physicalDevice;
 	VkPhysicalDeviceProperties _physicalDeviceProperties;
+	VkPhysicalDeviceSubgroupProperties _subgroupProperties;
 	VkDevice _logicalDevice;
 	VkCommandPool _commandPool;
+	VkCommandPool _computeCommandPool;
 
 	QueueFamilyIndices _queueFamilyIndices;
+	std::vector<VkQueueFamilyProperties> _queueFamilies;
 	VkQueue _graphicsQueue;
 	VkQueue _presentQueue;
+	VkQueue _computeQueue;
+	bool _shaderClock;
 
 #ifdef VALIDATION
 	VkDebugUtilsMessengerEXT	_debugMessenger;
 #endif
 
-	static Core* _coreInstance;
+	static thread_local Core* _coreInstance;
 };
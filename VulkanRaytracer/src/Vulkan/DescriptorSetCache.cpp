@@ -11,6 +11,18 @@ DescriptorSetCache::DescriptorSetCache()
 	imageSamplerPoolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 	imageSamplerPoolSize.descriptorCount = 1000;
 	poolSizes.push_back(imageSamplerPoolSize);
+	VkDescriptorPoolSize uniformBufferPoolSize;
+	uniformBufferPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	uniformBufferPoolSize.descriptorCount = 1000;
+	poolSizes.push_back(uniformBufferPoolSize);
+	VkDescriptorPoolSize storageBufferPoolSize;
+	storageBufferPoolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	storageBufferPoolSize.descriptorCount = 1000;
+	poolSizes.push_back(storageBufferPoolSize);
+	VkDescriptorPoolSize storageImagePoolSize;
+	storageImagePoolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	storageImagePoolSize.descriptorCount = 1000;
+	poolSizes.push_back(storageImagePoolSize);
 
 
 	VkDescriptorPoolCreateInfo descriptorPoolInfo{};
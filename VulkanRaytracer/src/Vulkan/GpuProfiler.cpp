@@ -0,0 +1,194 @@
+#include "GpuProfiler.h"
+#include <algorithm>
+#include <cstring>
+
+GpuProfiler::GpuProfiler(uint32_t frameCount, uint32_t maxScopesPerFrame)
+{
+    _timestampPeriod = Core::Get()->GetPhysicalDeviceProperties().limits.timestampPeriod;
+    uint32_t validBits = std::min(Core::Get()->GetTimestampValidBits(Core::Get()->GetQueueIndices().graphicsFamilyIndex),
+        Core::Get()->GetTimestampValidBits(Renderer::Get()->GetComputeQueueFamilyIndex()));
+    _timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+    Logger::PrintInfoIf(validBits == 0, "Queues without timestamps, the GPU profiler records no times");
+    _maxScopes = maxScopesPerFrame;
+    _frameIndex = 0;
+    _frameNumber = 0;
+    _recorded.resize(frameCount);
+    _frameNumbers.resize(frameCount, 0);
+    _chromeTrace = false;
+    _firstEvent = true;
+    _captureStartTicks = 0;
+
+    VkQueryPoolCreateInfo queryPoolCreateInfo{};
+    queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCreateInfo.queryCount = frameCount * _maxScopes * 2;
+
+    VkResult err = vkCreateQueryPool(Core::Get()->GetLogicalDevice(), &queryPoolCreateInfo, nullptr, &_queryPool);
+    Logger::PrintFatalIf(err != VK_SUCCESS, "Failed to create profiler query pool!");
+    vkResetQueryPool(Core::Get()->GetLogicalDevice(), _queryPool, 0, queryPoolCreateInfo.queryCount);
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    StopCapture();
+    vkDestroyQueryPool(Core::Get()->GetLogicalDevice(), _queryPool, nullptr);
+}
+
+void GpuProfiler::BeginFrame(uint32_t frameIndex)
+{
+    Logger::PrintErrorIf(!_openScopes.empty(), "Profiler scope was not ended!");
+    _openScopes.clear();
+
+    _frameIndex = frameIndex;
+    CollectResults(frameIndex);
+    _frameNumbers[frameIndex] = ++_frameNumber;
+}
+
+void GpuProfiler::CmdBeginScope(VkCommandBuffer cmd, const char* name)
+{
+    std::vector<RecordedScope>& scopes = _recorded[_frameIndex];
+    uint32_t depth = static_cast<uint32_t>(_openScopes.size());
+    if (scopes.size() >= _maxScopes || _timestampMask == 0)
+    {
+        // Still balance CmdEndScope, the scope is just not timed
+        _openScopes.push_back(UINT32_MAX);
+        return;
+    }
+
+    RecordedScope scope;
+    scope.statisticsIndex = FindStatistics(name, depth);
+    scope.depth = depth;
+    scope.beginQuery = (_frameIndex * _maxScopes + static_cast<uint32_t>(scopes.size())) * 2;
+    scope.endQuery = scope.beginQuery + 1;
+    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _queryPool, scope.beginQuery);
+
+    _openScopes.push_back(static_cast<uint32_t>(scopes.size()));
+    scopes.push_back(scope);
+}
+
+void GpuProfiler::CmdEndScope(VkCommandBuffer cmd)
+{
+    if (_openScopes.empty())
+    {
+        Logger::PrintError("Profiler scope ended without a begin!");
+        return;
+    }
+
+    uint32_t index = _openScopes.back();
+    _openScopes.pop_back();
+    if (index != UINT32_MAX)
+        vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _queryPool, _recorded[_frameIndex][index].endQuery);
+}
+
+void GpuProfiler::Flush()
+{
+    // Oldest frame first so captures stay ordered
+    for (uint32_t i = 1; i <= _recorded.size(); i++)
+        CollectResults((_frameIndex + i) % _recorded.size());
+}
+
+bool GpuProfiler::StartCapture(const std::string& path)
+{
+    StopCapture();
+    _capture.open(path);
+    if (!_capture.is_open())
+        return false;
+
+    _chromeTrace = std::filesystem::path(path).extension() == ".json";
+    _firstEvent = true;
+    _captureStartTicks = 0;
+    if (_chromeTrace)
+        _capture << "{\"traceEvents\":[\n";
+    else
+        _capture << "frame,scope,depth,start_ms,duration_ms\n";
+    return true;
+}
+
+void GpuProfiler::StopCapture()
+{
+    if (!_capture.is_open())
+        return;
+    if (_chromeTrace)
+        _capture << "\n]}\n";
+    _capture.close();
+}
+
+void GpuProfiler::CollectResults(uint32_t frameIndex)
+{
+    std::vector<RecordedScope>& scopes = _recorded[frameIndex];
+    if (scopes.empty())
+        return;
+
+    // The frame's fence has signaled, so every written timestamp is available
+    uint32_t firstQuery = frameIndex * _maxScopes * 2;
+    uint32_t queryCount = static_cast<uint32_t>(scopes.size()) * 2;
+    std::vector<uint64_t> ticks(queryCount);
+    VkResult result = vkGetQueryPoolResults(Core::Get()->GetLogicalDevice(), _queryPool, firstQuery, queryCount,
+        ticks.size() * sizeof(uint64_t), ticks.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+    if (result == VK_SUCCESS)
+    {
+        if (IsCapturing() && _captureStartTicks == 0)
+            _captureStartTicks = ticks[0];
+
+        for (size_t i = 0; i < scopes.size(); i++)
+        {
+            const RecordedScope& scope = scopes[i];
+            // Only the valid bits count, differences stay right when the counter wraps
+            double milliseconds = ((ticks[2 * i + 1] - ticks[2 * i]) & _timestampMask) * (_timestampPeriod / 1e6);
+
+            ScopeStatistics& statistics = _statistics[scope.statisticsIndex];
+            std::vector<double>& history = _history[scope.statisticsIndex];
+            uint32_t& count = _historyCount[scope.statisticsIndex];
+            statistics.lastMs = milliseconds;
+            statistics.totalMs += milliseconds;
+            statistics.samples++;
+            history[count % HistorySize] = milliseconds;
+            count++;
+
+            size_t valid = std::min<size_t>(count, HistorySize);
+            statistics.minMs = *std::min_element(history.begin(), history.begin() + valid);
+            statistics.maxMs = *std::max_element(history.begin(), history.begin() + valid);
+            double sum = 0.0;
+            for (size_t h = 0; h < valid; h++)
+                sum += history[h];
+            statistics.averageMs = sum / valid;
+
+            if (!IsCapturing())
+                continue;
+            // Timestamps of earlier frames than the capture start would be negative, they wrap into
+            // the upper half of the valid range
+            uint64_t sinceStart = (ticks[2 * i] - _captureStartTicks) & _timestampMask;
+            double startMs = sinceStart <= (_timestampMask >> 1) ? sinceStart * (_timestampPeriod / 1e6) : 0.0;
+            if (_chromeTrace)
+            {
+                _capture << (_firstEvent ? "" : ",\n") << "{\"name\":\"" << statistics.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":"
+                    << scope.depth << ",\"ts\":" << startMs * 1000.0 << ",\"dur\":" << milliseconds * 1000.0
+                    << ",\"args\":{\"frame\":" << _frameNumbers[frameIndex] << "}}";
+                _firstEvent = false;
+            }
+            else
+            {
+                _capture << _frameNumbers[frameIndex] << "," << statistics.name << "," << scope.depth << ","
+                    << startMs << "," << milliseconds << "\n";
+            }
+        }
+    }
+
+    vkResetQueryPool(Core::Get()->GetLogicalDevice(), _queryPool, firstQuery, queryCount);
+    scopes.clear();
+}
+
+uint32_t GpuProfiler::FindStatistics(const char* name, uint32_t depth)
+{
+    for (size_t i = 0; i < _statistics.size(); i++)
+    {
+        if (_statistics[i].depth == depth && _statistics[i].name == name)
+            return static_cast<uint32_t>(i);
+    }
+
+    _statistics.push_back({ name, depth, 0.0, 0.0, 0.0, 0.0, 0.0, 0 });
+    _history.emplace_back(HistorySize, 0.0);
+    _historyCount.push_back(0);
+    return static_cast<uint32_t>(_statistics.size() - 1);
+}
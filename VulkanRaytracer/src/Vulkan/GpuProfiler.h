@@ -0,0 +1,85 @@
+#pragma once
+#include "VKHeaders.h"
+#include <fstream>
+
+/* Timestamps around named scopes of a frame. Every frame in	*/
+/* flight owns a range of queries, BeginFrame reads the results	*/
+/* of the slot's previous frame without waiting since the		*/
+/* renderer already waited on that frame's fence				*/
+class GpuProfiler
+{
+public:
+	struct ScopeStatistics
+	{
+		std::string name;
+		uint32_t depth;
+		double lastMs;
+		double averageMs;
+		double minMs;
+		double maxMs;
+		/* Every resolved frame, not only the history			*/
+		double totalMs;
+		uint64_t samples;
+	};
+
+	/* Scopes may record on the graphics queue and the compute	*/
+	/* queue of the current Renderer, without timestamps on one	*/
+	/* of them the scopes are kept but never timed				*/
+	GpuProfiler(uint32_t frameCount, uint32_t maxScopesPerFrame = 32);
+	~GpuProfiler();
+
+	/* Call right after Renderer::BeginFrame					*/
+	void BeginFrame(uint32_t frameIndex);
+	/* Scopes nest, the command buffers of one frame may differ	*/
+	/* but a scope has to end on the buffer it began on		*/
+	void CmdBeginScope(VkCommandBuffer cmd, const char* name);
+	void CmdEndScope(VkCommandBuffer cmd);
+	/* Collects every frame in flight, wait for the device first	*/
+	void Flush();
+
+	/* Scopes in order of their first appearance, the average,	*/
+	/* min and max cover the last HistorySize frames			*/
+	const std::vector<ScopeStatistics>& GetStatistics() { return _statistics; }
+
+	/* Writes every resolved scope to path until StopCapture,	*/
+	/* a .json path is a Chrome trace and anything else csv		*/
+	bool StartCapture(const std::string& path);
+	void StopCapture();
+	bool IsCapturing() { return _capture.is_open(); }
+
+	static constexpr uint32_t HistorySize = 120;
+
+private:
+
+	struct RecordedScope
+	{
+		uint32_t statisticsIndex;
+		uint32_t depth;
+		uint32_t beginQuery;
+		uint32_t endQuery;
+	};
+
+	void CollectResults(uint32_t frameIndex);
+	uint32_t FindStatistics(const char* name, uint32_t depth);
+
+	VkQueryPool _queryPool;
+	double _timestampPeriod;
+	/* Valid bits of the timestamps of every recording queue	*/
+	uint64_t _timestampMask;
+	uint32_t _maxScopes;
+	uint32_t _frameIndex;
+
+	std::vector<std::vector<RecordedScope>> _recorded;
+	std::vector<uint32_t> _openScopes;
+	std::vector<uint64_t> _frameNumbers;
+	uint64_t _frameNumber;
+
+	std::vector<ScopeStatistics> _statistics;
+	std::vector<std::vector<double>> _history;
+	std::vector<uint32_t> _historyCount;
+
+	std::ofstream _capture;
+	bool _chromeTrace;
+	bool _firstEvent;
+	uint64_t _captureStartTicks;
+};
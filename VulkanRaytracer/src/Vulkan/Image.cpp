@@ -109,6 +109,37 @@ void Image::SetData(const void* data, uint32_t size, ImageLayout newLayout)
     Core::Get()->EndSingleTimeCommands(cmd);
 }
 
+void Image::GetData(void* data, uint32_t size)
+{
+    Buffer stagingBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    VkCommandBuffer cmd = Core::Get()->BeginSingleTimeCommands();
+
+    VkMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+
+    VkBufferImageCopy region = {};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent.width = _width;
+    region.imageExtent.height = _height;
+    region.imageExtent.depth = 1;
+    vkCmdCopyImageToBuffer(cmd, _image, VK_IMAGE_LAYOUT_GENERAL, stagingBuffer.GetHandle(), 1, &region);
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+
+    Core::Get()->EndSingleTimeCommands(cmd);
+
+    void* copyData = stagingBuffer.Map();
+    memcpy(data, copyData, static_cast<size_t>(size));
+    stagingBuffer.Unmap();
+}
+
 Image::~Image()
 {
     vkFreeMemory(Core::Get()->GetLogicalDevice(), _imageMemory, nullptr);
@@ -7,6 +7,8 @@ public:
 	Image(VkExtent2D extent, Format format, VkImageUsageFlags usageFlags);
 	~Image();
 	void SetData(const void* data, uint32_t size, ImageLayout newLayout);
+	/* Blocking readback, the image must be in general layout	*/
+	void GetData(void* data, uint32_t size);
 
 	uint32_t Width() { return _width; }
 	uint32_t Height() { return _height; }
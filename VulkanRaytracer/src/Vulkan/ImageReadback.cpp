@@ -0,0 +1,209 @@
+#include "ImageReadback.h"
+#include "../Helper.h"
+#include <algorithm>
+
+ImageReadback::ImageReadback(VkExtent2D extent, uint32_t bytesPerPixel, uint32_t slotCount, uint32_t encoderThreadCount)
+{
+    _extent = extent;
+    _size = extent.width * extent.height * bytesPerPixel;
+    _stop = false;
+    _completedCount = 0;
+    _captureCount = 0;
+
+    _slots.resize(std::max(slotCount, 1u));
+    for (Slot& slot : _slots)
+    {
+        slot.buffer = std::make_unique<Buffer>(_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        // Stays mapped for the lifetime of the ring
+        slot.data = slot.buffer->Map();
+        slot.state = SlotState::Free;
+        slot.frameNumber = 0;
+        slot.sequence = 0;
+    }
+
+    for (uint32_t i = 0; i < std::max(encoderThreadCount, 1u); i++)
+        _encoders.emplace_back(&ImageReadback::EncoderLoop, this);
+}
+
+ImageReadback::~ImageReadback()
+{
+    Flush();
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _queueCondition.notify_all();
+    for (std::thread& encoder : _encoders)
+        encoder.join();
+
+    for (Slot& slot : _slots)
+        slot.buffer->Unmap();
+}
+
+ImageReadback::Slot* ImageReadback::AcquireSlot(Callback callback)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (Slot& slot : _slots)
+    {
+        if (slot.state != SlotState::Free)
+            continue;
+
+        slot.state = SlotState::Recorded;
+        slot.frameNumber = Renderer::Get()->GetFrameNumber();
+        slot.sequence = _captureCount++;
+        slot.callback = std::move(callback);
+        return &slot;
+    }
+    return nullptr;
+}
+
+static void CmdBeginCopy(VkCommandBuffer cmd)
+{
+    VkMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+static void CmdEndCopy(VkCommandBuffer cmd)
+{
+    // Compute of the next frame must not overwrite the source before the copy read it
+    VkMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+bool ImageReadback::CmdCapture(VkCommandBuffer cmd, VkImage image, Callback callback)
+{
+    Slot* slot = AcquireSlot(std::move(callback));
+    if (!slot)
+        return false;
+
+    CmdBeginCopy(cmd);
+    VkBufferImageCopy region = {};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent.width = _extent.width;
+    region.imageExtent.height = _extent.height;
+    region.imageExtent.depth = 1;
+    vkCmdCopyImageToBuffer(cmd, image, VK_IMAGE_LAYOUT_GENERAL, slot->buffer->GetHandle(), 1, &region);
+    CmdEndCopy(cmd);
+
+    return true;
+}
+
+bool ImageReadback::CmdCaptureBuffer(VkCommandBuffer cmd, VkBuffer buffer, Callback callback)
+{
+    Slot* slot = AcquireSlot(std::move(callback));
+    if (!slot)
+        return false;
+
+    CmdBeginCopy(cmd);
+    VkBufferCopy region = {};
+    region.size = _size;
+    vkCmdCopyBuffer(cmd, buffer, slot->buffer->GetHandle(), 1, &region);
+    CmdEndCopy(cmd);
+
+    return true;
+}
+
+bool ImageReadback::CmdCapturePNG(VkCommandBuffer cmd, VkImage image, const std::string& path)
+{
+    return CmdCapture(cmd, image, [path](const void* data, VkExtent2D extent) {
+        if (!WriteImagePNG(path, extent.width, extent.height, static_cast<const uint8_t*>(data)))
+            Logger::PrintError("Failed to write %s", path.c_str());
+        });
+}
+
+void ImageReadback::Update()
+{
+    Renderer* renderer = Renderer::Get();
+    bool queued = false;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        std::vector<uint32_t> completed;
+        for (uint32_t i = 0; i < _slots.size(); i++)
+        {
+            if (_slots[i].state == SlotState::Recorded && renderer->IsFrameComplete(_slots[i].frameNumber))
+                completed.push_back(i);
+        }
+        std::sort(completed.begin(), completed.end(), [this](uint32_t a, uint32_t b) { return _slots[a].sequence < _slots[b].sequence; });
+
+        for (uint32_t i : completed)
+        {
+            _slots[i].state = SlotState::Encoding;
+            _queue.push_back(i);
+            queued = true;
+        }
+    }
+    if (queued)
+        _queueCondition.notify_all();
+}
+
+void ImageReadback::Flush()
+{
+    Renderer* renderer = Renderer::Get();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (Slot& slot : _slots)
+        {
+            // Captures in the frame that is still being recorded are left alone
+            if (slot.state == SlotState::Recorded && slot.frameNumber < renderer->GetFrameNumber())
+                renderer->WaitForFrame(slot.frameNumber);
+        }
+    }
+    Update();
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _idleCondition.wait(lock, [this]() {
+        for (const Slot& slot : _slots)
+        {
+            if (slot.state == SlotState::Encoding)
+                return false;
+        }
+        return true;
+        });
+}
+
+uint32_t ImageReadback::GetBusySlotCount()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    uint32_t count = 0;
+    for (const Slot& slot : _slots)
+        count += slot.state != SlotState::Free ? 1 : 0;
+    return count;
+}
+
+void ImageReadback::EncoderLoop()
+{
+    while (true)
+    {
+        uint32_t index;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _queueCondition.wait(lock, [this]() { return _stop || !_queue.empty(); });
+            if (_queue.empty())
+                return;
+            index = _queue.front();
+            _queue.pop_front();
+        }
+
+        // The slot is owned by this thread until it is marked free
+        Slot& slot = _slots[index];
+        slot.callback(slot.data, _extent);
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            slot.callback = nullptr;
+            slot.state = SlotState::Free;
+        }
+        _completedCount++;
+        _idleCondition.notify_all();
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include "VKHeaders.h"
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <atomic>
+
+/* Copies images into a ring of preallocated host visible buffers		*/
+/* The copy is recorded into the frame's command buffer, once the frame	*/
+/* fence signals the pixels are handed to background encoder threads	*/
+class ImageReadback
+{
+public:
+	/* Runs on an encoder thread, data is only valid during the call	*/
+	using Callback = std::function<void(const void* data, VkExtent2D extent)>;
+
+	ImageReadback(VkExtent2D extent, uint32_t bytesPerPixel, uint32_t slotCount = 4, uint32_t encoderThreadCount = 1);
+	/* Finishes every capture of a submitted frame	*/
+	~ImageReadback();
+
+	/* The image must be in general layout and written by compute or	*/
+	/* fragment shaders, returns false when every slot is still busy		*/
+	bool CmdCapture(VkCommandBuffer cmd, VkImage image, Callback callback);
+	/* Same for a buffer written by compute, of extent * bytesPerPixel	*/
+	bool CmdCaptureBuffer(VkCommandBuffer cmd, VkBuffer buffer, Callback callback);
+	/* Writes the image as png with sRGB encoding, for rgba8 images		*/
+	bool CmdCapturePNG(VkCommandBuffer cmd, VkImage image, const std::string& path);
+
+	/* Hands finished copies to the encoders, call once per frame		*/
+	void Update();
+	/* Waits until every capture of a submitted frame has been encoded	*/
+	void Flush();
+
+	uint32_t GetBusySlotCount();
+	uint64_t GetCompletedCount() { return _completedCount; }
+
+private:
+
+	enum class SlotState
+	{
+		Free,
+		Recorded,
+		Encoding
+	};
+
+	struct Slot
+	{
+		std::unique_ptr<Buffer> buffer;
+		void* data;
+		SlotState state;
+		uint64_t frameNumber;
+		uint64_t sequence;
+		Callback callback;
+	};
+
+	Slot* AcquireSlot(Callback callback);
+	void EncoderLoop();
+
+	VkExtent2D _extent;
+	uint32_t _size;
+	std::vector<Slot> _slots;
+
+	std::vector<std::thread> _encoders;
+	/* With one encoder thread callbacks run in capture order	*/
+	std::deque<uint32_t> _queue;
+	uint64_t _captureCount;
+	std::mutex _mutex;
+	std::condition_variable _queueCondition;
+	std::condition_variable _idleCondition;
+	bool _stop;
+	std::atomic<uint64_t> _completedCount;
+};
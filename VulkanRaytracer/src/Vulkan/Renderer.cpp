@@ -3,24 +3,41 @@
 #include <fstream>
 #include "../../dependencies/stb/stb_image_write.h"
 
-Renderer* Renderer::_rendererInstance = nullptr;
+thread_local Renderer* Renderer::_rendererInstance = nullptr;
 
-Renderer::Renderer(GLFWwindow* window, uint32_t imagesCount, VkPresentModeKHR preferredMode)
+Renderer::Renderer(GLFWwindow* window, uint32_t imagesCount, VkPresentModeKHR preferredMode, bool asyncCompute, int32_t deviceIndex)
 {
 	_rendererInstance = this;
 
     _window = window;
-	_core = std::make_unique<Core>(window);
-	int w, h;
-	glfwGetFramebufferSize(window, &w, &h);
+	_core = std::make_unique<Core>(window, deviceIndex);
+    _frameIndex = 0;
+    _frameNumber = 1;
+    _completedFrameNumber = 0;
+    _computeSubmitted = false;
+    renderStatistics = {};
+    _asyncCompute = asyncCompute && _core->HasDedicatedComputeQueue();
+    Logger::PrintInfoIf(asyncCompute && !_asyncCompute, "No dedicated compute queue, async compute disabled");
+
+    if (window)
+    {
+        int w, h;
+        glfwGetFramebufferSize(window, &w, &h);
 
-    VkSurfaceCapabilitiesKHR capabilities;
-    vkGetPhysicalDeviceSurfaceCapabilitiesKHR(Core::Get()->GetPhysicalDevice(), Core::Get()->GetSurface(), &capabilities);
-    
-    _imageCount = std::clamp(imagesCount, capabilities.minImageCount, capabilities.maxImageCount);
-    _inFlightImageCount = _imageCount - 1;
+        VkSurfaceCapabilitiesKHR capabilities;
+        vkGetPhysicalDeviceSurfaceCapabilitiesKHR(Core::Get()->GetPhysicalDevice(), Core::Get()->GetSurface(), &capabilities);
+
+        _imageCount = std::clamp(imagesCount, capabilities.minImageCount, capabilities.maxImageCount);
+        _inFlightImageCount = _imageCount - 1;
 
-	_swapchain = std::make_unique<Swapchain>(VkExtent2D{static_cast<uint32_t>(w), static_cast<uint32_t>(h)}, _imageCount, preferredMode);
+        _swapchain = std::make_unique<Swapchain>(VkExtent2D{ static_cast<uint32_t>(w), static_cast<uint32_t>(h) }, _imageCount, preferredMode);
+    }
+    else
+    {
+        // Headless, frames only render into offscreen images
+        _imageCount = std::max(imagesCount, 2u);
+        _inFlightImageCount = _imageCount - 1;
+    }
     _descriptorSetCache = std::make_unique<DescriptorSetCache>();
 
     CreateFrameSyncObjects();
@@ -29,6 +46,8 @@ Renderer::Renderer(GLFWwindow* window, uint32_t imagesCount, VkPresentModeKHR pr
 void Renderer::CreateFrameSyncObjects()
 {
 	_frameSyncObjects.resize(_inFlightImageCount);
+    _submittedFrameNumbers.resize(_inFlightImageCount, 0);
+    _pendingComputeImages.resize(_inFlightImageCount);
     _commandBuffers.resize(_inFlightImageCount);
 
     VkSemaphoreCreateInfo semaphoreInfo = {};
@@ -43,6 +62,8 @@ void Renderer::CreateFrameSyncObjects()
             VK_SUCCESS ||
             vkCreateSemaphore(Core::Get()->GetLogicalDevice(), &semaphoreInfo, nullptr, &_frameSyncObjects[i].renderSemaphore) !=
             VK_SUCCESS ||
+            vkCreateSemaphore(Core::Get()->GetLogicalDevice(), &semaphoreInfo, nullptr, &_frameSyncObjects[i].computeSemaphore) !=
+            VK_SUCCESS ||
             vkCreateFence(Core::Get()->GetLogicalDevice(), &fenceInfo, nullptr, &_frameSyncObjects[i].renderFence) != VK_SUCCESS)
         {
             Logger::PrintFatal("Failed to create synchronization objects for a frame!");
@@ -57,6 +78,14 @@ void Renderer::CreateFrameSyncObjects()
 
     VkResult err = vkAllocateCommandBuffers(Core::Get()->GetLogicalDevice(), &allocInfo, _commandBuffers.data());
     Logger::PrintErrorIf(err != VK_SUCCESS, "Failed to allocate command buffers!");
+
+    if (_asyncCompute)
+    {
+        _computeCommandBuffers.resize(_inFlightImageCount);
+        allocInfo.commandPool = Core::Get()->GetComputeCommandPool();
+        err = vkAllocateCommandBuffers(Core::Get()->GetLogicalDevice(), &allocInfo, _computeCommandBuffers.data());
+        Logger::PrintErrorIf(err != VK_SUCCESS, "Failed to allocate compute command buffers!");
+    }
 }
 
 VkCommandBuffer Renderer::BeginFrame()
@@ -70,7 +99,8 @@ VkCommandBuffer Renderer::BeginFrame()
         VK_TRUE,
         std::numeric_limits<uint64_t>::max());
     
-    _swapchain->AcquireNextImage(_frameSyncObjects[_frameIndex].presentSemaphore);
+    if (_swapchain)
+        _swapchain->AcquireNextImage(_frameSyncObjects[_frameIndex].presentSemaphore);
 
     VkCommandBuffer cmd = _commandBuffers[_frameIndex];
     
@@ -79,7 +109,43 @@ VkCommandBuffer Renderer::BeginFrame()
     
     VkResult err = vkBeginCommandBuffer(cmd, &beginInfo);
     Logger::PrintErrorIf(err != VK_SUCCESS, "Failed to begin recording command buffer!");
-    
+
+    // The graphics fence above also covers the compute work the previous graphics submit waited on
+    _computeSubmitted = false;
+    renderStatistics = {};
+    if (_asyncCompute)
+    {
+        err = vkBeginCommandBuffer(_computeCommandBuffers[_frameIndex], &beginInfo);
+        Logger::PrintErrorIf(err != VK_SUCCESS, "Failed to begin recording compute command buffer!");
+    }
+
+    // Acquire the images graphics released the last time this frame slot was used, the fence
+    // above already waited for that submit so compute never waits on the frame before it
+    QueueFamilyIndices indices = Core::Get()->GetQueueIndices();
+    for (VkImage image : _pendingComputeImages[_frameIndex])
+    {
+        VkImageMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.srcQueueFamilyIndex = _asyncCompute ? indices.graphicsFamilyIndex : VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = _asyncCompute ? indices.computeFamilyIndex : VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange = VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+        vkCmdPipelineBarrier(
+            GetComputeCommandBuffer(),
+            _asyncCompute ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0,
+            0, nullptr,
+            0, nullptr,
+            1, &barrier);
+    }
+    _pendingComputeImages[_frameIndex].clear();
+
     renderStatistics.drawCalls = 0;
     renderStatistics.vertices = 0;
     renderStatistics.triangles = 0;
@@ -87,8 +153,105 @@ VkCommandBuffer Renderer::BeginFrame()
     return cmd;
 }
 
+VkCommandBuffer Renderer::GetComputeCommandBuffer()
+{
+    return _asyncCompute ? _computeCommandBuffers[_frameIndex] : _commandBuffers[_frameIndex];
+}
+
+uint32_t Renderer::GetComputeQueueFamilyIndex()
+{
+    QueueFamilyIndices indices = Core::Get()->GetQueueIndices();
+    return _asyncCompute ? indices.computeFamilyIndex : indices.graphicsFamilyIndex;
+}
+
+void Renderer::SubmitCompute()
+{
+    if (!_asyncCompute || _computeSubmitted)
+        return;
+
+    VkCommandBuffer cmd = _computeCommandBuffers[_frameIndex];
+    VkResult err = vkEndCommandBuffer(cmd);
+    Logger::PrintErrorIf(err != VK_SUCCESS, "Failed to record compute command buffer!");
+
+    // Nothing to wait for, the compute work does not depend on the swapchain and the images
+    // graphics may still read belong to the other frame slots
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &cmd;
+
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &_frameSyncObjects[_frameIndex].computeSemaphore;
+
+    err = vkQueueSubmit(Core::Get()->GetComputeQueue(), 1, &submitInfo, VK_NULL_HANDLE);
+    Logger::PrintFatalIf(err != VK_SUCCESS, "Failed to submit compute command buffer!");
+
+    _computeSubmitted = true;
+}
+
+void Renderer::CmdComputeToGraphics(VkImage image)
+{
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange = VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+    if (!_asyncCompute)
+    {
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+        vkCmdPipelineBarrier(_commandBuffers[_frameIndex], VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &barrier);
+        return;
+    }
+
+    // Release on the compute queue
+    barrier.srcQueueFamilyIndex = Core::Get()->GetQueueIndices().computeFamilyIndex;
+    barrier.dstQueueFamilyIndex = Core::Get()->GetQueueIndices().graphicsFamilyIndex;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+    vkCmdPipelineBarrier(_computeCommandBuffers[_frameIndex], VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    // Acquire on the graphics queue, visibility is provided by the compute semaphore
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(_commandBuffers[_frameIndex], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void Renderer::CmdGraphicsToCompute(VkImage image)
+{
+    if (_asyncCompute)
+    {
+        VkImageMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = 0;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.srcQueueFamilyIndex = Core::Get()->GetQueueIndices().graphicsFamilyIndex;
+        barrier.dstQueueFamilyIndex = Core::Get()->GetQueueIndices().computeFamilyIndex;
+        barrier.image = image;
+        barrier.subresourceRange = VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+        vkCmdPipelineBarrier(_commandBuffers[_frameIndex], VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    // The matching acquire is recorded into the compute command buffer of this frame slot's next use
+    _pendingComputeImages[_frameIndex].push_back(image);
+}
+
 void Renderer::EndFrame()
 {
+    SubmitCompute();
+
     VkCommandBuffer cmd = _commandBuffers[_frameIndex];
     VkResult err = vkEndCommandBuffer(cmd);
     Logger::PrintErrorIf(err != VK_SUCCESS, "Failed to record command buffer!");
@@ -101,27 +264,79 @@ void Renderer::EndFrame()
     VkSubmitInfo submitInfo = {};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-    VkSemaphore waitSemaphores[] = { _frameSyncObjects[_frameIndex].presentSemaphore };
-    VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = waitSemaphores;
-    submitInfo.pWaitDstStageMask = waitStages;
+    std::vector<VkSemaphore> waitSemaphores;
+    std::vector<VkPipelineStageFlags> waitStages;
+    std::vector<VkSemaphore> signalSemaphores;
+    if (_swapchain)
+    {
+        waitSemaphores.push_back(_frameSyncObjects[_frameIndex].presentSemaphore);
+        waitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+        signalSemaphores.push_back(_frameSyncObjects[_frameIndex].renderSemaphore);
+    }
+    if (_asyncCompute)
+    {
+        waitSemaphores.push_back(_frameSyncObjects[_frameIndex].computeSemaphore);
+        waitStages.push_back(VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT);
+    }
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+    submitInfo.pWaitSemaphores = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask = waitStages.data();
 
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &cmd;
 
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = &_frameSyncObjects[_frameIndex].renderSemaphore;
+    submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+    submitInfo.pSignalSemaphores = signalSemaphores.data();
 
     vkResetFences(Core::Get()->GetLogicalDevice(), 1, &_frameSyncObjects[_frameIndex].renderFence);
     err = vkQueueSubmit(Core::Get()->GetGraphicsQueue(), 1, &submitInfo, _frameSyncObjects[_frameIndex].renderFence);
     Logger::PrintFatalIf(err != VK_SUCCESS, "Failed to submit command buffer!");
+    _submittedFrameNumbers[_frameIndex] = _frameNumber++;
 
-    _swapchain->PresentImage(_frameSyncObjects[_frameIndex].renderSemaphore);
+    if (_swapchain)
+        _swapchain->PresentImage(_frameSyncObjects[_frameIndex].renderSemaphore);
 
     _frameIndex = (_frameIndex + 1) % _inFlightImageCount;
 }
 
+bool Renderer::IsFrameComplete(uint64_t frameNumber)
+{
+    if (frameNumber <= _completedFrameNumber)
+        return true;
+    if (frameNumber >= _frameNumber)
+        return false;
+
+    // A frame whose slot was reused has been waited on by BeginFrame
+    for (size_t i = 0; i < _submittedFrameNumbers.size(); i++)
+    {
+        if (_submittedFrameNumbers[i] != frameNumber)
+            continue;
+        if (vkGetFenceStatus(Core::Get()->GetLogicalDevice(), _frameSyncObjects[i].renderFence) != VK_SUCCESS)
+            return false;
+        break;
+    }
+
+    // Submits on the graphics queue finish in order
+    _completedFrameNumber = frameNumber;
+    return true;
+}
+
+void Renderer::WaitForFrame(uint64_t frameNumber)
+{
+    if (frameNumber >= _frameNumber)
+    {
+        Logger::PrintError("Waiting for a frame that was not submitted!");
+        return;
+    }
+
+    for (size_t i = 0; i < _submittedFrameNumbers.size(); i++)
+    {
+        if (_submittedFrameNumbers[i] == frameNumber)
+            vkWaitForFences(Core::Get()->GetLogicalDevice(), 1, &_frameSyncObjects[i].renderFence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+    }
+    _completedFrameNumber = std::max(_completedFrameNumber, frameNumber);
+}
+
 void Renderer::UpdateDescriptorSet(VkDescriptorSet descriptorSet, const std::vector<UpdateDescriptorSetInfo>& updateInfo)
 {
     std::vector<VkWriteDescriptorSet> writeDescriptoSet(updateInfo.size());
@@ -165,6 +380,12 @@ void Renderer::CmdDraw(VkCommandBuffer cmd, VkBuffer buffer, uint32_t vertexCoun
 
 void Renderer::SaveScreenshot(const std::string& path)
 {
+	if (!_swapchain)
+	{
+		Logger::PrintError("Screenshots need a swapchain, read back the offscreen image instead!");
+		return;
+	}
+
 	bool screenshotSaved = false;
 	bool supportsBlit = true;
 
@@ -512,6 +733,7 @@ Renderer::~Renderer()
     {
         vkDestroySemaphore(Core::Get()->GetLogicalDevice(), _frameSyncObjects[i].renderSemaphore, nullptr);
         vkDestroySemaphore(Core::Get()->GetLogicalDevice(), _frameSyncObjects[i].presentSemaphore, nullptr);
+        vkDestroySemaphore(Core::Get()->GetLogicalDevice(), _frameSyncObjects[i].computeSemaphore, nullptr);
         vkDestroyFence(Core::Get()->GetLogicalDevice(), _frameSyncObjects[i].renderFence, nullptr);
     }
 }
\ No newline at end of file
@@ -9,16 +9,40 @@ class DescriptorSetCache;
 class Renderer
 {
 public:
-	Renderer(GLFWwindow* window, uint32_t imagesCount, VkPresentModeKHR preferredMode);
+	/* Without a window the renderer is headless, there is no	*/
+	/* swapchain and GetSwapchain returns nullptr				*/
+	/* deviceIndex is passed on to Core						*/
+	Renderer(GLFWwindow* window, uint32_t imagesCount, VkPresentModeKHR preferredMode, bool asyncCompute = false, int32_t deviceIndex = -1);
 	~Renderer();
 
 	VkCommandBuffer BeginFrame();
 	void EndFrame();
 
+	/* Command buffer for compute work of the current frame		*/
+	/* Same as the frame command buffer without async compute	*/
+	VkCommandBuffer GetComputeCommandBuffer();
+	/* Submits the compute work early so it can start while	*/
+	/* the graphics work is still being recorded				*/
+	void SubmitCompute();
+	/* Hands an image written by compute over to graphics		*/
+	void CmdComputeToGraphics(VkImage image);
+	/* Returns the image to compute after graphics sampled it,	*/
+	/* compute acquires it the next time the frame slot is used	*/
+	/* so images graphics reads need one copy per frame in flight	*/
+	void CmdGraphicsToCompute(VkImage image);
+	bool IsAsyncCompute() { return _asyncCompute; }
+	/* Family the compute command buffers record for			*/
+	uint32_t GetComputeQueueFamilyIndex();
+
 	Swapchain* GetSwapchain() { return _swapchain.get(); }
 	DescriptorSetCache* GetDescriptorSetCache() { return _descriptorSetCache.get(); }
 
 	uint32_t GetFrameIndex() { return _frameIndex; }
+	/* Number of the frame being recorded, counts up from 1	*/
+	uint64_t GetFrameNumber() { return _frameNumber; }
+	/* Does not wait, true once the frame's submit finished	*/
+	bool IsFrameComplete(uint64_t frameNumber);
+	void WaitForFrame(uint64_t frameNumber);
 	uint32_t GetImageCount() { return _imageCount; }
 	uint32_t GetInFlightImageCount() { return _inFlightImageCount; }
 
@@ -37,12 +61,21 @@ public:
 		uint32_t drawCalls;
 		uint32_t vertices;
 		uint32_t triangles;
+		/* Filled in from RayCounters when the path tracer is	*/
+		/* instrumented, totals since the counters were reset	*/
+		uint64_t primaryRays;
+		uint64_t secondaryRays;
+		uint64_t triangleTests;
+		uint64_t boxTests;
+		uint64_t sphereTests;
+		double raysPerSecond;
 	} renderStatistics;
 	void CmdBindPipeline(VkCommandBuffer cmd, VkPipeline pipeline, PipelineBindPoint bindPoint);
 	void CmdDraw(VkCommandBuffer cmd, VkBuffer buffer, uint32_t vertexCount);
 
 	void SaveScreenshot(const std::string& path);
 
+	/* The renderer created on the calling thread			*/
 	static Renderer* Get() { return _rendererInstance; }
 private:
 
@@ -57,13 +90,22 @@ private:
 	{
 		VkSemaphore	presentSemaphore;
 		VkSemaphore	renderSemaphore;
+		VkSemaphore	computeSemaphore;
 		VkFence	renderFence;
 	};
 	std::vector<FrameSyncObjects> _frameSyncObjects;
+	std::vector<uint64_t> _submittedFrameNumbers;
 	std::vector<VkCommandBuffer> _commandBuffers;
+	std::vector<VkCommandBuffer> _computeCommandBuffers;
+	/* Images graphics released, per frame slot				*/
+	std::vector<std::vector<VkImage>> _pendingComputeImages;
+	bool _asyncCompute;
+	bool _computeSubmitted;
 	uint32_t _frameIndex;
+	uint64_t _frameNumber;
+	uint64_t _completedFrameNumber;
 	uint32_t _imageCount;
 	uint32_t _inFlightImageCount;
 
-	static Renderer* _rendererInstance;
+	static thread_local Renderer* _rendererInstance;
 };
\ No newline at end of file
@@ -4,10 +4,10 @@
 #include <iostream>
 #include <mutex>
 
-Shader::Shader(const std::string& filename)
+Shader::Shader(const std::string& filename, const std::vector<std::string>& defines)
 {
 	_shaderModule = nullptr;
-	Reload(filename);
+	Reload(filename, defines);
 }
 
 Shader::~Shader()
@@ -15,7 +15,7 @@ Shader::~Shader()
 	vkDestroyShaderModule(Core::Get()->GetLogicalDevice(), _shaderModule, nullptr);
 }
 
-void Shader::Reload(const std::string& filename)
+void Shader::Reload(const std::string& filename, const std::vector<std::string>& defines)
 {
 	//std::vector<uint32_t> bytecode = GetBytecode(filename);
 	//auto shaderModuleCreateInfo = vk::ShaderModuleCreateInfo()
@@ -50,8 +50,12 @@ void Shader::Reload(const std::string& filename)
 		shaderStage = VK_SHADER_STAGE_COMPUTE_BIT;
 
 	//SpirvHelper::Init();
+	std::string preamble;
+	for (const std::string& define : defines)
+		preamble += "#define " + define + "\n";
+
 	std::vector<uint32_t> SpirV;
-	bool success = SpirvHelper::GLSLtoSPV(shaderStage, result.c_str(), SpirV);
+	bool success = SpirvHelper::GLSLtoSPV(shaderStage, result.c_str(), SpirV, preamble.c_str());
 	//SpirvHelper::Finalize();
 
 	//spirv_cross::Compiler compiler(SpirV);
@@ -4,10 +4,12 @@
 class Shader
 {
 public:
-    Shader(const std::string& filename);
+    /* Every define is added as "#define <define>" after the	*/
+    /* #version line, "NAME VALUE" gives it a value			*/
+    Shader(const std::string& filename, const std::vector<std::string>& defines = {});
     ~Shader();
 
-    void Reload(const std::string& filename);
+    void Reload(const std::string& filename, const std::vector<std::string>& defines = {});
 
     VkShaderModule GetShaderModule() { return _shaderModule; };
     VkPipelineShaderStageCreateInfo GetShaderStage() { return _shaderStage; }
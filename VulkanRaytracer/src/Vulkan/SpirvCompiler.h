@@ -161,7 +161,8 @@ struct SpirvHelper
 		}
 	}
 
-	static bool GLSLtoSPV(const VkShaderStageFlagBits shader_type, const char* pshader, std::vector<unsigned int>& spirv) {
+	/* The preamble is inserted after the #version line		*/
+	static bool GLSLtoSPV(const VkShaderStageFlagBits shader_type, const char* pshader, std::vector<unsigned int>& spirv, const char* preamble = "") {
 		EShLanguage stage = FindLanguage(shader_type);
 		glslang::TShader shader(stage);
 		glslang::TProgram program;
@@ -174,6 +175,11 @@ struct SpirvHelper
 
 		shaderStrings[0] = pshader;
 		shader.setStrings(shaderStrings, 1);
+		shader.setPreamble(preamble);
+		// Vulkan 1.1 and SPIR-V 1.3 for subgroup operations
+		shader.setEnvInput(glslang::EShSourceGlsl, stage, glslang::EShClientVulkan, 100);
+		shader.setEnvClient(glslang::EShClientVulkan, glslang::EShTargetVulkan_1_1);
+		shader.setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_3);
 
 		if (!shader.parse(&Resources, 100, false, messages)) {
 			puts(shader.getInfoLog());
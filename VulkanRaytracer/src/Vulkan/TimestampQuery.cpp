@@ -0,0 +1,58 @@
+#include "TimestampQuery.h"
+
+TimestampQuery::TimestampQuery(uint32_t frameCount, uint32_t queueFamilyIndex)
+{
+    _written.resize(frameCount, false);
+    _timestampPeriod = Core::Get()->GetPhysicalDeviceProperties().limits.timestampPeriod;
+    _validBits = Core::Get()->GetTimestampValidBits(queueFamilyIndex);
+
+    VkQueryPoolCreateInfo queryPoolCreateInfo{};
+    queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCreateInfo.pNext = nullptr;
+    queryPoolCreateInfo.flags = 0;
+    queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCreateInfo.queryCount = frameCount * 2;
+
+    VkResult err = vkCreateQueryPool(Core::Get()->GetLogicalDevice(), &queryPoolCreateInfo, nullptr, &_queryPool);
+    Logger::PrintFatalIf(err != VK_SUCCESS, "Failed to create time query pool!");
+    vkResetQueryPool(Core::Get()->GetLogicalDevice(), _queryPool, 0, frameCount * 2);
+}
+
+TimestampQuery::~TimestampQuery()
+{
+    vkDestroyQueryPool(Core::Get()->GetLogicalDevice(), _queryPool, nullptr);
+}
+
+void TimestampQuery::CmdBegin(VkCommandBuffer cmd, uint32_t frameIndex)
+{
+    if (!IsSupported())
+        return;
+    vkCmdResetQueryPool(cmd, _queryPool, frameIndex * 2, 2);
+    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _queryPool, frameIndex * 2);
+}
+
+void TimestampQuery::CmdEnd(VkCommandBuffer cmd, uint32_t frameIndex)
+{
+    if (!IsSupported())
+        return;
+    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _queryPool, frameIndex * 2 + 1);
+    _written[frameIndex] = true;
+}
+
+bool TimestampQuery::GetResult(uint32_t frameIndex, double& milliseconds)
+{
+    if (!_written[frameIndex])
+        return false;
+
+    uint64_t buffer[2];
+    VkResult result = vkGetQueryPoolResults(Core::Get()->GetLogicalDevice(), _queryPool, frameIndex * 2, 2, sizeof(uint64_t) * 2, buffer, sizeof(uint64_t),
+        VK_QUERY_RESULT_64_BIT);
+    if (result != VK_SUCCESS)
+        return false;
+
+    // Only the valid bits count, the difference stays right when the counter wraps between the two
+    uint64_t mask = _validBits >= 64 ? ~0ull : (1ull << _validBits) - 1;
+    milliseconds = ((buffer[1] - buffer[0]) & mask) * (_timestampPeriod / 1e6);
+    _written[frameIndex] = false;
+    return true;
+}
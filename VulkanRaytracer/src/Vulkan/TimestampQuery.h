@@ -0,0 +1,28 @@
+#pragma once
+#include "VKHeaders.h"
+
+class TimestampQuery
+{
+public:
+	/* The queries are written on queues of queueFamilyIndex	*/
+	TimestampQuery(uint32_t frameCount, uint32_t queueFamilyIndex);
+	~TimestampQuery();
+
+	/* False if the family has no timestamps, recording is		*/
+	/* skipped then and GetResult never has one				*/
+	bool IsSupported() { return _validBits > 0; }
+
+	void CmdBegin(VkCommandBuffer cmd, uint32_t frameIndex);
+	void CmdEnd(VkCommandBuffer cmd, uint32_t frameIndex);
+
+	/* Does not wait for the GPU							*/
+	/* Returns false if the frame has no result yet			*/
+	bool GetResult(uint32_t frameIndex, double& milliseconds);
+
+private:
+
+	VkQueryPool _queryPool;
+	std::vector<bool> _written;
+	double _timestampPeriod;
+	uint32_t _validBits;
+};
@@ -1,6 +1,8 @@
 #pragma once
 
+#ifdef _WIN32
 #define VK_USE_PLATFORM_WIN32_KHR
+#endif
 #define NOMINMAX
 
 #include <vulkan/vulkan.h>
@@ -36,4 +38,7 @@
 #include "Buffer.h"
 #include "Image.h"
 #include "DescriptorSetCache.h"
+#include "TimestampQuery.h"
+#include "GpuProfiler.h"
+#include "ImageReadback.h"
 #include "SpirvCompiler.h"
@@ -2,13 +2,185 @@
 #include <iostream>
 #include "Camera/CameraFPS.h"
 #include <future>
+#include <algorithm>
 #include "Audio/AudioEngine.h"
 #include "ModelLoader.h"
 #include "Helper.h"
 #include "ImGuiWrapper.h"
+#include "PathTracer.h"
+#include "Scene.h"
+#include "HdrResolve.h"
+#include "Denoiser.h"
+#include "RenderFarm.h"
+#include "MultiDevice.h"
+#include "Regression.h"
+#include "RayCounters.h"
+#include "Benchmark.h"
+#include "Batch.h"
+#include "Camera/CameraPath.h"
+#include <cstdlib>
+#include <chrono>
+#include <cmath>
 #include "../dependencies/stb/stb_image_write.h"
 
-int main()
+static void PrintUsage()
+{
+    std::cout << "Usage: VulkanRaytracer [--render [options]]" << std::endl
+        << "  --render              render headless to an image and exit" << std::endl
+        << "  --scene <file>        scene description, the default scene if omitted" << std::endl
+        << "  --width <pixels>      default 1280" << std::endl
+        << "  --height <pixels>     default 720" << std::endl
+        << "  --spp <samples>       target samples per pixel" << std::endl
+        << "  --time <seconds>      time budget, stops at whichever limit comes first" << std::endl
+        << "  --output <file>       .png, linear .exr or .pfm, default output.png" << std::endl
+        << "  --half                half float channels for .exr" << std::endl
+        << "  --cpu                 render with the CPU reference path tracer" << std::endl
+        << "  --threads <count>     CPU threads, all hardware threads by default" << std::endl
+        << "  --profile <file>      GPU timings per scope as .csv or Chrome trace .json" << std::endl
+        << "  --ray-stats <file>    count rays, intersection tests and path lengths with the" << std::endl
+        << "                        slower instrumented shader and write them as .csv" << std::endl
+        << "  --timeline <file>     render an animation at --spp per frame, the output is" << std::endl
+        << "                        a .y4m stream or numbered images (out.png -> out_00000.png)" << std::endl
+        << "  --coordinator <port>  split the image into jobs for worker processes" << std::endl
+        << "  --farm-local <count>  start count workers on this machine, port 47000 by default" << std::endl
+        << "  --tile <pixels>       tile size of a job, default 256" << std::endl
+        << "  --job-spp <samples>   samples per job, all samples of a tile by default" << std::endl
+        << "  --devices <list>      render on several devices, all or indices like 0,1 or 0,0" << std::endl
+        << "  --merge-device <n>    position in --devices of the device that merges, default 0" << std::endl
+        << "Usage: VulkanRaytracer [--instrument]" << std::endl
+        << "  interactive window, --instrument shows ray statistics in the P window" << std::endl
+        << "Usage: VulkanRaytracer --benchmark <camera path> [--scene <file>] [--width <pixels>] [--height <pixels>]" << std::endl
+        << "                       [--dispatches <per frame>] [--warmup <frames>] [--output <file.json>]" << std::endl
+        << "  replays a path recorded with R in the window and writes frame time statistics" << std::endl
+        << "Usage: VulkanRaytracer --regression <directory> [--update-references] [--cpu] [--threads <count>] [--bsdf-only]" << std::endl
+        << "                       [--sampler pcg|sobol] [--adaptive <target rmse>]" << std::endl
+        << "  renders the scenes of <directory>/regression.txt and compares them to the references," << std::endl
+        << "  --bsdf-only turns off light sampling to compare the time to the target rmse," << std::endl
+        << "  --sampler replaces the sampler of every scene to compare the samples to the target rmse," << std::endl
+        << "  --adaptive replaces the adaptive sampling target of every scene, 0 samples every pixel" << std::endl
+        << "Usage: VulkanRaytracer --worker <host:port>" << std::endl
+        << "  renders jobs of a coordinator, run it from a directory with the same res folder" << std::endl;
+}
+
+static bool ParseBenchmarkSettings(int argc, char** argv, BenchmarkSettings& settings)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            std::cout << "Missing value for " << arg << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+
+        try
+        {
+            if (arg == "--benchmark")
+                settings.cameraPath = value;
+            else if (arg == "--scene")
+                settings.scenePath = value;
+            else if (arg == "--output")
+                settings.outputPath = value;
+            else if (arg == "--width")
+                settings.extent.width = static_cast<uint32_t>(std::stoul(value));
+            else if (arg == "--height")
+                settings.extent.height = static_cast<uint32_t>(std::stoul(value));
+            else if (arg == "--dispatches")
+                settings.dispatchesPerFrame = static_cast<uint32_t>(std::stoul(value));
+            else if (arg == "--warmup")
+                settings.warmupFrames = static_cast<uint32_t>(std::stoul(value));
+            else
+            {
+                std::cout << "Unknown option " << arg << std::endl;
+                return false;
+            }
+        }
+        catch (const std::exception&)
+        {
+            std::cout << "Invalid value " << value << " for " << arg << std::endl;
+            return false;
+        }
+    }
+
+    if (settings.extent.width == 0 || settings.extent.height == 0 || settings.dispatchesPerFrame == 0)
+    {
+        std::cout << "Resolution and dispatches must not be zero" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static bool ParseRegressionSettings(int argc, char** argv, RegressionSettings& settings)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--update-references")
+        {
+            settings.updateReferences = true;
+            continue;
+        }
+        if (arg == "--cpu")
+        {
+            settings.cpu = true;
+            continue;
+        }
+        if (arg == "--bsdf-only")
+        {
+            settings.lightSampling = false;
+            continue;
+        }
+
+        if (i + 1 >= argc)
+        {
+            std::cout << "Missing value for " << arg << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+
+        try
+        {
+            if (arg == "--regression")
+                settings.directory = value;
+            else if (arg == "--threads")
+                settings.threadCount = static_cast<uint32_t>(std::stoul(value));
+            else if (arg == "--sampler")
+            {
+                if (!ParseSamplerType(value, settings.sampler))
+                {
+                    std::cout << "Unknown sampler " << value << ", expected pcg or sobol" << std::endl;
+                    return false;
+                }
+                settings.overrideSampler = true;
+            }
+            else if (arg == "--adaptive")
+            {
+                settings.adaptiveThreshold = std::stof(value);
+                settings.overrideAdaptive = true;
+            }
+            else
+            {
+                std::cout << "Unknown option " << arg << std::endl;
+                return false;
+            }
+        }
+        catch (const std::exception&)
+        {
+            std::cout << "Invalid value " << value << " for " << arg << std::endl;
+            return false;
+        }
+    }
+
+    if (settings.adaptiveThreshold < 0.0f)
+    {
+        std::cout << "The adaptive target must not be negative" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static int RunInteractive(bool instrument)
 {
 	glfwInit();
 	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
@@ -17,7 +189,7 @@ int main()
     //VkExtent2D windowExtent = { 1920, 1080 };
     //GLFWwindow* window = glfwCreateWindow(windowExtent.width, windowExtent.height, "Vulkan engine", glfwGetPrimaryMonitor(), nullptr);
 
-    std::unique_ptr<Renderer> renderer = std::make_unique<Renderer>(window, 2, VK_PRESENT_MODE_FIFO_KHR);
+    std::unique_ptr<Renderer> renderer = std::make_unique<Renderer>(window, 2, VK_PRESENT_MODE_FIFO_KHR, true);
 
     ImGuiInit(window);
 
@@ -25,6 +197,7 @@ int main()
         std::unique_ptr<Shader> presentVert;
         std::unique_ptr<Shader> presentFrag;
         std::unique_ptr<Shader> computeShader;
+        std::unique_ptr<Shader> resolveShader;
         SpirvHelper::Init();
         auto fut1 = std::async(std::launch::async, [&]() {
             presentVert = std::make_unique<Shader>("res/Shaders/present.vert");
@@ -32,29 +205,28 @@ int main()
         auto fut2 = std::async(std::launch::async, [&]() {
             presentFrag = std::make_unique<Shader>("res/Shaders/present.frag");
             });
+        std::vector<std::string> computeDefines = PathTracer::GetShaderDefines();
+        if (instrument)
+        {
+            std::vector<std::string> counterDefines = RayCounters::GetShaderDefines();
+            computeDefines.insert(computeDefines.end(), counterDefines.begin(), counterDefines.end());
+        }
         auto fut3 = std::async(std::launch::async, [&]() {
-            computeShader = std::make_unique<Shader>("res/Shaders/Raytracing.comp");
+            computeShader = std::make_unique<Shader>("res/Shaders/Raytracing.comp", computeDefines);
             });
         fut1.get();
         fut2.get();
+        auto fut4 = std::async(std::launch::async, [&]() {
+            resolveShader = std::make_unique<Shader>("res/Shaders/Resolve.comp");
+            });
         fut3.get();
+        fut4.get();
         SpirvHelper::Finalize();
 
-        RenderPass renderPass(
-            {
-                { VK_FORMAT_R32G32B32A32_SFLOAT, VK_ATTACHMENT_LOAD_OP_CLEAR },
-                { VK_FORMAT_B8G8R8A8_SRGB, VK_ATTACHMENT_LOAD_OP_CLEAR }
-            },
-            { VK_FORMAT_D32_SFLOAT, VK_ATTACHMENT_LOAD_OP_CLEAR /*VK_FORMAT_UNDEFINED*/ }
-        );
-        //VK_FORMAT_R32G32B32A32_SFLOAT
-
         DescriptorSetLayout layout({
             { 1, DescriptorType::CombinedImageSampler, ShaderStage::Fragment }
             });
 
-        VkDescriptorSet descriptor = renderer->AllocateDescriptorSet(layout.GetHandle());
-
         VertexAttributes emptyVertexAttributes({ }, 0);
 
         Pipeline presentPipeline(
@@ -71,168 +243,108 @@ int main()
             });
 
         Sampler linearSampler(Filter::Linear, Filter::Linear);
-        Image raytracingImage(windowExtent, Format::R8G8B8A8_UNORM, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
-        Image accumulationImage(windowExtent, Format::R32G32B32A32_Sfloat, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
-
-        //void* d = LoadImageFromFile("res/Image/test.jpg");
-        uint32_t* d = new uint32_t[4 * windowExtent.width * windowExtent.height];
-        memset(d, 0, 4 * windowExtent.width * windowExtent.height);
-        raytracingImage.SetData(d, 4 * windowExtent.width * windowExtent.height, ImageLayout::General);
-        accumulationImage.SetData(d, 4 * 4 * windowExtent.width * windowExtent.height, ImageLayout::General);
-        delete[] d;
-        //ReleaseImageData(d);
-
-        renderer->UpdateDescriptorSet(descriptor, {
-            { 0, DescriptorType::CombinedImageSampler, {}, {linearSampler.GetHandle(), raytracingImage.GetImageView(), VK_IMAGE_LAYOUT_GENERAL }}
-            });
 
-        DescriptorSetLayout computeLayout({
-            { 1, DescriptorType::UniformBuffer, ShaderStage::Compute },
-            { 1, DescriptorType::StorageBuffer, ShaderStage::Compute },
-            { 1, DescriptorType::StorageBuffer, ShaderStage::Compute },
-            { 1, DescriptorType::StorageBuffer, ShaderStage::Compute },
-            { 1, DescriptorType::StorageImage, ShaderStage::Compute },
-            { 1, DescriptorType::StorageImage, ShaderStage::Compute },
-            });
+        PathTracer pathTracer(windowExtent, computeShader->GetShaderStage());
+        FrameData& frameData = pathTracer.frameData;
+        Scene scene = CreateDefaultScene();
+        SetSceneFrameData(scene, windowExtent, frameData);
 
-        VkDescriptorSet computeDescriptor = renderer->AllocateDescriptorSet(computeLayout.GetHandle());
-        ComputePipeline computePipeline({ 
-            computeShader->GetShaderStage(),
-            computeLayout.GetHandle(),
-            renderPass.GetHandle()
-            });
+        pathTracer.SetScene(scene.spheres, scene.triangles, scene.meshes);
 
-        FrameData frameData;
-        glm::vec3 position = { 4.0 * cos(0.0), 1.5, 4.0 * sin(0.0) };
-        glm::vec3 forward = glm::normalize(-position);
-        frameData.cameraInverseProjection = glm::inverse(glm::perspectiveFov(70.0f, (float)windowExtent.width, (float)windowExtent.height, 0.1f, 1000.0f));
-        //frameData.cameraInverseView = glm::inverse(glm::lookAtLH({ 0, 0, 0 }, glm::vec3{ 4.0, 1.5, 0.0 }, { 0.0, 1.0, 0.0 }));
-        frameData.cameraInverseView = glm::inverse(glm::lookAtLH({ 0, 0, 0 }, position, { 0.0, 1.0, 0.0 }));
-        frameData.cameraPos = glm::vec4(position.x, position.y, position.z, 0);
-        //frameData.cameraPos = glm::vec4( 4.0, 1.5, 0.0, 0.0 );
-        frameData.cameraDirection = glm::vec4(forward.x, forward.y, forward.z, 0);
-        //frameData.cameraDirection = glm::normalize(-frameData.cameraPos);
-
-        frameData.window.x = windowExtent.width;
-        frameData.window.y = windowExtent.height;
-        frameData.raysPerPixel = 4;
-        frameData.maxBouceLimit = 6;
-        frameData.frameIndex = 0;
-        frameData.sunLightDirection = glm::vec4(-0.4, -0.4, -0.4, 0.0);
-        frameData.sunFocus = 1.0f;
-        frameData.sunIntensity = 1.0f;
-
-        std::vector<glm::vec4> skyHorizonColors =
-        {
-            {0.7, 0.3, 0.1, 0.0},
-            {0.93, 0.227, 0.177, 0.0},
-            {0.0, 0.0, 0.0, 0.0},
-            {0.93, 0.227, 0.177, 0.0},
-            {0.7, 0.3, 0.1, 0.0},
-        };
-        std::vector<glm::vec4> skyZenithColors =
+        // Counts since startup, the rate is updated about once a second
+        std::unique_ptr<RayCounters> rayCounters;
+        if (instrument)
         {
-            {0.2, 0.56, 0.95, 0.0},
-            {0.0, 0.0, 0.0, 0.0},
-            {0.2, 0.56, 0.95, 0.0},
-        };
-        std::vector<glm::vec4> groundColors =
-        {
-            {1.0, 1.0, 1.0, 0.0},
-            {0.3, 0.3, 0.3, 0.0},
-            {0.0, 0.0, 0.0, 0.0},
-            {0.3, 0.3, 0.3, 0.0},
-            {1.0, 1.0, 1.0, 0.0}
-        };
-
-        //frameData.skyColorHorizon = LerpM(skyHorizonColors, 0.0);
-        //frameData.skyColorZenith = LerpM(skyZenithColors, 0.0);
-        //frameData.groundColor = LerpM(groundColors, 0.0);
-        frameData.skyColorHorizon = { 0.7, 0.3, 0.1, 0.0 };
-        frameData.skyColorZenith = { 0.2, 0.56, 0.95, 0.0 };
-        frameData.groundColor = { 0.9, 0.9, 0.9, 0.0 };
-
-        Buffer computeFrameBuffer(sizeof(FrameData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-        void* copyData = computeFrameBuffer.Map();
-        memcpy(copyData, &frameData, static_cast<size_t>(sizeof(FrameData)));
-        computeFrameBuffer.Unmap();
-
-        
-        std::vector<Sphere> spheres;
-        Sphere s;
-        s.center = { 1, 1, 0 };
-        s.radius = 0.5;
-        s.material = { { 1, 1, 1 }, 0, 0.1 };
-        spheres.push_back(s);
-
-
-        frameData.sphereNumber = spheres.size();
-
-        Buffer sphereBuffer(sizeof(Sphere) * spheres.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-        
-        if (spheres.size() > 0)
-        {
-            copyData = sphereBuffer.Map();
-            memcpy(copyData, spheres.data(), static_cast<size_t>(sizeof(Sphere) * spheres.size()));
-            sphereBuffer.Unmap();
+            rayCounters = std::make_unique<RayCounters>(renderer->GetInFlightImageCount());
+            pathTracer.SetCounterBuffer(rayCounters->GetBuffer());
         }
-
-
-        std::vector<Triangle> triangles;
-        std::vector<Mesh> meshes;
-
-        LoadModel("res/Meshes/plane.obj", triangles, meshes,  { {1, 1, 1}, 0, 0.8 }, { 0, 0, 0 }, { 2, 1, 2 });
-        LoadModel("res/Meshes/cube.obj", triangles, meshes, { {0.9, 0.9, 0.9}, 0, 0.1 }, { -1, 1, 0 });
-
-        frameData.meshNumber = meshes.size();
-        Buffer triangleBuffer(sizeof(Triangle) * (triangles.size() + 1), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-        Buffer meshBuffer(sizeof(Mesh) * (meshes.size() + 1), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-        if (meshes.size() > 0)
+        uint64_t rateRays = 0;
+        auto rateTime = std::chrono::high_resolution_clock::now();
+
+        // Graphics presents and reads back a copy of the output image per frame in flight, so with async
+        // compute the dispatches of the next frame overlap the present pass of this one instead of waiting
+        // for graphics to hand the output image back
+        std::vector<std::unique_ptr<Image>> presentImages(renderer->GetInFlightImageCount());
+        std::vector<VkDescriptorSet> descriptors(renderer->GetInFlightImageCount());
+        std::vector<uint8_t> blackImage(4 * windowExtent.width * windowExtent.height, 0);
+        for (uint32_t i = 0; i < presentImages.size(); i++)
         {
-            copyData = triangleBuffer.Map();
-            memcpy(copyData, triangles.data(), static_cast<size_t>(sizeof(Triangle) * triangles.size()));
-            triangleBuffer.Unmap();
-
-            copyData = meshBuffer.Map();
-            memcpy(copyData, meshes.data(), static_cast<size_t>(sizeof(Mesh) * meshes.size()));
-            meshBuffer.Unmap();
+            presentImages[i] = std::make_unique<Image>(windowExtent, Format::R8G8B8A8_UNORM,
+                VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+            presentImages[i]->SetData(blackImage.data(), static_cast<uint32_t>(blackImage.size()), ImageLayout::General);
+            descriptors[i] = renderer->AllocateDescriptorSet(layout.GetHandle());
+            renderer->UpdateDescriptorSet(descriptors[i], {
+                { 0, DescriptorType::CombinedImageSampler, {}, {linearSampler.GetHandle(), presentImages[i]->GetImageView(), VK_IMAGE_LAYOUT_GENERAL }}
+                });
         }
-        renderer->UpdateDescriptorSet(computeDescriptor, {
-            { 0, DescriptorType::UniformBuffer, {computeFrameBuffer.GetHandle(), 0, sizeof(FrameData)}, {}},
-            { 1, DescriptorType::StorageBuffer, {sphereBuffer.GetHandle(), 0, sizeof(Sphere) * spheres.size()}, {}},
-            { 2, DescriptorType::StorageBuffer, {triangleBuffer.GetHandle(), 0, sizeof(Triangle) * triangles.size()}, {}},
-            { 3, DescriptorType::StorageBuffer, {meshBuffer.GetHandle(), 0, sizeof(Mesh) * meshes.size()}, {}},
-            { 4, DescriptorType::StorageImage, {}, {linearSampler.GetHandle(), raytracingImage.GetImageView(), VK_IMAGE_LAYOUT_GENERAL}},
-            { 5, DescriptorType::StorageImage, {}, {linearSampler.GetHandle(), accumulationImage.GetImageView(), VK_IMAGE_LAYOUT_GENERAL}},
-            });
 
         CameraFPS camera(window);
 
-        /*
-        VkQueryPool queryPool;
-        VkQueryPoolCreateInfo queryPoolCreateInfo{};
-        queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
-        queryPoolCreateInfo.pNext = nullptr; // Optional
-        queryPoolCreateInfo.flags = 0; // Reserved for future use, must be 0!
-
-        queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
-        queryPoolCreateInfo.queryCount = 1 * 2; // REVIEW
-
-        VkResult result = vkCreateQueryPool(Core::Get()->GetLogicalDevice(), &queryPoolCreateInfo, nullptr, &queryPool);
-        if (result != VK_SUCCESS)
-        {
-            throw std::runtime_error("Failed to create time query pool!");
-        }
-        vkResetQueryPool(Core::Get()->GetLogicalDevice(), queryPool, 0, 2);
-        */
+        // Accumulation is decoupled from the display rate, every presented frame records as many
+        // dispatches as fit into the GPU time budget measured with timestamps of earlier frames
+        // Without timestamps on the compute queue every frame records a single dispatch
+        TimestampQuery accumulationTimer(renderer->GetInFlightImageCount(), renderer->GetComputeQueueFamilyIndex());
+        bool adaptiveAccumulation = accumulationTimer.IsSupported();
+        Logger::PrintInfoIf(!adaptiveAccumulation, "Compute queue has no timestamps, one accumulation dispatch per frame");
+        double accumulationBudgetMs = 14.0;
+        uint32_t maxAccumulationDispatches = 64;
+        uint32_t accumulationDispatches = 1;
+        bool resetAccumulation = false;
+
+        // V steps through the debug heatmaps, [ and ] halve and double the value at the top of the scale
+        const char* debugViewNames[] = { "off", "traversal tests per sample", "rays per sample", "cycles per pixel" };
+        bool debugViewKeyDown = false;
+        bool debugScaleKeyDown = false;
+
+        // N toggles the denoiser, it filters the output image while no debug view is shown
+        Denoiser denoiser(pathTracer.GetAccumulationImage(), pathTracer.GetOutputImage(), pathTracer.GetStatisticsImage(),
+            pathTracer.GetFeatureImage(), pathTracer.GetAlbedoImage(), renderer->GetInFlightImageCount());
+        bool denoiseKeyDown = false;
+
+        // H toggles reprojection, camera motion then keeps up to maxHistory dispatches of every pixel
+        // whose surface stays in view instead of restarting the accumulation
+        bool reprojection = true;
+        const uint32_t maxHistory = 32;
+        bool reprojectionKeyDown = false;
+        uint32_t recordedDispatches = 0;
+
+        // L toggles the preview, while the camera moves and a full resolution dispatch would not fit the
+        // accumulation budget a dispatch traces one pixel per previewScale^2 block and the next ones of
+        // the frame interleave the rest. Once the camera stops the dispatches trace every pixel again
+        bool preview = true;
+        const uint32_t maxPreviewScale = 4;
+        bool previewKeyDown = false;
+        double fullDispatchMs = 0.0;
+
+        // R starts and stops recording the camera, T plays the recording back frame by frame
+        const std::string cameraPathFile = "CameraPaths/recorded.camera";
+        CameraPath cameraPath;
+        bool recordingCamera = false;
+        bool playingCamera = false;
+        uint32_t playbackFrame = 0;
+        float recordingTime = 0.0f;
+        bool cameraKeyDown = false;
+
+        // P toggles the profiler window, its results arrive once a frame slot comes around again
+        GpuProfiler profiler(renderer->GetInFlightImageCount());
+        bool showProfiler = false;
+        bool profilerKeyDown = false;
+
+        // 2 saves a screenshot, 3 toggles capturing every presented frame, pngs are encoded off the render thread
+        ImageReadback readback(windowExtent, 4, 2 * renderer->GetInFlightImageCount() + 2, std::max(std::thread::hardware_concurrency() / 2, 1u));
+        // 4 saves the linear accumulated image as half float exr
+        HdrResolve hdrResolve(pathTracer.GetAccumulationImage(), resolveShader->GetShaderStage(), true);
+        ImageReadback hdrReadback(windowExtent, hdrResolve.GetBytesPerPixel(), 2);
+        bool hdrScreenshotRequested = false;
+        std::filesystem::create_directories("Screenshot");
+        bool screenshotRequested = false;
+        bool captureSequence = false;
+        bool captureKeyDown = false;
+        uint32_t capturedFrames = 0;
+        uint32_t droppedFrames = 0;
 
         auto startTime = std::chrono::high_resolution_clock::now();
 
-        auto frameStartTime = startTime;
-        uint32_t frameIndex = 1;
-        uint32_t timePerFrame = 10.0;
-        uint32_t maxFrames = 16;
         while (!glfwWindowShouldClose(window))
         {
             //std::this_thread::sleep_for(std::chrono::milliseconds(4));
@@ -254,52 +366,6 @@ int main()
             double deltaTime = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
             startTime = currentTime;
 
-            /*
-            if (std::chrono::duration<float, std::chrono::seconds::period>(currentTime - frameStartTime).count() > timePerFrame)
-            {
-                if (frameIndex <= maxFrames)
-                {
-                    Core::Get()->WaitIdle();
-
-                    //Renderer::Get()->SaveScreenshot("Video-/" + std::to_string(frameIndex) + ".png");
-                    frameIndex++;
-
-
-                    float ratio = (float)frameIndex / (float)maxFrames;
-                    float reverse = (1.0f - ratio);
-                    glm::vec3 position = {4.0 * cos(6.283185 * reverse), 1.5, 4.0 * sin(6.283185 * reverse) };
-                    glm::vec3 forward = glm::normalize(-position);
-
-                    frameData.maxBouceLimit = frameIndex;
-                    //frameData.cameraInverseProjection = glm::inverse(glm::perspectiveFov(70.0f, (float)windowExtent.width, (float)windowExtent.height, 0.1f, 1000.0f));
-                    //frameData.cameraInverseView = glm::inverse(glm::lookAtLH({0, 0, 0}, position, {0.0, 1.0, 0.0}));
-                    //frameData.cameraPos = glm::vec4(position.x, position.y, position.z, 0);
-                    //frameData.cameraDirection = glm::vec4(forward.x, forward.y, forward.z, 0);
-
-                    //frameData.skyColorZenith = glm::lerp(glm::vec4(0.2, 0.56, 0.95, 0.0), glm::vec4(0.0, 0.0, 0.0, 0.0), ratio);
-                    //frameData.skyColorHorizon = LerpM(skyHorizonColors, ratio);
-                    //frameData.skyColorZenith = LerpM(skyZenithColors, ratio);
-                    //frameData.groundColor = LerpM(groundColors, ratio);
-                    //frameData.sunIntensity = LerpM({1.0, 0.0, 1.0}, ratio);
-                    frameData.frameIndex = 0;
-
-                    //spheres[0].center = { 2 * cos(9 * 6.283185 * ratio), 2, 2 * sin(9 * 6.283185 * ratio) };
-                    //spheres[0].radius = 0.5;
-                    //spheres[0].material = { { 0.8, 0.6, 0.6 }, 1.0, 0.8 };
-                    //spheres[1].center = { 0, 1, 1 };
-                    //spheres[1].radius = 0.5;
-                    //spheres[1].material = { { 0.6, 0.8, 0.6 }, 0, 0.8 };
-                    //spheres[2].center = { 2, 1, 1 };
-                    //spheres[2].radius = 0.5;
-                    //spheres[2].material = { { 0.6, 0.6, 0.8 }, 1.0, 0.8 };
-
-                    copyData = sphereBuffer.Map();
-                    memcpy(copyData, spheres.data(), static_cast<size_t>(sizeof(Sphere) * spheres.size()));
-                    sphereBuffer.Unmap();
-
-                }
-                frameStartTime = std::chrono::high_resolution_clock::now();
-            }*/
 
             //std::cout << "Draw calls: " << renderer->renderStatistics.drawCalls << " "
             //    << "Vertices: " << renderer->renderStatistics.vertices << std::endl;
@@ -326,16 +392,136 @@ int main()
             }
             if (glfwGetKey(window, GLFW_KEY_2))
             {
-                Core::Get()->WaitIdle();
-                Renderer::Get()->SaveScreenshot("Screenshot/test.png");
+                screenshotRequested = true;
+            }
+            if (glfwGetKey(window, GLFW_KEY_4))
+            {
+                hdrScreenshotRequested = true;
             }
+            if (glfwGetKey(window, GLFW_KEY_3) && !captureKeyDown)
+            {
+                captureSequence = !captureSequence;
+                if (captureSequence)
+                    std::filesystem::create_directories("Capture");
+                else
+                    std::cout << "Captured " << capturedFrames << " frames, dropped " << droppedFrames << std::endl;
+                capturedFrames = 0;
+                droppedFrames = 0;
+            }
+            captureKeyDown = glfwGetKey(window, GLFW_KEY_3);
+            if (glfwGetKey(window, GLFW_KEY_P) && !profilerKeyDown)
+                showProfiler = !showProfiler;
+            profilerKeyDown = glfwGetKey(window, GLFW_KEY_P);
+            if (glfwGetKey(window, GLFW_KEY_V) && !debugViewKeyDown)
+            {
+                // Default scales put the whole scene or every bounce at the top
+                uint32_t view = static_cast<uint32_t>(pathTracer.GetDebugView());
+                view = (view + 1) % static_cast<uint32_t>(PathTracer::DebugView::Count);
+                float scales[] = { 1.0f, static_cast<float>(frameData.sphereNumber + frameData.meshNumber + scene.triangles.size()),
+                    static_cast<float>(std::max(frameData.maxBouceLimit, 1u)), 1e6f };
+                if (!pathTracer.SetDebugView(static_cast<PathTracer::DebugView>(view), scales[view]))
+                    pathTracer.SetDebugView(PathTracer::DebugView::None, 1.0f);
+                std::cout << "Debug view: " << debugViewNames[static_cast<uint32_t>(pathTracer.GetDebugView())]
+                    << ", scale " << pathTracer.GetDebugScale() << std::endl;
+                resetAccumulation = true;
+            }
+            debugViewKeyDown = glfwGetKey(window, GLFW_KEY_V);
+            if (glfwGetKey(window, GLFW_KEY_N) && !denoiseKeyDown)
+            {
+                // The statistics it reads are only kept from the next reset on
+                frameData.denoise = frameData.denoise ? 0 : 1;
+                std::cout << "Denoiser " << (frameData.denoise ? "on" : "off") << std::endl;
+                resetAccumulation = true;
+            }
+            denoiseKeyDown = glfwGetKey(window, GLFW_KEY_N);
+            if (glfwGetKey(window, GLFW_KEY_H) && !reprojectionKeyDown)
+            {
+                reprojection = !reprojection;
+                std::cout << "Reprojection " << (reprojection ? "on" : "off") << std::endl;
+            }
+            reprojectionKeyDown = glfwGetKey(window, GLFW_KEY_H);
+            if (glfwGetKey(window, GLFW_KEY_L) && !previewKeyDown)
+            {
+                preview = !preview;
+                std::cout << "Preview " << (preview ? "on" : "off") << std::endl;
+            }
+            previewKeyDown = glfwGetKey(window, GLFW_KEY_L);
+            bool scaleDown = glfwGetKey(window, GLFW_KEY_LEFT_BRACKET);
+            bool scaleUp = glfwGetKey(window, GLFW_KEY_RIGHT_BRACKET);
+            if ((scaleDown || scaleUp) && !debugScaleKeyDown && pathTracer.GetDebugView() != PathTracer::DebugView::None)
+            {
+                pathTracer.SetDebugView(pathTracer.GetDebugView(), pathTracer.GetDebugScale() * (scaleUp ? 2.0f : 0.5f));
+                std::cout << "Debug view scale " << pathTracer.GetDebugScale() << std::endl;
+            }
+            debugScaleKeyDown = scaleDown || scaleUp;
+            bool recordKey = glfwGetKey(window, GLFW_KEY_R);
+            bool playKey = glfwGetKey(window, GLFW_KEY_T);
+            if (recordKey && !cameraKeyDown && !playingCamera)
+            {
+                recordingCamera = !recordingCamera;
+                if (recordingCamera)
+                {
+                    cameraPath.frames.clear();
+                    recordingTime = 0.0f;
+                }
+                else
+                {
+                    std::filesystem::create_directories("CameraPaths");
+                    bool saved = cameraPath.Save(cameraPathFile);
+                    std::cout << (saved ? "Recorded " : "Failed to save ") << cameraPath.frames.size() << " camera frames to " << cameraPathFile << std::endl;
+                }
+            }
+            else if (playKey && !cameraKeyDown && !recordingCamera)
+            {
+                playingCamera = !playingCamera && cameraPath.Load(cameraPathFile);
+                playbackFrame = 0;
+            }
+            cameraKeyDown = recordKey || playKey;
             if (glfwGetKey(window, GLFW_KEY_Q))
             {
-                frameData.frameIndex = 0;
+                resetAccumulation = true;
             }
 
             VkCommandBuffer cmd = renderer->BeginFrame();
-            //vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 0);
+            profiler.BeginFrame(renderer->GetFrameIndex());
+            readback.Update();
+            hdrReadback.Update();
+
+            RayStatistics rayStatistics;
+            if (rayCounters && rayCounters->GetSnapshot(renderer->GetFrameIndex(), rayStatistics))
+            {
+                Renderer::RenderStatistics& statistics = renderer->renderStatistics;
+                statistics.primaryRays = rayStatistics.primaryRays;
+                statistics.secondaryRays = rayStatistics.secondaryRays;
+                statistics.triangleTests = rayStatistics.triangleTests;
+                statistics.boxTests = rayStatistics.boxTests;
+                statistics.sphereTests = rayStatistics.sphereTests;
+
+                double elapsed = std::chrono::duration<double>(currentTime - rateTime).count();
+                if (elapsed >= 1.0)
+                {
+                    statistics.raysPerSecond = (rayStatistics.GetRays() - rateRays) / elapsed;
+                    rateRays = rayStatistics.GetRays();
+                    rateTime = currentTime;
+                }
+            }
+
+            // Dispatches of the previous frame are accumulated, pick the count for this one
+            frameData.frameIndex += accumulationDispatches;
+            double accumulationMs;
+            if (adaptiveAccumulation && accumulationTimer.GetResult(renderer->GetFrameIndex(), accumulationMs))
+            {
+                double dispatchMs = std::max(accumulationMs / accumulationDispatches, 0.01);
+                fullDispatchMs = dispatchMs * std::max(frameData.previewScale * frameData.previewScale, 1u);
+                uint32_t target = static_cast<uint32_t>(accumulationBudgetMs / dispatchMs);
+                // Grow slowly and shrink immediately so a slow frame never stalls presentation for long
+                target = std::min(target, accumulationDispatches + 1);
+                accumulationDispatches = std::clamp(target, 1u, maxAccumulationDispatches);
+            }
+            else if (!adaptiveAccumulation)
+            {
+                accumulationDispatches = 1;
+            }
 
             VkViewport viewport = {};
             viewport.x = 0.0f;
@@ -351,37 +537,110 @@ int main()
             scissor.extent = renderer->GetSwapchain()->GetExtent();
             vkCmdSetScissor(cmd, 0, 1, &scissor);
 
-            camera.Update(deltaTime);
+            if (playingCamera)
+            {
+                const CameraPathFrame& frame = cameraPath.frames[playbackFrame++];
+                camera.SetState(frame.position, frame.yaw, frame.pitch, frame.fov);
+                playingCamera = playbackFrame < cameraPath.frames.size();
+            }
+            else
+            {
+                camera.Update(deltaTime);
+            }
+            if (recordingCamera)
+            {
+                cameraPath.Record(camera, recordingTime);
+                recordingTime += static_cast<float>(deltaTime);
+            }
+            if (camera.moved || resetAccumulation)
+            {
+                frameData.frameIndex = 1;
+                // Only camera motion keeps the history, anything else changed what the pixels see
+                frameData.maxHistory = camera.moved && !resetAccumulation && reprojection ? maxHistory : 0;
+                // The history already holds the first sample indices, continue after every recorded one
+                frameData.seedOffset = frameData.maxHistory > 0 ? recordedDispatches : 0;
+                // The history is traced with the camera before this one. Pixels a preview leaves out
+                // reproject it when they are first traced, possibly frames later, so it stays until the next reset
+                frameData.previousView = glm::inverse(frameData.cameraInverseView);
+                frameData.previousProjection = glm::inverse(frameData.cameraInverseProjection);
+                frameData.previousCameraPos = frameData.cameraPos;
+            }
+            resetAccumulation = false;
             frameData.cameraInverseProjection = camera.inverseProjection;
             frameData.cameraInverseView = camera.inverseView;
             frameData.cameraPos = glm::vec4(camera.position.x, camera.position.y, camera.position.z, 0);
             frameData.cameraDirection = glm::vec4(camera.forward.x, camera.forward.y, camera.forward.z, 0);
-            frameData.window.x = windowExtent.width;
-            frameData.window.y = windowExtent.height;
-            frameData.frameIndex++;
-            if (camera.moved)
-                frameData.frameIndex = 1;
+
+            uint32_t previewScale = 1;
+            if (preview && camera.moved && pathTracer.GetDebugView() == PathTracer::DebugView::None)
+            {
+                // Coarsen immediately and refine one step per frame like the dispatch count
+                uint32_t target = static_cast<uint32_t>(std::ceil(std::sqrt(fullDispatchMs / accumulationBudgetMs)));
+                previewScale = std::clamp(std::max(target, std::max(frameData.previewScale, 1u) - 1), 1u, maxPreviewScale);
+            }
+            if (previewScale != std::max(frameData.previewScale, 1u) && fullDispatchMs > 0.0)
+            {
+                // The measured dispatches were of the old scale, a dispatch costs about one previewScale^2 of a full one
+                double dispatchMs = std::max(fullDispatchMs / (previewScale * previewScale), 0.01);
+                uint32_t target = static_cast<uint32_t>(accumulationBudgetMs / dispatchMs);
+                accumulationDispatches = std::clamp(target, 1u, maxAccumulationDispatches);
+            }
+            frameData.previewScale = previewScale;
 
             //frameData.skyColorHorizon = glm::vec4(camera.position.x, camera.position.x, camera.position.x, 0.0);
             //frameData.skyColorZenith = glm::vec4(0.2, 0.56, 0.95, 0.0);
             //frameData.sunLightDirection = glm::vec4(-0.4, -0.4, -0.4, 0.0);
             //frameData.sunFocus = camera.position.x;
             //frameData.sunIntensity = camera.position.x;
-            copyData = computeFrameBuffer.Map();
-            memcpy(copyData, &frameData, static_cast<size_t>(sizeof(FrameData)));
-            computeFrameBuffer.Unmap();
-            
-            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline.GetHandle());
-            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline.GetLayout(), 0, 1, &computeDescriptor, 0, nullptr);
-            vkCmdDispatch(cmd, std::ceil(windowExtent.width / 64.0f), std::ceil(windowExtent.height / 16.0f), 1);
-            
-
-            VkMemoryBarrier memBarrier;
-            memBarrier.pNext = nullptr;
-            memBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
-            memBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-            memBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-            vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &memBarrier, 0, nullptr, 0, nullptr);
+            pathTracer.UpdateFrameData();
+
+            // With async compute the dispatch runs on the compute queue while graphics waits for the swapchain
+            VkCommandBuffer computeCmd = renderer->GetComputeCommandBuffer();
+            profiler.CmdBeginScope(computeCmd, "Accumulation");
+            accumulationTimer.CmdBegin(computeCmd, renderer->GetFrameIndex());
+            pathTracer.CmdDispatch(computeCmd, accumulationDispatches);
+            recordedDispatches += accumulationDispatches;
+            accumulationTimer.CmdEnd(computeCmd, renderer->GetFrameIndex());
+            profiler.CmdEndScope(computeCmd);
+            if (rayCounters)
+                rayCounters->CmdSnapshot(computeCmd, renderer->GetFrameIndex());
+            // Previews leave pixels without samples, the filter needs all of them
+            if (frameData.denoise && frameData.previewScale <= 1 && pathTracer.GetDebugView() == PathTracer::DebugView::None)
+            {
+                profiler.CmdBeginScope(computeCmd, "Denoise");
+                denoiser.CmdDenoise(computeCmd, frameData, renderer->GetFrameIndex(), &profiler);
+                profiler.CmdEndScope(computeCmd);
+            }
+
+            if (hdrScreenshotRequested)
+            {
+                profiler.CmdBeginScope(computeCmd, "HDR resolve");
+                hdrResolve.CmdResolve(computeCmd);
+                profiler.CmdEndScope(computeCmd);
+                hdrScreenshotRequested = !hdrReadback.CmdCaptureBuffer(computeCmd, hdrResolve.GetBuffer()->GetHandle(), [](const void* data, VkExtent2D extent) {
+                    if (!WriteImageEXR("Screenshot/test.exr", extent.width, extent.height, data, true))
+                        Logger::PrintError("Failed to write Screenshot/test.exr");
+                    });
+            }
+
+            Image* presentImage = presentImages[renderer->GetFrameIndex()].get();
+            VkMemoryBarrier outputBarrier = {};
+            outputBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            outputBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            outputBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            vkCmdPipelineBarrier(computeCmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &outputBarrier, 0, nullptr, 0, nullptr);
+            VkImageCopy outputCopy = {};
+            outputCopy.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+            outputCopy.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+            outputCopy.extent = { windowExtent.width, windowExtent.height, 1 };
+            vkCmdCopyImage(computeCmd, pathTracer.GetOutputImage()->GetHandle(), VK_IMAGE_LAYOUT_GENERAL, presentImage->GetHandle(), VK_IMAGE_LAYOUT_GENERAL, 1, &outputCopy);
+            // The next dispatches write the output image again after the copy read it
+            outputBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            outputBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+            vkCmdPipelineBarrier(computeCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &outputBarrier, 0, nullptr, 0, nullptr);
+
+            renderer->CmdComputeToGraphics(presentImage->GetHandle());
+            renderer->SubmitCompute();
 
 
             VkRenderPassBeginInfo renderPassBeginInfo = {};
@@ -396,57 +655,140 @@ int main()
             renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
             renderPassBeginInfo.pClearValues = clearValues.data();
 
+            profiler.CmdBeginScope(cmd, "Present pass");
             vkCmdBeginRenderPass(cmd, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, presentPipeline.GetLayout(), 0, 1, &descriptor, 0, nullptr);
+            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, presentPipeline.GetLayout(), 0, 1, &descriptors[renderer->GetFrameIndex()], 0, nullptr);
             vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, presentPipeline.GetHandle());
             vkCmdDraw(cmd, 6, 1, 0, 0);
 
-            //ImGuiBeginFrame();
-            //ImGui::Begin("Vulkan Texture", 0, ImGuiWindowFlags_NoScrollbar);
-            //ImGui::Text("lol");
-            //ImGui::End();
-            //ImGuiEndFrame(cmd);
+            if (showProfiler)
+            {
+                ImGuiBeginFrame();
+                ImGuiProfilerWindow(profiler);
+                ImGuiEndFrame(cmd);
+            }
 
             vkCmdEndRenderPass(cmd);
-            //vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 1);
-      
+            profiler.CmdEndScope(cmd);
+
+            profiler.CmdBeginScope(cmd, "Readback");
+            if (screenshotRequested && readback.CmdCapturePNG(cmd, presentImage->GetHandle(), "Screenshot/test.png"))
+                screenshotRequested = false;
+            if (captureSequence)
+            {
+                // Never stall the frame, drop the capture when the encoders fall behind
+                char path[64];
+                snprintf(path, sizeof(path), "Capture/frame_%05u.png", capturedFrames);
+                if (readback.CmdCapturePNG(cmd, presentImage->GetHandle(), path))
+                    capturedFrames++;
+                else
+                    droppedFrames++;
+            }
+            profiler.CmdEndScope(cmd);
+            renderer->CmdGraphicsToCompute(presentImage->GetHandle());
 
             //swapchain->EndFrame();
             renderer->EndFrame();
+        }
 
-            /*
-            uint64_t buffer[2];
+        Core::Get()->WaitIdle();
+        readback.Flush();
+        hdrReadback.Flush();
+        ImGuiShutdown();
+    }
 
-            Core::Get()->WaitIdle();
+	return 0;
+}
 
-            VkResult result = vkGetQueryPoolResults(Core::Get()->GetLogicalDevice(), queryPool, 0, 2, sizeof(uint64_t) * 2, buffer, sizeof(uint64_t),
-                VK_QUERY_RESULT_64_BIT);
-            if (result == VK_NOT_READY)
+int main(int argc, char** argv)
+{
+    bool batch = false;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h")
+        {
+            PrintUsage();
+            return 0;
+        }
+        if (arg == "--regression")
+        {
+            RegressionSettings settings;
+            if (!ParseRegressionSettings(argc, argv, settings))
             {
-                std::cout << "RETURN" << std::endl;
-                return 0;
+                PrintUsage();
+                return 1;
             }
-            else if (result == VK_SUCCESS)
+            return RunRegression(settings);
+        }
+        if (arg == "--benchmark")
+        {
+            BenchmarkSettings settings;
+            if (!ParseBenchmarkSettings(argc, argv, settings))
             {
-                float f = Core::Get()->GetPhysicalDeviceProperties().limits.timestampPeriod;
-                //mTimeQueryResults[swapchainIndex] = buffer[1] - buffer[0];
-                //std::cout << "Time: " << (buffer[1] - buffer[0]) * 0.0000001 * f << std::endl;
-                std::cout << "Time: " << (buffer[1] - buffer[0]) * double(f / 1e6) << std::endl;
+                PrintUsage();
+                return 1;
             }
-            else
+            return RunBenchmark(settings);
+        }
+        if (arg == "--worker")
+        {
+            std::string address = i + 1 < argc ? argv[i + 1] : "";
+            size_t separator = address.rfind(':');
+            try
             {
-                throw std::runtime_error("Failed to receive query results!");
+                if (separator == std::string::npos)
+                    throw std::invalid_argument(address);
+                return RunWorker(address.substr(0, separator), static_cast<uint16_t>(std::stoul(address.substr(separator + 1))));
+            }
+            catch (const std::exception&)
+            {
+                std::cout << "Expected --worker <host:port>" << std::endl;
+                return 1;
             }
-
-            // Queries must be reset after each individual use.
-            vkResetQueryPool(Core::Get()->GetLogicalDevice(), queryPool, 0, 2);
-            */
         }
+        batch |= arg == "--render";
+    }
 
-        Core::Get()->WaitIdle();
-        //vkDestroyQueryPool(Core::Get()->GetLogicalDevice(), queryPool, nullptr);
-        ImGuiShutdown();
+    if (batch)
+    {
+        BatchSettings settings;
+        if (!ParseBatchSettings(argc, argv, settings))
+        {
+            PrintUsage();
+            return 1;
+        }
+        if (settings.coordinatorPort != 0)
+        {
+            FarmSettings farm;
+            farm.scenePath = settings.scenePath;
+            farm.outputPath = settings.outputPath;
+            farm.extent = settings.extent;
+            farm.samplesPerPixel = settings.samplesPerPixel;
+            farm.tileSize = settings.tileSize;
+            farm.jobSamples = settings.jobSamples;
+            farm.port = settings.coordinatorPort;
+            farm.localWorkers = settings.localWorkers;
+            farm.halfFloat = settings.halfFloat;
+            return RunCoordinator(farm, argv[0]);
+        }
+        if (!settings.devices.empty())
+        {
+            MultiDeviceSettings multiDevice;
+            multiDevice.scenePath = settings.scenePath;
+            multiDevice.outputPath = settings.outputPath;
+            multiDevice.extent = settings.extent;
+            multiDevice.samplesPerPixel = settings.samplesPerPixel;
+            multiDevice.devices = settings.devices;
+            multiDevice.mergeDevice = settings.mergeDevice;
+            multiDevice.halfFloat = settings.halfFloat;
+            return RunMultiDevice(multiDevice);
+        }
+        return settings.timelinePath.empty() ? RunBatch(settings) : RunAnimation(settings);
     }
 
-	return 0;
-}
\ No newline at end of file
+    bool instrument = false;
+    for (int i = 1; i < argc; i++)
+        instrument |= std::string(argv[i]) == "--instrument";
+    return RunInteractive(instrument);
+}
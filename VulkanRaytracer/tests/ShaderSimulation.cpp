@@ -0,0 +1,497 @@
+// Runs main, PreviewPixel and ReprojectHistory of Raytracing.comp and the mains of Adaptive.comp,
+// Upscale.comp and Resolve.comp on the host over a stub scene, driven like PathTracer::CmdDispatch
+// and the frame loop of main.cpp. Checks the dispatch count in the accumulation alpha after camera
+// moves, with previews and with adaptive sampling, and the means everything divides it out of.
+// It covers the logic of the shaders, not their compilation or the barriers between the passes.
+// python3 ShaderSimulation/ExtractShaders.py ../res/Shaders /tmp/ShaderSimulation
+// g++ -O1 -std=c++17 -IShaderSimulation -I/tmp/ShaderSimulation ShaderSimulation.cpp -o /tmp/ShaderSimulation/ShaderSimulation
+#include "Glsl.h"
+#include <cstdio>
+
+int outOfBoundsAccesses = 0;
+
+const int width = 97;
+const int height = 64;
+
+Image accumulation, statistics, features, albedo, output, history, previousFeatures;
+std::vector<uint> resolvedBuffer(static_cast<size_t>(width) * height * 4);
+uvec3 invocation;
+
+// Matches FrameData in Raytracing.comp, the members the extracted functions read
+struct FrameDataBlock
+{
+    mat4 inverseProjection;
+    mat4 inverseView;
+    vec4 cameraPos;
+    vec2 window;
+    uint raysPerPixel = 1;
+    uint frameIndex = 1;
+    uint seedOffset = 0;
+    float adaptiveThreshold = 0.0f;
+    uint adaptiveMinSamples = 0;
+    uint denoise = 0;
+    uint maxHistory = 0;
+    uint previewScale = 1;
+    mat4 previousView;
+    mat4 previousProjection;
+    vec4 previousCameraPos;
+} frame;
+
+// AdaptivePixels of Adaptive.comp, Raytracing.comp walks the same buffer
+struct
+{
+    uvec3 dispatchSize;
+    uint pixelCount;
+    uint deviationLow;
+    uint deviationHigh;
+    uvec2 padding;
+    uint pixels[width * height];
+} pixelList;
+
+namespace Raytracing
+{
+    FrameDataBlock& frameData = frame;
+    struct { uint frameOffset, pixelOffsetX, pixelOffsetY; float debugScale; uint compacted; } dispatchData;
+    const uint debugView = 0;
+    uint debugTests;
+    uint debugPathLength;
+    vec4 firstHitFeatures;
+    vec3 firstHitAlbedo;
+    Image& outputImage = output;
+    Image& accumulationImage = accumulation;
+    Image& statisticsImage = statistics;
+    Image& featureImage = features;
+    Image& albedoImage = albedo;
+    Image& historyImage = history;
+    Image& previousFeatureImage = previousFeatures;
+    uint& adaptivePixelCount = pixelList.pixelCount;
+    uint (&adaptivePixels)[width * height] = pixelList.pixels;
+    uvec3& gl_GlobalInvocationID = invocation;
+    uvec3 gl_WorkGroupID;
+    uvec3 gl_WorkGroupSize = { 64, 16, 1 };
+    uint gl_LocalInvocationIndex;
+
+    struct Ray;
+    struct Rng;
+    vec3 Trace(Ray ray, Rng& rng);
+#include "raytracing.inc"
+
+    // A patch of ground and a sphere standing on it, the light only depends on the hit
+    // and is smooth enough for the bilinear reprojection
+    vec3 Trace(Ray ray, Rng& rng)
+    {
+        const vec3 center(0.0f, 0.7f, 0.0f);
+        const float radius = 0.7f;
+        float t = 1e30f;
+        vec3 normal;
+        bool sphere = false;
+        if (ray.direction.y < 0.0f)
+        {
+            float s = -ray.origin.y / ray.direction.y;
+            vec3 p = ray.origin + ray.direction * s;
+            if (std::fabs(p.x) < 6.0f && std::fabs(p.z) < 6.0f)
+            {
+                t = s;
+                normal = vec3(0.0f, 1.0f, 0.0f);
+            }
+        }
+        vec3 oc = ray.origin - center;
+        float b = dot(oc, ray.direction);
+        float disc = b * b - dot(oc, oc) + radius * radius;
+        if (disc > 0.0f && -b - std::sqrt(disc) > 0.0f && -b - std::sqrt(disc) < t)
+        {
+            t = -b - std::sqrt(disc);
+            sphere = true;
+            normal = normalize(ray.origin + ray.direction * t - center);
+        }
+        if (t >= 1e30f)
+            return vec3(0.2f, 0.4f, 0.8f);
+
+        vec3 hit = ray.origin + ray.direction * t;
+        firstHitFeatures = vec4(normal, distance(ray.origin, hit));
+        firstHitAlbedo = vec3(1.0f);
+        vec3 light = sphere ? vec3(0.9f, 0.3f, 0.2f) * (0.6f + 0.4f * normal.y)
+            : vec3(0.5f + 0.3f * std::sin(0.5f * hit.x), 0.5f + 0.3f * std::cos(0.4f * hit.z), 0.3f);
+        // Noise on the sphere gives adaptive sampling a deviation to budget for
+        if (frameData.adaptiveThreshold > 0.0f && sphere)
+            light += vec3(0.1f * (static_cast<float>(Hash(rng.state)) / 4294967296.0f - 0.5f));
+        return light;
+    }
+
+    // Globals of GLSL start over in every invocation
+    void Invoke(uint x, uint y)
+    {
+        invocation = { x, y, 0 };
+        debugTests = 0;
+        debugPathLength = 0;
+        firstHitFeatures = vec4(0, 0, 0, 0);
+        firstHitAlbedo = vec3(1, 1, 1);
+        RaytracingMain();
+    }
+}
+
+namespace Adaptive
+{
+    struct { float threshold; uint minSamples, width, height, pass; } adaptive;
+    Image& accumulationImage = accumulation;
+    Image& outputImage = output;
+    Image& statisticsImage = statistics;
+    uvec3& dispatchSize = pixelList.dispatchSize;
+    uint& pixelCount = pixelList.pixelCount;
+    uint& deviationLow = pixelList.deviationLow;
+    uint& deviationHigh = pixelList.deviationHigh;
+    uint (&pixels)[width * height] = pixelList.pixels;
+    uvec3& gl_GlobalInvocationID = invocation;
+    uint gl_LocalInvocationIndex;
+    uint groupDeviation;
+#include "adaptive.inc"
+
+    uint listedPixels = 0;
+
+    // AdaptiveSampler::CmdBuildPixelList. Pass 0 clears and flushes the sum of the
+    // workgroup here, its first invocation does it around the barriers on the device
+    void BuildPixelList()
+    {
+        pixelList.dispatchSize = { 0, 1, 1 };
+        pixelCount = deviationLow = deviationHigh = 0;
+        adaptive = { frame.adaptiveThreshold, frame.adaptiveMinSamples, static_cast<uint>(width), static_cast<uint>(height), 0 };
+        for (adaptive.pass = 0; adaptive.pass < 2; adaptive.pass++)
+        {
+            for (uint groupY = 0; groupY < (height + 15) / 16; groupY++)
+            {
+                for (uint groupX = 0; groupX < (width + 15) / 16; groupX++)
+                {
+                    groupDeviation = 0;
+                    for (uint i = 0; i < 256; i++)
+                    {
+                        gl_LocalInvocationIndex = adaptive.pass == 0 ? 1 : i;
+                        invocation = { groupX * 16 + i % 16, groupY * 16 + i / 16, 0 };
+                        AdaptiveMain();
+                    }
+                    if (adaptive.pass == 0)
+                        deviationLow += groupDeviation;
+                }
+            }
+        }
+        listedPixels = pixelCount;
+    }
+}
+
+namespace Upscale
+{
+    struct { uint scale, width, height; } upscale;
+    Image& accumulationImage = accumulation;
+    Image& outputImage = output;
+    uvec3& gl_GlobalInvocationID = invocation;
+#include "upscale.inc"
+}
+
+namespace Resolve
+{
+    struct { uint halfFloat; } resolveData;
+    Image& accumulationImage = accumulation;
+    std::vector<uint>& resolved = resolvedBuffer;
+    uvec3& gl_GlobalInvocationID = invocation;
+#include "resolve.inc"
+}
+
+struct Camera
+{
+    vec3 position;
+    mat4 inverseProjection;
+    mat4 inverseView;
+};
+
+Camera MakeCamera(vec3 position, vec3 target)
+{
+    Camera camera;
+    camera.position = position;
+    camera.inverseProjection = inverse(perspectiveFov(1.2f, static_cast<float>(width), static_cast<float>(height), 0.1f, 1000.0f));
+    camera.inverseView = inverse(lookAtLH(position, target, vec3(0.0f, 1.0f, 0.0f)));
+    return camera;
+}
+
+uint recordedDispatches = 0;
+uint accumulationDispatches = 0;
+uint compactedDispatches = 0;
+bool reverseOrder = false;
+
+// One frame of main.cpp with the dispatches of PathTracer::CmdDispatch, a preview only while the camera moves
+void Frame(const Camera& camera, bool moved, bool reset, uint previewScale, uint dispatches, uint maxHistory)
+{
+    frame.frameIndex += accumulationDispatches;
+    if (moved || reset)
+    {
+        frame.frameIndex = 1;
+        frame.maxHistory = moved && !reset ? maxHistory : 0;
+        frame.seedOffset = frame.maxHistory > 0 ? recordedDispatches : 0;
+        frame.previousView = inverse(frame.inverseView);
+        frame.previousProjection = inverse(frame.inverseProjection);
+        frame.previousCameraPos = frame.cameraPos;
+    }
+    frame.inverseProjection = camera.inverseProjection;
+    frame.inverseView = camera.inverseView;
+    frame.cameraPos = vec4(camera.position, 0.0f);
+    frame.window = vec2(static_cast<float>(width), static_cast<float>(height));
+    frame.previewScale = moved ? previewScale : 1;
+    accumulationDispatches = dispatches;
+
+    // CmdCopyHistory
+    if (frame.frameIndex == 1 && frame.maxHistory > 0)
+    {
+        history.texels = accumulation.texels;
+        previousFeatures.texels = features.texels;
+    }
+
+    uint scale = std::max(frame.previewScale, 1u);
+    uint tracedWidth = (width + scale - 1) / scale;
+    uint tracedHeight = (height + scale - 1) / scale;
+    bool adaptive = frame.adaptiveThreshold > 0.0f && scale == 1;
+    uint uniformDispatches = (frame.adaptiveMinSamples + frame.raysPerPixel - 1) / std::max(frame.raysPerPixel, 1u);
+    for (uint i = 0; i < dispatches; i++)
+    {
+        bool compacted = adaptive && frame.frameIndex + i > std::max(uniformDispatches, 1u);
+        Raytracing::dispatchData = { i, 0, 0, 1.0f, compacted ? 1u : 0u };
+        if (compacted)
+        {
+            Adaptive::BuildPixelList();
+            compactedDispatches++;
+            for (uint group = 0; group < pixelList.dispatchSize.x; group++)
+            {
+                for (uint index = 0; index < 1024; index++)
+                {
+                    Raytracing::gl_WorkGroupID = { group, 0, 0 };
+                    Raytracing::gl_LocalInvocationIndex = index;
+                    Raytracing::Invoke(0, 0);
+                }
+            }
+            continue;
+        }
+
+        // Whole workgroups, the shader returns outside the image
+        uint dispatchWidth = (tracedWidth + 63) / 64 * 64;
+        uint dispatchHeight = (tracedHeight + 15) / 16 * 16;
+        for (uint n = 0; n < dispatchWidth * dispatchHeight; n++)
+        {
+            uint k = reverseOrder ? dispatchWidth * dispatchHeight - 1 - n : n;
+            Raytracing::Invoke(k % dispatchWidth, k / dispatchWidth);
+        }
+    }
+    recordedDispatches += dispatches;
+
+    if (scale > 1)
+    {
+        Upscale::upscale = { scale, static_cast<uint>(width), static_cast<uint>(height) };
+        for (uint y = 0; y < (height + 15) / 16 * 16; y++)
+        {
+            for (uint x = 0; x < (width + 15) / 16 * 16; x++)
+            {
+                invocation = { x, y, 0 };
+                Upscale::UpscaleMain();
+            }
+        }
+    }
+}
+
+void Clear()
+{
+    for (Image* image : { &accumulation, &statistics, &features, &albedo, &output, &history, &previousFeatures })
+        image->Resize(width, height);
+    frame = FrameDataBlock();
+    recordedDispatches = 0;
+    accumulationDispatches = 0;
+    compactedDispatches = 0;
+}
+
+// Light of the primary ray of the pixel
+vec3 Expected(const Camera& camera, int x, int y)
+{
+    vec2 coord = vec2(x / static_cast<float>(width), y / static_cast<float>(height)) * 2.0f - 1.0f;
+    vec4 target = camera.inverseProjection * vec4(coord, 1.0f, 1.0f);
+    Raytracing::Ray ray;
+    ray.origin = camera.position;
+    ray.direction = vec3(camera.inverseView * vec4(normalize(target.xyz() / target.w), 0.0f));
+    Raytracing::Rng rng = {};
+    float threshold = frame.adaptiveThreshold;
+    frame.adaptiveThreshold = 0.0f;
+    vec3 light = Raytracing::Trace(ray, rng);
+    frame.adaptiveThreshold = threshold;
+    return light;
+}
+
+// Largest and mean difference of the output to the expected light over the channels
+float OutputError(const Camera& camera, float& mean)
+{
+    float worst = 0.0f;
+    double sum = 0.0;
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            vec3 d = abs(output.At({ x, y }).xyz() - Expected(camera, x, y));
+            float e = max(d.x, max(d.y, d.z));
+            worst = max(worst, e);
+            sum += e;
+        }
+    }
+    mean = static_cast<float>(sum / (width * height));
+    return worst;
+}
+
+int failures = 0;
+
+void Check(bool ok, const char* what)
+{
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    failures += ok ? 0 : 1;
+}
+
+int main()
+{
+    const Camera a = MakeCamera(vec3(0.0f, 1.5f, -4.0f), vec3(0.0f, 0.5f, 0.0f));
+    const Camera b = MakeCamera(vec3(0.4f, 1.6f, -3.7f), vec3(0.15f, 0.5f, 0.0f));
+    const Camera c = MakeCamera(vec3(0.8f, 1.7f, -3.4f), vec3(0.3f, 0.5f, 0.0f));
+    const float epsilon = 1e-4f;
+
+    // Invocations only touch their own pixels, the order must not matter
+    for (int order = 0; order < 2; order++)
+    {
+        reverseOrder = order == 1;
+        printf("Invocations in %s order\n", reverseOrder ? "reverse" : "forward");
+        float mean;
+
+        Clear();
+        Frame(a, false, true, 1, 3, 0);
+        Frame(a, false, false, 1, 2, 0);
+        bool counted = true;
+        for (vec4& p : accumulation.texels)
+            counted &= p.w == 5.0f;
+        Check(counted, "static camera, alpha counts the 5 dispatches");
+        Check(OutputError(a, mean) < 1e-5f, "static camera, the output is the light");
+
+        // A limit below the 5 dispatches of history so it applies
+        Frame(b, true, false, 1, 2, 4);
+        int reprojected = 0, limited = 0, bounded = 0;
+        for (vec4& p : accumulation.texels)
+        {
+            float historyLength = p.w - 2.0f;
+            reprojected += historyLength > epsilon ? 1 : 0;
+            limited += std::fabs(historyLength - 4.0f) < epsilon ? 1 : 0;
+            bounded += historyLength > -epsilon && historyLength < 4.0f + epsilon ? 1 : 0;
+        }
+        float worst = OutputError(b, mean);
+        printf("     %d of %d pixels reprojected, error max %.4f mean %.5f\n", reprojected, width * height, worst, mean);
+        Check(bounded == width * height, "camera move, alpha is at most maxHistory of history and the new dispatches");
+        Check(reprojected > width * height / 2 && limited > width * height / 4, "camera move, most pixels reproject, full history is cut to maxHistory");
+        Check(mean < 0.01f, "camera move, the mean of history and new samples stays at the light");
+
+        for (uint y = 0; y < height; y++)
+        {
+            for (uint x = 0; x < width; x++)
+            {
+                invocation = { x, y, 0 };
+                Resolve::ResolveMain();
+            }
+        }
+        bool resolved = true;
+        for (size_t i = 0; i < output.texels.size(); i++)
+        {
+            float r;
+            memcpy(&r, &resolvedBuffer[i * 4], sizeof(r));
+            resolved &= std::fabs(r - output.texels[i].x) < 1e-6f;
+        }
+        Check(resolved, "camera move, Resolve.comp divides out the same mean");
+
+        Frame(b, false, false, 1, 30, 4);
+        worst = OutputError(b, mean);
+        Check(worst < 0.01f && mean < 0.003f, "camera stopped, the history fades under new samples");
+
+        // Adaptive sampling after a move, skipped pixels add their mean so alpha still counts every dispatch
+        Clear();
+        Frame(a, false, true, 1, 5, 0);
+        frame.adaptiveThreshold = 0.005f;
+        frame.adaptiveMinSamples = 2;
+        Frame(b, true, false, 1, 3, 4);
+        counted = true;
+        for (vec4& p : accumulation.texels)
+            counted &= p.w > 3.0f - epsilon && p.w < 7.0f + epsilon;
+        OutputError(b, mean);
+        printf("     %u of %d pixels listed by Adaptive.comp\n", Adaptive::listedPixels, width * height);
+        Check(compactedDispatches == 1 && Adaptive::listedPixels > 0 && Adaptive::listedPixels < static_cast<uint>(width * height),
+            "adaptive after a move, the list holds some of the pixels");
+        Check(counted, "adaptive after a move, alpha is the history and every dispatch");
+        Check(mean < 0.01f, "adaptive after a move, the skipped pixels keep their mean");
+
+        for (uint scale = 2; scale <= 3; scale++)
+        {
+            printf("     preview scale %u\n", scale);
+            // Without history a pixel is traced once in scale^2 dispatches, Upscale.comp fills the others
+            bool once = true, growing = true, complete = false, filled = true;
+            int previous = 0;
+            for (uint dispatches = 1; dispatches <= scale * scale; dispatches++)
+            {
+                Clear();
+                Frame(a, false, true, 1, 1, 0);
+                for (vec4& p : output.texels)
+                    p = vec4(NAN);
+                Frame(b, true, false, scale, dispatches, 0);
+                int traced = 0;
+                for (size_t i = 0; i < accumulation.texels.size(); i++)
+                {
+                    float w = accumulation.texels[i].w;
+                    traced += w == 1.0f ? 1 : 0;
+                    once &= w == 0.0f || w == 1.0f;
+                    filled &= std::isfinite(output.texels[i].x);
+                }
+                growing &= traced > previous;
+                previous = traced;
+                complete = traced == width * height;
+            }
+            Check(once, "preview, a pixel is traced at most once per cycle of the block");
+            Check(growing && complete, "preview, every dispatch traces new pixels and a cycle covers the image");
+            Check(filled, "preview, Upscale.comp fills every pixel not traced yet");
+
+            // Moving over two frames then stopping, the waiting pixels reproject when first traced
+            Clear();
+            Frame(a, false, true, 1, 4, 0);
+            Frame(b, true, false, scale, 1, 16);
+            Frame(c, true, false, scale, 2, 16);
+            Frame(c, false, false, 1, 1, 16);
+            bool bounded = true;
+            for (vec4& p : accumulation.texels)
+                bounded &= p.w > 1.0f - epsilon && p.w < 16.0f + 3.0f + epsilon;
+            worst = OutputError(c, mean);
+            printf("     after stopping error max %.4f mean %.5f\n", worst, mean);
+            Check(bounded, "preview then stop, alpha is the history and the dispatches of the pixel");
+            Check(mean < 0.01f, "preview then stop, the mean stays at the light");
+        }
+
+        // What the window does with preview and reprojection on: the scale refines by one per frame
+        // of a continuous move with several dispatches a frame, then the camera stops
+        Clear();
+        Frame(a, false, true, 1, 4, 0);
+        const uint scales[] = { 3, 3, 2, 2, 1, 1 };
+        bool filled = true;
+        for (uint i = 0; i < 6; i++)
+        {
+            float t = (i + 1) / 6.0f;
+            Camera moving = MakeCamera(vec3(0.8f * t, 1.5f + 0.2f * t, -4.0f + 0.6f * t), vec3(0.3f * t, 0.5f, 0.0f));
+            Frame(moving, true, false, scales[i], 1 + i % 3, 16);
+            for (vec4& p : output.texels)
+                filled &= std::isfinite(p.x) && std::isfinite(p.y) && std::isfinite(p.z);
+        }
+        Check(filled, "moving camera path, every frame has an output for every pixel");
+        Frame(c, false, false, 1, 3, 16);
+        bool settled = true;
+        for (vec4& p : accumulation.texels)
+            settled &= p.w > 3.0f - epsilon && p.w < 16.0f + 3.0f + epsilon;
+        worst = OutputError(c, mean);
+        printf("     camera path then stop, error max %.4f mean %.5f\n", worst, mean);
+        Check(settled, "camera path then stop, alpha is the history and the dispatches of the pixel");
+        Check(mean < 0.01f, "camera path then stop, the mean stays at the light");
+    }
+    Check(outOfBoundsAccesses == 0, "no image access outside the images");
+
+    printf("%s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}
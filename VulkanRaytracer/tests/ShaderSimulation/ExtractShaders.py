@@ -0,0 +1,43 @@
+# Pulls the functions ShaderSimulation.cpp runs out of the compute shaders as C++,
+# preprocessed without any define like the normal pipelines
+# python3 ExtractShaders.py <shader directory> <output directory>
+import os
+import re
+import subprocess
+import sys
+
+SHADERS = {
+    "Raytracing.comp": ("raytracing.inc", "RaytracingMain",
+        ["struct Ray\n", "struct Rng\n", "uint Hash(", "vec4 ReprojectHistory(", "ivec2 PreviewPixel(", "vec3 Heatmap(", "void main()"]),
+    "Adaptive.comp": ("adaptive.inc", "AdaptiveMain", ["float Deviation(", "void main()"]),
+    "Upscale.comp": ("upscale.inc", "UpscaleMain", ["void main()"]),
+    "Resolve.comp": ("resolve.inc", "ResolveMain", ["void main()"]),
+}
+
+def Preprocess(path):
+    lines = [l for l in open(path).read().splitlines() if not l.startswith(("#version", "#extension"))]
+    return subprocess.run(["cpp", "-P", "-undef"], input="\n".join(lines), capture_output=True, text=True, check=True).stdout
+
+def Block(source, header):
+    start = source.index(header)
+    depth = 0
+    for i in range(source.index("{", start), len(source)):
+        depth += {"{": 1, "}": -1}.get(source[i], 0)
+        if depth == 0:
+            return source[start:i + 1] + (";" if header.startswith("struct") else "")
+    raise ValueError(header)
+
+def ToCpp(text):
+    # Swizzles become calls, single components of rgba their xyzw names
+    text = re.sub(r"\.(xyz|xy|rgb|rg|ba)\b", r".\1()", text)
+    text = re.sub(r"\.([rgba])\b", lambda m: "." + "xyzw"["rgba".index(m.group(1))], text)
+    return text.replace("inout Rng rng", "Rng& rng")
+
+shaderDirectory, outputDirectory = sys.argv[1:3]
+os.makedirs(outputDirectory, exist_ok=True)
+for shader, (output, mainName, headers) in SHADERS.items():
+    source = Preprocess(os.path.join(shaderDirectory, shader))
+    blocks = [Block(source, header) for header in headers]
+    blocks[-1] = blocks[-1].replace("void main()", "void " + mainName + "()", 1)
+    with open(os.path.join(outputDirectory, output), "w") as file:
+        file.write("\n\n".join(ToCpp(block) for block in blocks) + "\n")
@@ -0,0 +1,241 @@
+// Just enough of GLSL to run the functions ExtractShaders.py pulls out of the
+// compute shaders on the host. Images are plain arrays, accesses outside them
+// are counted since they are undefined on the device
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+typedef uint32_t uint;
+
+struct ivec2;
+struct uvec2;
+struct vec4;
+
+struct vec2
+{
+    float x, y;
+    vec2() : x(0), y(0) {}
+    explicit vec2(float s) : x(s), y(s) {}
+    vec2(float a, float b) : x(a), y(b) {}
+    explicit vec2(const ivec2& v);
+};
+
+struct ivec2
+{
+    int x, y;
+    ivec2() : x(0), y(0) {}
+    explicit ivec2(int s) : x(s), y(s) {}
+    ivec2(int a, int b) : x(a), y(b) {}
+    explicit ivec2(const vec2& v) : x(static_cast<int>(v.x)), y(static_cast<int>(v.y)) {}
+    explicit ivec2(const uvec2& v);
+};
+
+struct uvec2 { uint x, y; };
+
+struct uvec3
+{
+    uint x, y, z;
+    uvec2 xy() const { return { x, y }; }
+};
+
+struct bvec2 { bool x, y; };
+
+struct vec3
+{
+    float x, y, z;
+    vec3() : x(0), y(0), z(0) {}
+    explicit vec3(float s) : x(s), y(s), z(s) {}
+    vec3(float a, float b, float c) : x(a), y(b), z(c) {}
+    explicit vec3(const vec4& v);
+    vec3& operator+=(const vec3& o) { x += o.x; y += o.y; z += o.z; return *this; }
+};
+
+struct vec4
+{
+    float x, y, z, w;
+    vec4() : x(0), y(0), z(0), w(0) {}
+    explicit vec4(float s) : x(s), y(s), z(s), w(s) {}
+    vec4(float a, float b, float c, float d) : x(a), y(b), z(c), w(d) {}
+    vec4(const vec3& v, float d) : x(v.x), y(v.y), z(v.z), w(d) {}
+    vec4(const vec2& v, float c, float d) : x(v.x), y(v.y), z(c), w(d) {}
+    vec3 xyz() const { return vec3(x, y, z); }
+    vec3 rgb() const { return xyz(); }
+    vec2 xy() const { return vec2(x, y); }
+    vec2 rg() const { return xy(); }
+    vec2 ba() const { return vec2(z, w); }
+    float& operator[](int i) { return (&x)[i]; }
+    float operator[](int i) const { return (&x)[i]; }
+    vec4& operator+=(const vec4& o) { x += o.x; y += o.y; z += o.z; w += o.w; return *this; }
+};
+
+inline vec2::vec2(const ivec2& v) : x(static_cast<float>(v.x)), y(static_cast<float>(v.y)) {}
+inline ivec2::ivec2(const uvec2& v) : x(static_cast<int>(v.x)), y(static_cast<int>(v.y)) {}
+inline vec3::vec3(const vec4& v) : x(v.x), y(v.y), z(v.z) {}
+
+inline vec2 operator+(vec2 a, vec2 b) { return { a.x + b.x, a.y + b.y }; }
+inline vec2 operator-(vec2 a, vec2 b) { return { a.x - b.x, a.y - b.y }; }
+inline vec2 operator*(vec2 a, vec2 b) { return { a.x * b.x, a.y * b.y }; }
+inline vec2 operator+(vec2 a, float s) { return { a.x + s, a.y + s }; }
+inline vec2 operator-(vec2 a, float s) { return { a.x - s, a.y - s }; }
+inline vec2 operator*(vec2 a, float s) { return { a.x * s, a.y * s }; }
+inline vec2 operator/(vec2 a, float s) { return { a.x / s, a.y / s }; }
+
+inline ivec2 operator+(ivec2 a, ivec2 b) { return { a.x + b.x, a.y + b.y }; }
+inline ivec2 operator*(ivec2 a, int s) { return { a.x * s, a.y * s }; }
+inline bool operator==(ivec2 a, ivec2 b) { return a.x == b.x && a.y == b.y; }
+inline bool operator!=(ivec2 a, ivec2 b) { return !(a == b); }
+
+inline vec3 operator+(vec3 a, vec3 b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+inline vec3 operator-(vec3 a, vec3 b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+inline vec3 operator*(vec3 a, vec3 b) { return { a.x * b.x, a.y * b.y, a.z * b.z }; }
+inline vec3 operator*(vec3 a, float s) { return { a.x * s, a.y * s, a.z * s }; }
+inline vec3 operator*(float s, vec3 a) { return a * s; }
+inline vec3 operator/(vec3 a, float s) { return { a.x / s, a.y / s, a.z / s }; }
+inline vec3 operator-(float s, vec3 a) { return vec3(s) - a; }
+
+inline vec4 operator+(vec4 a, vec4 b) { return { a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w }; }
+inline vec4 operator*(vec4 a, float s) { return { a.x * s, a.y * s, a.z * s, a.w * s }; }
+
+using std::abs;
+using std::floor;
+using std::sqrt;
+inline float dot(vec3 a, vec3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline vec3 cross(vec3 a, vec3 b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+inline float length(vec3 a) { return std::sqrt(dot(a, a)); }
+inline float distance(vec3 a, vec3 b) { return length(a - b); }
+inline vec3 normalize(vec3 a) { return a / length(a); }
+inline vec2 floor(vec2 a) { return { std::floor(a.x), std::floor(a.y) }; }
+inline vec3 abs(vec3 a) { return { std::fabs(a.x), std::fabs(a.y), std::fabs(a.z) }; }
+inline float min(float a, float b) { return b < a ? b : a; }
+inline float max(float a, float b) { return a < b ? b : a; }
+inline float clamp(float v, float a, float b) { return min(max(v, a), b); }
+inline vec3 clamp(vec3 v, float a, float b) { return { clamp(v.x, a, b), clamp(v.y, a, b), clamp(v.z, a, b) }; }
+inline bvec2 lessThan(ivec2 a, ivec2 b) { return { a.x < b.x, a.y < b.y }; }
+inline bvec2 greaterThanEqual(ivec2 a, ivec2 b) { return { a.x >= b.x, a.y >= b.y }; }
+inline bool any(bvec2 b) { return b.x || b.y; }
+inline bool all(bvec2 b) { return b.x && b.y; }
+inline uint floatBitsToUint(float f) { uint u; memcpy(&u, &f, sizeof(u)); return u; }
+// Only the full float path of Resolve.comp is checked
+inline uint packHalf2x16(vec2) { return 0; }
+
+// Invocations run one after the other, atomics are plain and barriers do nothing
+inline void barrier() {}
+inline uint atomicAdd(uint& a, uint v) { uint old = a; a += v; return old; }
+inline uint atomicMax(uint& a, uint v) { uint old = a; a = std::max(a, v); return old; }
+
+// Column major like GLSL and glm
+struct mat4
+{
+    vec4 c[4];
+    mat4() {}
+    explicit mat4(float d) { for (int i = 0; i < 4; i++) { c[i] = vec4(0.0f); c[i][i] = d; } }
+    vec4& operator[](int i) { return c[i]; }
+    const vec4& operator[](int i) const { return c[i]; }
+};
+
+inline vec4 operator*(const mat4& m, vec4 v)
+{
+    vec4 r(0.0f);
+    for (int i = 0; i < 4; i++)
+        for (int j = 0; j < 4; j++)
+            r[j] += m.c[i][j] * v[i];
+    return r;
+}
+
+extern int outOfBoundsAccesses;
+
+struct Image
+{
+    int width = 0;
+    int height = 0;
+    std::vector<vec4> texels;
+    void Resize(int w, int h) { width = w; height = h; texels.assign(static_cast<size_t>(w) * h, vec4(0.0f)); }
+    vec4& At(ivec2 q) { return texels[static_cast<size_t>(q.y) * width + q.x]; }
+    bool Inside(ivec2 q) const { return q.x >= 0 && q.y >= 0 && q.x < width && q.y < height; }
+};
+
+inline vec4 imageLoad(Image& image, ivec2 q)
+{
+    if (image.Inside(q))
+        return image.At(q);
+    outOfBoundsAccesses++;
+    return vec4(0.0f);
+}
+
+inline void imageStore(Image& image, ivec2 q, vec4 value)
+{
+    if (image.Inside(q))
+        image.At(q) = value;
+    else
+        outOfBoundsAccesses++;
+}
+
+inline ivec2 imageSize(const Image& image) { return { image.width, image.height }; }
+
+// The matrices of the application, glm with GLM_FORCE_LEFT_HANDED and GLM_FORCE_DEPTH_ZERO_TO_ONE
+inline mat4 perspectiveFov(float fov, float width, float height, float zNear, float zFar)
+{
+    float h = std::cos(0.5f * fov) / std::sin(0.5f * fov);
+    mat4 r(0.0f);
+    r[0][0] = h * height / width;
+    r[1][1] = h;
+    r[2][2] = zFar / (zFar - zNear);
+    r[2][3] = 1.0f;
+    r[3][2] = -(zFar * zNear) / (zFar - zNear);
+    return r;
+}
+
+inline mat4 lookAtLH(vec3 eye, vec3 center, vec3 up)
+{
+    vec3 f = normalize(center - eye);
+    vec3 s = normalize(cross(up, f));
+    vec3 u = cross(f, s);
+    mat4 r(1.0f);
+    r[0][0] = s.x; r[1][0] = s.y; r[2][0] = s.z;
+    r[0][1] = u.x; r[1][1] = u.y; r[2][1] = u.z;
+    r[0][2] = f.x; r[1][2] = f.y; r[2][2] = f.z;
+    r[3][0] = -dot(s, eye);
+    r[3][1] = -dot(u, eye);
+    r[3][2] = -dot(f, eye);
+    return r;
+}
+
+// Gauss-Jordan with partial pivoting in double
+inline mat4 inverse(const mat4& m)
+{
+    double a[4][8];
+    for (int row = 0; row < 4; row++)
+        for (int col = 0; col < 4; col++)
+        {
+            a[row][col] = m[col][row];
+            a[row][col + 4] = row == col ? 1.0 : 0.0;
+        }
+    for (int col = 0; col < 4; col++)
+    {
+        int pivot = col;
+        for (int row = col + 1; row < 4; row++)
+            if (std::fabs(a[row][col]) > std::fabs(a[pivot][col]))
+                pivot = row;
+        for (int k = 0; k < 8; k++)
+            std::swap(a[col][k], a[pivot][k]);
+        double d = a[col][col];
+        for (int k = 0; k < 8; k++)
+            a[col][k] /= d;
+        for (int row = 0; row < 4; row++)
+        {
+            if (row == col)
+                continue;
+            double f = a[row][col];
+            for (int k = 0; k < 8; k++)
+                a[row][k] -= f * a[col][k];
+        }
+    }
+    mat4 r;
+    for (int row = 0; row < 4; row++)
+        for (int col = 0; col < 4; col++)
+            r[col][row] = static_cast<float>(a[row][col + 4]);
+    return r;
+}
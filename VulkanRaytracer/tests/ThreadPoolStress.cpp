@@ -0,0 +1,34 @@
+// Back to back ParallelFor calls with a few items each, the pattern CpuPathTracer::Dispatch
+// produces with one dispatch per call. Workers that wake late for one call must not pick up
+// the items of the next one before it published its task.
+// g++ -O2 -std=c++17 -I../src ThreadPoolStress.cpp ../src/Cpu/ThreadPool.cpp -lpthread
+// ThreadPoolStress [calls] [threads]
+#include "Cpu/ThreadPool.h"
+#include <iostream>
+#include <string>
+#include <array>
+
+int main(int argc, char** argv)
+{
+    uint64_t calls = argc > 1 ? std::stoull(argv[1]) : 2000000;
+    uint32_t threadCount = argc > 2 ? static_cast<uint32_t>(std::stoul(argv[2])) : 4;
+
+    ThreadPool pool(threadCount);
+    for (uint64_t call = 0; call < calls; call++)
+    {
+        uint32_t count = static_cast<uint32_t>(call % 3) + 1;
+        std::array<std::atomic<uint32_t>, 3> runs = {};
+        pool.ParallelFor(count, [&](uint32_t item) { runs[item]++; });
+        for (uint32_t item = 0; item < 3; item++)
+        {
+            uint32_t expected = item < count ? 1 : 0;
+            if (runs[item] != expected)
+            {
+                std::cout << "FAIL call " << call << ": item " << item << " ran " << runs[item] << " times, expected " << expected << std::endl;
+                return 1;
+            }
+        }
+    }
+    std::cout << "PASS " << calls << " calls on " << pool.GetThreadCount() << " threads" << std::endl;
+    return 0;
+}